@@ -0,0 +1,302 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_BENCH_HARNESS_HPP
+#define KO_BENCH_HARNESS_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <numeric>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <regex>
+
+
+/*!
+* @file bench_harness.hpp
+* @brief Contains the harness of the PPCKO benchmarks: configuration from the command line, timing of the repetitions, JSON report
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!Minimum seconds of a timed repetition of a cheap benchmark: the body is repeated, and the time per call is reported (can be set at compile time)*/
+#ifndef KO_BENCH_MIN_REP_SECONDS
+#define KO_BENCH_MIN_REP_SECONDS 1e-3
+#endif
+
+
+/*!
+* @struct bench_config
+* @brief Parameters of a benchmark run
+*/
+struct bench_config
+{
+  /*!Sizes of the grid (discrete evaluations)*/
+  std::vector<int> m_s{100,1000};
+  /*!Numbers of time instants*/
+  std::vector<int> n_s{100,1000};
+  /*!Numbers of threads (thread scaling)*/
+  std::vector<int> threads{1};
+  /*!Timed repetitions of each benchmark (after one warm-up)*/
+  int reps = 5;
+  /*!Largest grid for the cv benchmarks*/
+  int cv_max_m = 1000;
+  /*!Regex on the benchmark names: only the matching ones are run*/
+  std::string filter = ".*";
+  /*!JSON report file (empty: standard output)*/
+  std::string out;
+};
+
+
+/*!
+* @struct bench_result
+* @brief Timings of a benchmark, in seconds
+*/
+struct bench_result
+{
+  std::string name;
+  int m;
+  int n;
+  int threads;
+  int reps;
+  /*!Calls per timed repetition (more than one only for cheap benchmarks)*/
+  int calls;
+  double min;
+  double median;
+  double mean;
+  double stddev;
+};
+
+
+/*!
+* @brief Parsing a comma-separated list of integers
+* @param list the list
+* @return the integers
+*/
+inline
+std::vector<int>
+parse_int_list(const std::string &list)
+{
+  std::vector<int> values;
+  std::stringstream ss(list);
+  std::string item;
+  while(std::getline(ss,item,','))
+  {
+    values.emplace_back(std::stoi(item));
+    if(values.back() < 1){  throw std::invalid_argument("Benchmark sizes and threads have to be positive integers");}
+  }
+  if(values.empty()){  throw std::invalid_argument("Empty list for benchmark sizes or threads");}
+
+  return values;
+}
+
+
+/*!
+* @brief Reading the configuration from the command line
+* @param argc number of arguments
+* @param argv arguments
+* @return the configuration
+* @details '--m', '--n', '--threads' (comma-separated lists), '--reps', '--cv-max-m', '--filter', '--out', and '--full' (m: 100,1000,10000, n: 100,1000,5000)
+*/
+inline
+bench_config
+parse_config(int argc, char** argv)
+{
+  bench_config config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if(arg == "--full")
+    {
+      config.m_s = {100,1000,10000};
+      config.n_s = {100,1000,5000};
+      continue;
+    }
+    if(i + 1 == argc){  throw std::invalid_argument("Missing value for the benchmark option " + arg);}
+    const std::string value = argv[++i];
+
+    if(arg == "--m"){              config.m_s      = parse_int_list(value);}
+    else if(arg == "--n"){         config.n_s      = parse_int_list(value);}
+    else if(arg == "--threads"){   config.threads  = parse_int_list(value);}
+    else if(arg == "--reps"){      config.reps     = std::max(1,std::stoi(value));}
+    else if(arg == "--cv-max-m"){  config.cv_max_m = std::stoi(value);}
+    else if(arg == "--filter"){    config.filter   = value;}
+    else if(arg == "--out"){       config.out      = value;}
+    else
+    {
+      throw std::invalid_argument("Wrong benchmark option " + arg);
+    }
+  }
+
+  return config;
+}
+
+
+/*!
+* @brief Statistics of the timed repetitions
+* @param times seconds of each repetition (per call)
+* @return the result, without name and sizes
+*/
+inline
+bench_result
+summarize(std::vector<double> times)
+{
+  bench_result res{};
+  const double n_t = static_cast<double>(times.size());
+
+  std::sort(times.begin(),times.end());
+  res.min    = times.front();
+  res.median = times.size() % 2 ? times[times.size()/2] : 0.5*(times[times.size()/2 - 1] + times[times.size()/2]);
+  res.mean   = std::accumulate(times.cbegin(),times.cend(),0.0)/n_t;
+  res.stddev = std::sqrt(std::accumulate(times.cbegin(),times.cend(),0.0,[&res](double acc, double t){return acc + (t - res.mean)*(t - res.mean);})/n_t);
+
+  return res;
+}
+
+
+/*!
+* @brief Timing a benchmark whose body consumes its state: one call per repetition, the state is prepared outside the timing
+* @param reps timed repetitions (after one warm-up)
+* @param setup function returning the state of a repetition
+* @param body function timed on the state
+* @return the statistics of the repetitions
+*/
+template<typename SETUP, typename BODY>
+bench_result
+measure(int reps, SETUP &&setup, BODY &&body)
+{
+  std::vector<double> times;
+  times.reserve(reps);
+
+  for(int r = 0; r <= reps; ++r)
+  {
+    auto state = setup();
+    const auto start = std::chrono::steady_clock::now();
+    body(state);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(r > 0){  times.emplace_back(elapsed);}
+  }
+
+  bench_result res = summarize(std::move(times));
+  res.reps  = reps;
+  res.calls = 1;
+  return res;
+}
+
+
+/*!
+* @brief Timing a benchmark whose body can be called repeatedly on the same state: cheap bodies are called several times per repetition
+* @param reps timed repetitions (after one warm-up)
+* @param setup function returning the state, shared by all the repetitions
+* @param body function timed on the state
+* @return the statistics of the repetitions, per call
+*/
+template<typename SETUP, typename BODY>
+bench_result
+measure_repeatable(int reps, SETUP &&setup, BODY &&body)
+{
+  auto state = setup();
+
+  //warm-up, and number of calls so that a repetition lasts at least KO_BENCH_MIN_REP_SECONDS
+  const auto start_warm = std::chrono::steady_clock::now();
+  body(state);
+  const double warm = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_warm).count();
+  const int calls = warm >= KO_BENCH_MIN_REP_SECONDS ? 1 : static_cast<int>(std::min(1e6,std::ceil(KO_BENCH_MIN_REP_SECONDS/std::max(warm,1e-9))));
+
+  std::vector<double> times;
+  times.reserve(reps);
+  for(int r = 0; r < reps; ++r)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for(int c = 0; c < calls; ++c){  body(state);}
+    times.emplace_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/static_cast<double>(calls));
+  }
+
+  bench_result res = summarize(std::move(times));
+  res.reps  = reps;
+  res.calls = calls;
+  return res;
+}
+
+
+/*!
+* @brief Escaping a string for JSON
+*/
+inline
+std::string
+json_escape(const std::string &s)
+{
+  std::string escaped;
+  for(char c : s)
+  {
+    if(c == '"' || c == '\\'){  escaped += '\\';}
+    escaped += c;
+  }
+  return escaped;
+}
+
+
+/*!
+* @brief Writing the JSON report
+* @param os output stream
+* @param context pairs key-value describing the build and the machine
+* @param results results of the benchmarks
+*/
+inline
+void
+write_json(std::ostream &os, const std::vector<std::pair<std::string,std::string>> &context, const std::vector<bench_result> &results)
+{
+  os.precision(9);
+  os << "{\n  \"context\": {";
+  for(std::size_t i = 0; i < context.size(); ++i)
+  {
+    os << (i ? ",\n" : "\n") << "    \"" << json_escape(context[i].first) << "\": \"" << json_escape(context[i].second) << "\"";
+  }
+  os << "\n  },\n  \"benchmarks\": [";
+  for(std::size_t i = 0; i < results.size(); ++i)
+  {
+    const auto &r = results[i];
+    os << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(r.name) << "\", \"m\": " << r.m << ", \"n\": " << r.n << ", \"threads\": " << r.threads
+       << ", \"reps\": " << r.reps << ", \"calls\": " << r.calls << ", \"time_unit\": \"s\", \"min\": " << r.min << ", \"median\": " << r.median
+       << ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+
+/*!
+* @brief Current date and time (UTC), ISO 8601
+*/
+inline
+std::string
+utc_now()
+{
+  const std::time_t now = std::time(nullptr);
+  char buf[32];
+  std::strftime(buf,sizeof(buf),"%Y-%m-%dT%H:%M:%SZ",std::gmtime(&now));
+  return buf;
+}
+
+#endif  //KO_BENCH_HARNESS_HPP
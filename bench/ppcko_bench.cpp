@@ -0,0 +1,380 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+/*!
+* @file ppcko_bench.cpp
+* @brief Benchmarks of the hot paths of PPCKO, outside R: estimator, cv, ADF test and NaNs handling of the data ingestion
+* @author Andrea Enrico Franzoni
+* @details Each benchmark is run on synthetic FAR(1) data for every pair (m,n) requested, and the ones relying on the parallel loops and on Eigen
+*          for every number of threads requested (thread scaling). Results are written as JSON. See 'bench/README.md'
+*/
+
+#include <fstream>
+#include <random>
+#include <functional>
+
+#include <Eigen/Core>
+
+#include "PPC_KO_include.hpp"
+#include "ADF_policies.hpp"
+#include "ADF_test.hpp"
+#include "removing_nan.hpp"
+#include "parallel_backend.hpp"
+#include "multires_cv.hpp"
+
+#include "bench_harness.hpp"
+
+
+/*!Build type reported in the JSON context (set by CMake)*/
+#ifndef KO_BENCH_BUILD_TYPE
+#define KO_BENCH_BUILD_TYPE "unknown"
+#endif
+
+
+//parameters of the fits being benchmarked
+constexpr double bench_alpha     = 0.75;
+constexpr int    bench_k         = 3;
+constexpr double bench_threshold = 0.95;
+constexpr double bench_toll      = 1e-4;
+//number of training/validation splits of the cv benchmarks
+constexpr int    bench_cv_splits = 5;
+//fraction of missing evaluations for the NaNs handling benchmarks
+constexpr double bench_nan_frac  = 0.05;
+
+
+/*!
+* @brief Synthetic fts: FAR(1) on the first Fourier functions of [0,1], plus white noise
+* @param m number of discrete evaluations
+* @param n number of time instants
+* @return the fts (m x n)
+* @details Fixed seed: every run benchmarks the same data
+*/
+KO_Traits::StoringMatrix
+synthetic_fts(int m, int n)
+{
+  constexpr int n_basis = 10;
+  std::mt19937_64 gen(20240101);
+  std::normal_distribution<double> norm(0.0,1.0);
+
+  KO_Traits::StoringMatrix basis(m,n_basis);
+  for(int i = 0; i < m; ++i)
+  {
+    const double s = (static_cast<double>(i) + 0.5)/static_cast<double>(m);
+    for(int j = 0; j < n_basis; ++j){  basis(i,j) = j % 2 ? std::sqrt(2.0)*std::cos(M_PI*(j+1)*s) : std::sqrt(2.0)*std::sin(M_PI*(j+2)*s);}
+  }
+
+  //scores: independent AR(1), decreasing variance
+  KO_Traits::StoringMatrix coeff(n_basis,n);
+  KO_Traits::StoringVector prev = KO_Traits::StoringVector::Zero(n_basis);
+  for(int t = 0; t < n; ++t)
+  {
+    for(int j = 0; j < n_basis; ++j){  prev(j) = 0.6*prev(j) + norm(gen)/static_cast<double>(j+1);}
+    coeff.col(t) = prev;
+  }
+
+  KO_Traits::StoringMatrix X = basis*coeff;
+  for(auto &el : X.reshaped()){  el += 0.1*norm(gen);}
+
+  return X;
+}
+
+
+/*!
+* @brief Synthetic fts with a fraction of missing evaluations
+*/
+KO_Traits::StoringMatrix
+synthetic_fts_nan(const KO_Traits::StoringMatrix &X)
+{
+  std::mt19937_64 gen(20240102);
+  std::bernoulli_distribution missing(bench_nan_frac);
+
+  KO_Traits::StoringMatrix X_nan = X;
+  for(auto &el : X_nan.reshaped()){  if(missing(gen)){  el = std::numeric_limits<double>::quiet_NaN();}}
+
+  return X_nan;
+}
+
+
+/*!
+* @struct bench_case
+* @brief A benchmark: its name, if it has to be run for every number of threads, if it is a cv one, and how to run it on a fts
+*/
+struct bench_case
+{
+  std::string name;
+  bool threaded;
+  bool cv;
+  std::function<bench_result(const KO_Traits::StoringMatrix &, int, int)> run;
+};
+
+
+//a PPCKO without cv, moments and regularized covariance already computed
+template<SOLVER solver, K_IMP k_imp>
+using bench_ppcko = PPC_KO_NoCV<solver,k_imp,VALID_ERR_RET::NO_err,CV_STRAT::AUGMENTING_WINDOW,CV_ERR_EVAL::MSE>;
+
+
+/*!
+* @brief Building a PPCKO without cv on a copy of the fts
+*/
+template<SOLVER solver, K_IMP k_imp>
+bench_ppcko<solver,k_imp>
+make_ppcko(const KO_Traits::StoringMatrix &X, int threads)
+{
+  if constexpr(k_imp == K_IMP::YES){  return bench_ppcko<solver,k_imp>(KO_Traits::StoringMatrix(X),bench_alpha,bench_k,threads);}
+  else{                               return bench_ppcko<solver,k_imp>(KO_Traits::StoringMatrix(X),bench_alpha,bench_threshold,threads);}
+}
+
+
+/*!
+* @brief Benchmark of PPC_retained
+*/
+template<SOLVER solver, K_IMP k_imp>
+bench_case
+case_ppc_retained(const std::string &name)
+{
+  return {name,true,false,[](const KO_Traits::StoringMatrix &X, int threads, int reps)
+    {
+      return measure_repeatable(reps,
+                                [&X,threads](){ return std::make_unique<bench_ppcko<solver,k_imp>>(make_ppcko<solver,k_imp>(X,threads));},
+                                [](auto &ppcko){ auto ppcs = ppcko->PPC_retained(); (void)ppcs;});
+    }};
+}
+
+
+/*!
+* @brief Benchmark of a method of a fitted PPCKO
+*/
+template<typename BODY>
+bench_case
+case_fitted(const std::string &name, BODY body)
+{
+  return {name,true,false,[body](const KO_Traits::StoringMatrix &X, int threads, int reps)
+    {
+      return measure_repeatable(reps,
+                                [&X,threads](){ auto ppcko = std::make_unique<bench_ppcko<SOLVER::ex_solver,K_IMP::YES>>(make_ppcko<SOLVER::ex_solver,K_IMP::YES>(X,threads));
+                                                ppcko->solve();
+                                                return ppcko;},
+                                body);
+    }};
+}
+
+
+//cv wrappers: k imposed, validation errors not stored
+template<template<SOLVER,K_IMP,VALID_ERR_RET,CV_STRAT,CV_ERR_EVAL> class CV>
+using bench_cv = CV<SOLVER::ex_solver,K_IMP::YES,VALID_ERR_RET::NO_err,CV_STRAT::AUGMENTING_WINDOW,CV_ERR_EVAL::MSE>;
+
+
+/*!
+* @brief Benchmark of the solve() of a cv wrapper: the moments are computed outside the timing
+* @param name name of the benchmark
+* @param make function building the cv wrapper from the fts, the smallest and the biggest training set and the number of threads
+*/
+template<typename MAKE>
+bench_case
+case_cv(const std::string &name, MAKE make)
+{
+  return {name,true,true,[make](const KO_Traits::StoringMatrix &X, int threads, int reps)
+    {
+      const int max_size_ts = static_cast<int>(X.cols()) - 1;
+      const int min_size_ts = std::max(2,max_size_ts - bench_cv_splits + 1);
+      return measure(reps,
+                     [&X,&make,min_size_ts,max_size_ts,threads](){ return make(KO_Traits::StoringMatrix(X),min_size_ts,max_size_ts,threads);},
+                     [](auto &cv){ cv->solve();});
+    }};
+}
+
+
+/*!
+* @brief Cv on both parameters performed coarse-to-fine, as 'KO_Factory::KO_solver_multires': moments and cv on every 'step'-th discrete evaluation,
+*        then on the full grid only for the coarse optimum and its closest candidates
+* @param X fts
+* @param alphas input space for the regularization parameter
+* @param k_s input space for the number of retained PPCs
+* @param step step of the coarse grid (1: cv on the full grid only)
+* @param threads number of threads
+*/
+void
+coarse_to_fine_cv(const KO_Traits::StoringMatrix &X, const std::vector<double> &alphas, const std::vector<int> &k_s, int step, int threads)
+{
+  const int max_size_ts = static_cast<int>(X.cols()) - 1;
+  const int min_size_ts = std::max(2,max_size_ts - bench_cv_splits + 1);
+  const std::vector<int> rows_coarse = coarse_rows({},X.rows(),X.rows(),step);
+  
+  std::vector<double> alphas_fine(alphas);
+  std::vector<int> k_s_fine(k_s);
+  if(!rows_coarse.empty())
+  {
+    const int k_max_coarse = std::max(1,static_cast<int>(rows_coarse.size())/2);
+    std::vector<int> k_s_coarse;
+    std::copy_if(k_s.cbegin(),k_s.cend(),std::back_inserter(k_s_coarse),[k_max_coarse](int k_cand){return k_cand <= k_max_coarse;});
+    if(k_s_coarse.empty()){  k_s_coarse.emplace_back(k_max_coarse);}
+    bench_cv<PPC_KO_CV_alpha_k> cv_coarse(KO_Traits::StoringMatrix(X(rows_coarse,Eigen::all)),alphas,k_s_coarse,bench_toll,min_size_ts,max_size_ts,threads);
+    cv_coarse.solve();
+    alphas_fine = refined_space(alphas,cv_coarse.alpha(),1);
+    k_s_fine    = refined_space(k_s,cv_coarse.k(),2);
+  }
+  
+  bench_cv<PPC_KO_CV_alpha_k> cv_fine(KO_Traits::StoringMatrix(X),alphas_fine,k_s_fine,bench_toll,min_size_ts,max_size_ts,threads);
+  cv_fine.solve();
+}
+
+
+/*!
+* @brief All the benchmarks
+*/
+std::vector<bench_case>
+bench_cases()
+{
+  const std::vector<double> alphas{1e-4,1e-3,1e-2,1e-1,1.0};
+  const std::vector<int>    k_s{1,2,3,4,5};
+
+  std::vector<bench_case> cases;
+
+  //estimator
+  cases.push_back({"PPC_KO_base/constructor",true,false,[](const KO_Traits::StoringMatrix &X, int threads, int reps)
+    {
+      return measure(reps,
+                     [&X](){ return KO_Traits::StoringMatrix(X);},
+                     [threads](KO_Traits::StoringMatrix &x){ bench_ppcko<SOLVER::ex_solver,K_IMP::YES> ppcko(std::move(x),bench_alpha,bench_k,threads); (void)ppcko;});
+    }});
+  cases.push_back(case_ppc_retained<SOLVER::ex_solver,K_IMP::YES>("PPC_retained/ex_solver/k_imp"));
+  cases.push_back(case_ppc_retained<SOLVER::ex_solver,K_IMP::NO>("PPC_retained/ex_solver/k_not_imp"));
+  cases.push_back(case_ppc_retained<SOLVER::gep_solver,K_IMP::YES>("PPC_retained/gep_solver/k_imp"));
+  cases.push_back(case_ppc_retained<SOLVER::gep_solver,K_IMP::NO>("PPC_retained/gep_solver/k_not_imp"));
+  cases.push_back({"KO_algo",true,false,[](const KO_Traits::StoringMatrix &X, int threads, int reps)
+    {
+      return measure_repeatable(reps,
+                                [&X,threads](){ return std::make_unique<bench_ppcko<SOLVER::ex_solver,K_IMP::YES>>(make_ppcko<SOLVER::ex_solver,K_IMP::YES>(X,threads));},
+                                [](auto &ppcko){ ppcko->KO_algo();});
+    }});
+  cases.push_back(case_fitted("prediction",[](auto &ppcko){ auto pred = ppcko->prediction(); (void)pred;}));
+  cases.push_back(case_fitted("scores",[](auto &ppcko){ auto sc = ppcko->scores(); (void)sc;}));
+  cases.push_back(case_fitted("sd_scores_dir_wei",[](auto &ppcko){ auto sd = ppcko->sd_scores_dir_wei(); (void)sd;}));
+
+  //cv
+  cases.push_back(case_cv("CV_alpha",[alphas](KO_Traits::StoringMatrix &&X, int min_size_ts, int max_size_ts, int threads)
+    { return std::make_unique<bench_cv<PPC_KO_CV_alpha>>(std::move(X),alphas,bench_k,min_size_ts,max_size_ts,threads);}));
+  cases.push_back(case_cv("CV_k",[k_s](KO_Traits::StoringMatrix &&X, int min_size_ts, int max_size_ts, int threads)
+    { std::vector<int> k_s_cv(k_s); return std::make_unique<bench_cv<PPC_KO_CV_k>>(std::move(X),k_s_cv,bench_alpha,bench_toll,min_size_ts,max_size_ts,threads);}));
+  cases.push_back(case_cv("CV_alpha_k",[alphas,k_s](KO_Traits::StoringMatrix &&X, int min_size_ts, int max_size_ts, int threads)
+    { return std::make_unique<bench_cv<PPC_KO_CV_alpha_k>>(std::move(X),alphas,k_s,bench_toll,min_size_ts,max_size_ts,threads);}));
+  //coarse-to-fine cv against the one on the full grid: moments included in the timing, since the coarse pass estimates its own
+  for(int step : {1, 2, 4})
+  {
+    cases.push_back({"CV_alpha_k/coarse_step_" + std::to_string(step),true,true,[alphas,k_s,step](const KO_Traits::StoringMatrix &X, int threads, int reps)
+      {
+        return measure(reps,
+                       [](){ return 0;},
+                       [&X,&alphas,&k_s,step,threads](int){ coarse_to_fine_cv(X,alphas,k_s,step,threads);});
+      }});
+  }
+
+  //ADF test: lag order as in the R interface
+  cases.push_back({"adf::test",false,false,[](const KO_Traits::StoringMatrix &X, int, int reps)
+    {
+      const int lag = static_cast<int>(std::trunc(std::cbrt(static_cast<double>(X.cols())-1)));
+      return measure(reps,
+                     [&X,lag](){ return std::make_unique<adf<CaseLagOrderADF>>(KO_Traits::StoringMatrix(X),lag > 1 ? lag : 0);},
+                     [](auto &adf_t){ adf_t->test();});
+    }});
+
+  //data ingestion: replacing the missing evaluations, as done by 'reader_data' once mapped the R matrix
+  cases.push_back({"reader_data/removing_nan/MR",false,false,[](const KO_Traits::StoringMatrix &X, int, int reps)
+    {
+      const KO_Traits::StoringMatrix X_nan = synthetic_fts_nan(X);
+      return measure(reps,
+                     [&X_nan](){ return std::make_unique<removing_nan<double,REM_NAN::MR>>(KO_Traits::StoringMatrix(X_nan));},
+                     [](auto &rem){ rem->remove_nan();});
+    }});
+  cases.push_back({"reader_data/removing_nan/ZR",false,false,[](const KO_Traits::StoringMatrix &X, int, int reps)
+    {
+      const KO_Traits::StoringMatrix X_nan = synthetic_fts_nan(X);
+      return measure(reps,
+                     [&X_nan](){ return std::make_unique<removing_nan<double,REM_NAN::ZR>>(KO_Traits::StoringMatrix(X_nan));},
+                     [](auto &rem){ rem->remove_nan();});
+    }});
+
+  return cases;
+}
+
+
+int
+main(int argc, char** argv)
+{
+  bench_config config;
+  try
+  {
+    config = parse_config(argc,argv);
+  }
+  catch(const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "Usage: ppcko_bench [--m 100,1000] [--n 100,1000] [--threads 1,2,4] [--reps 5] [--cv-max-m 1000] [--filter regex] [--out file.json] [--full]" << std::endl;
+    return 1;
+  }
+
+  const std::regex filter(config.filter);
+  const auto cases = bench_cases();
+  std::vector<bench_result> results;
+
+  for(int m : config.m_s)
+  {
+    for(int n : config.n_s)
+    {
+      const KO_Traits::StoringMatrix X = synthetic_fts(m,n);
+
+      for(const auto &bc : cases)
+      {
+        if(!std::regex_search(bc.name,filter) || (bc.cv && m > config.cv_max_m)){  continue;}
+
+        const std::vector<int> threads = bc.threaded ? config.threads : std::vector<int>{1};
+        for(int thr : threads)
+        {
+          std::cerr << bc.name << " (m = " << m << ", n = " << n << ", threads = " << thr << ")" << std::endl;
+          bench_result res = bc.run(X,thr,config.reps);
+          res.name    = bc.name;
+          res.m       = m;
+          res.n       = n;
+          res.threads = thr;
+          results.emplace_back(std::move(res));
+        }
+      }
+    }
+  }
+
+  const std::vector<std::pair<std::string,std::string>> context{
+    {"date",utc_now()},
+    {"parallel_backend",KO_Parallel::backend_name()},
+    {"max_threads",std::to_string(KO_Parallel::max_threads())},
+    {"compiler",__VERSION__},
+    {"eigen",std::to_string(EIGEN_WORLD_VERSION) + "." + std::to_string(EIGEN_MAJOR_VERSION) + "." + std::to_string(EIGEN_MINOR_VERSION)},
+    {"build_type",KO_BENCH_BUILD_TYPE}};
+
+  if(config.out.empty())
+  {
+    write_json(std::cout,context,results);
+  }
+  else
+  {
+    std::ofstream out(config.out);
+    write_json(out,context,results);
+  }
+
+  return 0;
+}
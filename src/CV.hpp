@@ -35,11 +35,9 @@
 
 #include "traits_ko.hpp"
 #include "strategy_cv.hpp"
+#include "compressed_fts.hpp"
 #include "cv_eval_valid_err.hpp"
-
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include "threading_policy.hpp"
 
 /*!
 * @file CV.hpp
@@ -56,10 +54,10 @@ template <CV_ERR_EVAL err_eval>
 using ERR_EVAL_T = std::integral_constant<CV_ERR_EVAL, err_eval>;
 
 
-/*!Type for the function that predicts the validation set: k imposed: pass data, alpha and k*/
-using pred_func_k_yes_t = std::function<KO_Traits::StoringVector(KO_Traits::StoringMatrix,double,int,int)>;
-/*!Type for the function that predicts the validation set: k not imposed: pass data, alpha and threshold_ppc*/
-using pred_func_k_no_t  = std::function<KO_Traits::StoringVector(KO_Traits::StoringMatrix,double,double,int)>;
+/*!Type for the function that predicts the validation set: k imposed: pass data (view on the training set), alpha and k. The prediction is valid until the next one of the calling thread*/
+using pred_func_k_yes_t = std::function<const KO_Traits::StoringVector &(const Eigen::Ref<const KO_Traits::StoringMatrix> &,double,int,int)>;
+/*!Type for the function that predicts the validation set: k not imposed: pass data (view on the training set), alpha and threshold_ppc. The prediction is valid until the next one of the calling thread*/
+using pred_func_k_no_t  = std::function<const KO_Traits::StoringVector &(const Eigen::Ref<const KO_Traits::StoringMatrix> &,double,double,int)>;
 
 /*!
 * Type for the prediction function on validation set: depending on
@@ -88,20 +86,46 @@ class CV_base
   
 private:
 
-  /*!Matrix storing fts*/
-  KO_Traits::StoringMatrix m_Data;
+  /*!Matrix storing fts (compressed if compiled with KO_COMPRESSED_FTS)*/
+  cv_storing_t m_Data;
   
   /*!Strategy for splitting training/validation set*/ 
   cv_strategy<cv_strat> m_strategy;
 
+  /*!Weights of the evaluations for the weighted L2 loss (only for 'CV_ERR_EVAL::WEIGHTED_MSE')*/
+  KO_Traits::StoringVector m_err_weights;
+
+  /*!
+  * @brief Evaluation of the loss between prediction on validation set and validation set
+  * @param pred prediction on validation set
+  * @param valid validation set
+  * @return the error between prediction on validation set and validation set
+  */
+  double err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::MSE>) const;
+  
   /*!
   * @brief Evaluation of the loss between prediction on validation set and validation set
   * @param pred prediction on validation set
   * @param valid validation set
-  * @param number_threads number of threads for multi-threading
   * @return the error between prediction on validation set and validation set
   */
-  double err_valid_set_eval(const KO_Traits::StoringVector &pred, const KO_Traits::StoringVector &valid, int number_threads, ERR_EVAL_T<CV_ERR_EVAL::MSE>) const;
+  double err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::MAE>) const;
+  
+  /*!
+  * @brief Evaluation of the loss between prediction on validation set and validation set
+  * @param pred prediction on validation set
+  * @param valid validation set
+  * @return the error between prediction on validation set and validation set
+  */
+  double err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::WEIGHTED_MSE>) const;
+  
+  /*!
+  * @brief Evaluation of the loss between prediction on validation set and validation set
+  * @param pred prediction on validation set
+  * @param valid validation set
+  * @return the error between prediction on validation set and validation set
+  */
+  double err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::RELATIVE_MSE>) const;
   
   /*!Number of threads for OMP*/
   int m_number_threads;
@@ -117,19 +141,30 @@ public:
   */
   template<typename STOR_OBJ,typename STRATEGY>
   CV_base(STOR_OBJ&& Data, STRATEGY && strategy, int number_threads)
-    : m_Data{std::forward<STOR_OBJ>(Data)}, m_strategy{std::forward<STRATEGY>(strategy)}, m_number_threads(number_threads)  {}
+    : m_Data{std::forward<STOR_OBJ>(Data)}, m_strategy{std::forward<STRATEGY>(strategy)}, m_number_threads(number_threads)  
+    {
+      //weighted loss: each evaluation weighted by the inverse of its variance along the whole fts
+      if constexpr(err_eval == CV_ERR_EVAL::WEIGHTED_MSE)
+      {
+#ifdef KO_COMPRESSED_FTS
+        m_err_weights = inverse_pointwise_variance(m_Data.decode(0,m_Data.cols()));
+#else
+        m_err_weights = inverse_pointwise_variance(m_Data);
+#endif
+      }
+    }
   
   /*!
   * @brief Getter for the data matrix
   * @return the private m_Data
   */
-  inline KO_Traits::StoringMatrix Data() const {return m_Data;}
+  inline const cv_storing_t & Data() const {return m_Data;}
   
   /*!
   * @brief Getter for the training/validation set splitting
   * @return the private m_strategy
   */
-  inline cv_strategy<cv_strat> strategy() const {return m_strategy;}
+  inline const cv_strategy<cv_strat> & strategy() const {return m_strategy;}
   
   /*!
   * @brief Getter for the number of threads for OMP
@@ -138,13 +173,24 @@ public:
   inline int number_threads() const {return m_number_threads;}
   
   /*!
-  * @brief Evaluation of the loss between prediction on validation set and validation set: estimate of L2 norm loss. Tag-dispacther.
+  * @brief Getter for the weights of the evaluations in the weighted L2 loss
+  * @return the private m_err_weights
+  */
+  inline const KO_Traits::StoringVector & err_weights() const {return m_err_weights;}
+  
+  /*!
+  * @brief Setter for the weights of the evaluations in the weighted L2 loss
+  * @return the private m_err_weights (non-const)
+  */
+  inline KO_Traits::StoringVector & err_weights() {return m_err_weights;}
+  
+  /*!
+  * @brief Evaluation of the loss between prediction on validation set and validation set, according to 'err_eval'. Tag-dispacther.
   * @param pred prediction on validation set
   * @param valid validation set
-  * @param number_threads number of threads for multi-threading
   * @return the error between prediction on validation set and validation set
   */
-  double err_valid_set_eval(const KO_Traits::StoringVector &pred, const KO_Traits::StoringVector &valid, int number_threads) const { return err_valid_set_eval(pred,valid,number_threads,ERR_EVAL_T<err_eval>{});};
+  double err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid) const { return err_valid_set_eval(pred,valid,ERR_EVAL_T<err_eval>{});};
   
 };
 
@@ -21,8 +21,22 @@
 #define CV_CRTP_ALPHA_PPC_HPP
 
 #include "CV.hpp"
+#include "cv_budget.hpp"
+#include "cv_shard.hpp"
+#include <cmath>
+#include <limits>
 
 
+/*!Tolerance, on log10 of the regularization parameter, of the continuous cv on it (can be set at compile time)*/
+#ifndef KO_CV_ALPHA_CONT_TOLL
+#define KO_CV_ALPHA_CONT_TOLL 1e-2
+#endif
+
+/*!Maximum number of validation errors evaluated by the continuous cv on the regularization parameter (can be set at compile time)*/
+#ifndef KO_CV_ALPHA_CONT_MAX_EVALS
+#define KO_CV_ALPHA_CONT_MAX_EVALS 30
+#endif
+
 
 /*!
 * @file CV_alpha.hpp
@@ -59,6 +73,12 @@ private:
   double m_threshold_ppc = 0.0;
   /*!Function to predict validation set*/
   pred_func_t<k_imp> m_pred_f;             
+  /*!Number of fits (pairs parameter-split) performed by the successive halving cv*/
+  std::size_t m_fits = 0;
+  /*!Number of fits saved by the successive halving cv with respect to the whole grid*/
+  std::size_t m_fits_saved = 0;
+  /*!Time budget of the cv on the grid*/
+  cv_budget m_budget;
   
 
 public:
@@ -71,6 +91,7 @@ public:
   * @param k number of retained PPCs
   * @param pred_f function to make validation set prediction (overloading with k imposed)
   * @param number_threads number of threads for OMP
+  * @param budget time budget of the cv on the grid
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   */
   template<typename STOR_OBJ,typename STRATEGY>
@@ -79,11 +100,13 @@ public:
            const std::vector<double> &params,
            int k,
            const pred_func_t<k_imp> & pred_f,
-           int number_threads)
+           int number_threads,
+           const cv_budget &budget = cv_budget())
     : CV_base<CV_alpha,cv_strat,err_eval,k_imp,valid_err_ret>(std::move(Data),std::move(strategy),number_threads), 
       m_params(params), 
       m_k(k),
-      m_pred_f(pred_f)
+      m_pred_f(pred_f),
+      m_budget(budget)
       {}
   
   
@@ -95,6 +118,7 @@ public:
   * @param threshold_ppc requested explanatory power for PPCs
   * @param pred_f function to make validation set prediction (overloading with k not imposed)
   * @param number_threads number of threads for OMP
+  * @param budget time budget of the cv on the grid
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   */
   template<typename STOR_OBJ,typename STRATEGY>
@@ -103,11 +127,13 @@ public:
            const std::vector<double> &params,
            double threshold_ppc,
            const pred_func_t<k_imp> & pred_f,
-           int number_threads)
+           int number_threads,
+           const cv_budget &budget = cv_budget())
     : CV_base<CV_alpha,cv_strat,err_eval,k_imp,valid_err_ret>(std::move(Data),std::move(strategy),number_threads), 
       m_params(params), 
       m_threshold_ppc(threshold_ppc),
-      m_pred_f(pred_f)
+      m_pred_f(pred_f),
+      m_budget(budget)
       {}
   
   
@@ -117,6 +143,12 @@ public:
   */
   inline double param_best() const {return m_param_best;};
   
+  /*!
+  * @brief Getter for the input space for regularization parameter
+  * @return the private m_params (after a continuous cv: the validated regularization parameters, in ascending order)
+  */
+  inline std::vector<double> params() const {return m_params;};
+  
   /*!
   * @brief Getter for validation errors
   * @return the private m_valid_errors
@@ -129,73 +161,93 @@ public:
   */
   inline double best_valid_error() const {return m_best_valid_error;};
   
+  /*!
+  * @brief Getter for the number of fits performed by the successive halving cv
+  * @return the private m_fits
+  */
+  inline std::size_t fits() const {return m_fits;};
+  
+  /*!
+  * @brief Getter for the number of fits saved by the successive halving cv
+  * @return the private m_fits_saved
+  */
+  inline std::size_t fits_saved() const {return m_fits_saved;};
+  
   
   /*!
    * @brief Error for a single cross-validation iteration (parameter given), with fixed training and validation sets
    * @param param parameter that is being evaluated through cross-validation
-   * @param training_set training set
-   * @param validation_set validation set
+   * @param training_set training set (view)
+   * @param validation_set validation set (view)
    * @return the error, according to 'err_eval' class template parameter, between prediction on validation set and validation set
    */
    inline 
    double 
-   error_single_cv_iter(const double &param, const KO_Traits::StoringMatrix &training_set, const KO_Traits::StoringMatrix &validation_set)
+   error_single_cv_iter(const double &param, const Eigen::Ref<const KO_Traits::StoringMatrix> &training_set, const Eigen::Ref<const KO_Traits::StoringVector> &validation_set)
    const
    {  
       //traiing the model, making the prediction and then evaluating it
       if constexpr( k_imp == YES)     //k is imposed
       {
-        auto pred = m_pred_f(training_set,param,m_k,this->number_threads());
-        return this->err_valid_set_eval(pred,validation_set,this->number_threads());
+        const auto &pred = m_pred_f(training_set,param,m_k,this->number_threads());
+        return this->err_valid_set_eval(pred,validation_set);
       }
       else                            //explanatory power for retained PPCs
       {
-        auto pred = m_pred_f(training_set,param,m_threshold_ppc,this->number_threads());
-        return this->err_valid_set_eval(pred,validation_set,this->number_threads());
+        const auto &pred = m_pred_f(training_set,param,m_threshold_ppc,this->number_threads());
+        return this->err_valid_set_eval(pred,validation_set);
       } 
    }
    
    
+   /*!
+   * @brief Sum of the errors on the various validation sets, for a given parameter
+   * @param param element of the input space for regularization parameter
+   * @param strat strategy for splitting training and validation set
+   * @param number_cv_iter total number of different splits
+   * @return the sum of the errors between prediction on validation set and validation set, and the number of splits with an error
+   *         (the ones without evaluations in the validation set are skipped)
+   * @note parallel loops through 'KO_Parallel'
+   */
+   inline 
+   std::pair<double,std::size_t>
+   error_splits(const double &param, const cv_strategy_t &strat, const std::size_t &number_cv_iter) 
+   const
+   { 
+     //going parallel over the splits
+     std::vector<double> errors(number_cv_iter);
+     KO_Parallel::parallel_for(number_cv_iter,
+                               threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                               [this,&param,&strat,&errors](std::size_t i){ auto train_valid_set = this->strategy().train_validation_set(this->Data(),strat[i]); errors[i] = this->error_single_cv_iter(param,train_valid_set.first,train_valid_set.second);});
+     
+     return valid_splits_sum(errors);
+   }
+   
+   
    /*!
    * @brief Validation error for a given parameter, as the mean of the errors on the various validation sets
    * @param param element of the input space for regularization parameter
    * @param strat strategy for splitting training and validation set
    * @param number_cv_iter total number of different splits
-   * @return the average of the errors between prediction on validation set and validation set, for each split
-   * @note eventual usage of 'pragma' directive for OMP
+   * @return the average of the errors between prediction on validation set and validation set, over the splits with an error (NaN if none)
    */
    inline 
    double                                 
    error_single_param(const double &param, const cv_strategy_t &strat, const std::size_t &number_cv_iter) 
    const
    { 
-     double err = 0.0;
-     
-     //if OMP: going parallel
-#ifdef _OPENMP
-#pragma omp parallel for shared(param,strat) num_threads(this->number_threads()) reduction(+:err)
-     for (int i = 0; i < number_cv_iter; ++i)
-     {
-       auto train_valid_set = this->strategy().train_validation_set(this->Data(),strat[i]); 
-       err += this->error_single_cv_iter(param,train_valid_set.first,train_valid_set.second);
-     }
-#else     
-     // if not OMP: STL algorithms: transform_reduce to apply at each split the evaluation of the prediction and then summing them up
-     err = std::transform_reduce(strat.cbegin(),
-                                 strat.cend(),
-                                 0.0,
-                                 std::plus{},
-                                 [this,&param](auto el){ auto train_valid_set = this->strategy().train_validation_set(this->Data(),el); return this->error_single_cv_iter(param,train_valid_set.first,train_valid_set.second);});
-#endif
+     const auto [err,valid_splits] = this->error_splits(param,strat,number_cv_iter);
      
      //returning the average
-     return err/(static_cast<double>(number_cv_iter));
+     return valid_splits > 0 ? err/static_cast<double>(valid_splits) : std::numeric_limits<double>::quiet_NaN();
    }
    
   
   /*!
   * @brief Selecting the best regularization parameter, modifying it into the class
-  * @note eventual usage of 'pragma' directive for OMP
+  * @details If the cv is time-budgeted, the input space is evaluated coarse grid first, and the best parameter is the best one among the 
+  *          evaluated ones when the budget expires (the validation error of the ones not evaluated is NaN)
+  * @note parallel loops through 'KO_Parallel'
   */
   inline 
   void 
@@ -206,23 +258,67 @@ public:
     //preparing the container for the errors: resize to use transform
     m_valid_errors.resize(tot_params);
 
-    //if OMP: going parallel
-#ifdef _OPENMP
-#pragma omp parallel for shared(m_params,tot_params) num_threads(this->number_threads())
+    //time-budgeted: coarse grid first, until the budget expires
+    if(m_budget.active())
+    {
+      std::fill(m_valid_errors.begin(),m_valid_errors.end(),std::numeric_limits<double>::quiet_NaN());
+      budgeted_evaluation(m_budget,
+                          coarse_first_order(tot_params),
+                          threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                          [this](std::size_t i){ m_valid_errors[i] = this->error_single_param(m_params[i],this->strategy().strategy(),this->strategy().strategy().size());});
+    }
+    else
+    {
+      //going parallel over the input space
+      KO_Parallel::parallel_for(tot_params,
+                                threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                                [this](std::size_t i){ m_valid_errors[i] = this->error_single_param(m_params[i],this->strategy().strategy(),this->strategy().strategy().size());});
+    }
+    
+    this->select_best();
+  }
+  
+  
+  /*!
+  * @brief Selecting the best regularization parameter, evaluating the grid of pairs parameter-split sharded across local worker processes, modifying it into the class
+  * @param number_processes number of worker processes
+  * @details See 'sharded_evaluation': the cv is constructed with one thread, since the workers take the place of the threads
+  */
+  inline 
+  void 
+  best_param_search_sharded(int number_processes) 
+  { 
+    const cv_strategy_t &splits = this->strategy().strategy();
+    const std::size_t tot_params = m_params.size();
+    const std::size_t tot_splits = splits.size();
+    
+    //cell: parameter (slow index), split (fast index)
+    auto errors = sharded_evaluation(tot_params*tot_splits,
+                                     number_processes,
+                                     [this,&splits,tot_splits](std::size_t cell){ 
+                                       auto train_valid_set = this->strategy().train_validation_set(this->Data(),splits[cell % tot_splits]); 
+                                       return this->error_single_cv_iter(m_params[cell / tot_splits],train_valid_set.first,train_valid_set.second);});
+    
+    //validation errors: average over the splits
+    m_valid_errors.resize(tot_params);
     for(std::size_t i = 0; i < tot_params; ++i)
     {
-      m_valid_errors[i] = this->error_single_param(m_params[i],this->strategy().strategy(),this->strategy().strategy().size());
+      m_valid_errors[i] = valid_splits_mean(std::vector<double>(errors.cbegin() + i*tot_splits,errors.cbegin() + (i + 1)*tot_splits));
     }
-#else
-    // if not OMP: STL algorithms: transform to apply at each element the input space the function to retain their validation error
-    std::transform(m_params.cbegin(),
-                   m_params.cend(),
-                   m_valid_errors.begin(),
-                   [this](double const &param_i){return this->error_single_param(param_i,this->strategy().strategy(),this->strategy().strategy().size());});
-#endif
     
-    //best validation error
-    auto min_err = (std::min_element(m_valid_errors.begin(),m_valid_errors.end()));
+    this->select_best();
+  }
+  
+  
+  /*!
+  * @brief Selecting the best regularization parameter, among the ones with a validation error, once they are evaluated
+  */
+  inline 
+  void 
+  select_best()
+  {
+    //best validation error (among the evaluated parameters)
+    auto min_err = (std::min_element(m_valid_errors.begin(),m_valid_errors.end(),[](double e1, double e2){return !std::isnan(e1) && (std::isnan(e2) || e1 < e2);}));
     m_best_valid_error = *min_err;
     
     //optimal param
@@ -235,6 +331,187 @@ public:
     }
   }
   
+  
+  /*!
+  * @brief Selecting the best regularization parameter through successive halving, modifying it into the class
+  * @details The splits are visited with strides 2^R, 2^(R-1), ..., 1, so that each subset contains the previous one. At each round, the 
+  *          surviving parameters are validated only on the new splits, and the best half (according to the average error on the splits 
+  *          seen so far) survives. R is the smallest number of halvings leaving one parameter, as long as the first subset is not empty.
+  *          The best parameter is selected among the ones validated on all the splits. The validation error of each parameter is averaged 
+  *          over the splits on which it has been validated
+  * @note parallel loops through 'KO_Parallel'
+  */
+  inline 
+  void 
+  best_param_search_halving() 
+  { 
+    const cv_strategy_t &splits = this->strategy().strategy();
+    const std::size_t tot_params = m_params.size();
+    const std::size_t tot_splits = splits.size();
+    
+    //number of halvings
+    std::size_t rounds = 0;
+    while((std::size_t{1} << (rounds + 1)) <= tot_splits && (std::size_t{1} << rounds) < tot_params){  ++rounds;}
+    
+    //sum of the errors and number of splits on which each parameter has been validated
+    std::vector<double> err_sum(tot_params,0.0);
+    std::vector<std::size_t> splits_seen(tot_params,0);
+    std::vector<std::size_t> survivors(tot_params);
+    std::iota(survivors.begin(),survivors.end(),static_cast<std::size_t>(0));
+    m_fits = 0;
+    
+    //average error over the splits seen (NaN if none of them has a valid evaluation)
+    auto mean_err = [&err_sum,&splits_seen](std::size_t p){ return splits_seen[p] > 0 ? err_sum[p]/static_cast<double>(splits_seen[p]) : std::numeric_limits<double>::quiet_NaN();};
+    
+    for(std::size_t r = 0; r <= rounds; ++r)
+    {
+      //new splits of this round: the ones with stride 2^(R-r) not yet visited
+      const std::size_t stride = std::size_t{1} << (rounds - r);
+      cv_strategy_t new_splits;
+      for(std::size_t j = 0; j < tot_splits; j += stride)
+      {
+        if(r == 0 || j % (2*stride) != 0){  new_splits.emplace_back(splits[j]);}
+      }
+      
+      //validating the surviving parameters on the new splits
+      KO_Parallel::parallel_for(survivors.size(),
+                                threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                                [this,&survivors,&new_splits,&err_sum,&splits_seen](std::size_t i)
+                                {
+                                  const std::size_t p = survivors[i];
+                                  const auto [err,valid_splits] = this->error_splits(m_params[p],new_splits,new_splits.size());
+                                  err_sum[p] += err;
+                                  splits_seen[p] += valid_splits;
+                                });
+      m_fits += survivors.size()*new_splits.size();
+      
+      //retaining the best half (parameters without errors, since no evaluation is available in their splits, last)
+      std::stable_sort(survivors.begin(),survivors.end(),[&mean_err](std::size_t p1, std::size_t p2){ const double e1 = mean_err(p1), e2 = mean_err(p2); return !std::isnan(e1) && (std::isnan(e2) || e1 < e2);});
+      if(r < rounds){  survivors.resize((survivors.size() + 1)/2);}
+    }
+    m_fits_saved = tot_params*tot_splits - m_fits;
+    
+    //best validation error and optimal param, among the ones validated on all the splits
+    m_best_valid_error = mean_err(survivors.front());
+    m_param_best = m_params[survivors.front()];
+    
+    //errors averaged over the splits seen (NaN for the parameters without valid splits)
+    if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
+    {
+      m_valid_errors.resize(tot_params);
+      for(std::size_t p = 0; p < tot_params; ++p){  m_valid_errors[p] = mean_err(p);}
+    }
+  }
+  
+  
+  /*!
+  * @brief Selecting the best regularization parameter within the interval spanned by the input space, modifying it into the class
+  * @details Brent's method (golden section search with parabolic interpolation) minimizes the validation error over log10 of the regularization parameter,
+  *          up to a tolerance of KO_CV_ALPHA_CONT_TOLL, with at most KO_CV_ALPHA_CONT_MAX_EVALS validation errors evaluated.
+  *          The input space is then replaced by the validated regularization parameters, in ascending order, and the validation errors by theirs
+  */
+  inline 
+  void 
+  best_param_search_continuous() 
+  { 
+    const double toll = KO_CV_ALPHA_CONT_TOLL;
+    const double golden = 0.5*(3.0 - std::sqrt(5.0));
+    
+    //validated parameters and their errors
+    std::vector<std::pair<double,double>> evaluations;
+    evaluations.reserve(KO_CV_ALPHA_CONT_MAX_EVALS);
+    auto valid_error = [this,&evaluations](double log_param){ 
+      double param = std::pow(10.0,log_param); 
+      double err = this->error_single_param(param,this->strategy().strategy(),this->strategy().strategy().size()); 
+      evaluations.emplace_back(param,err); 
+      return err;};
+    
+    //searching interval, on log10 of the regularization parameter
+    double a = std::log10(m_params.front());
+    double b = std::log10(m_params.back());
+    
+    //x: best point, w: second best, v: previous w
+    double x = a + golden*(b - a);
+    double w = x;
+    double v = x;
+    double f_x = valid_error(x);
+    double f_w = f_x;
+    double f_v = f_x;
+    double d = 0.0;
+    double e = 0.0;
+    
+    while(evaluations.size() < static_cast<std::size_t>(KO_CV_ALPHA_CONT_MAX_EVALS))
+    {
+      const double mid = 0.5*(a + b);
+      if(std::abs(x - mid) <= 2.0*toll - 0.5*(b - a)){  break;}
+      
+      bool golden_step = true;
+      if(std::abs(e) > toll)
+      {
+        //parabola through x, w, v
+        double r = (x - w)*(f_x - f_v);
+        double q = (x - v)*(f_x - f_w);
+        double p = (x - v)*q - (x - w)*r;
+        q = 2.0*(q - r);
+        if(q > 0.0){  p = -p;}  else{  q = -q;}
+        const double e_old = e;
+        e = d;
+        
+        //accepted only if within the interval and shrinking
+        if(std::abs(p) < std::abs(0.5*q*e_old) && p > q*(a - x) && p < q*(b - x))
+        {
+          d = p/q;
+          if((x + d) - a < 2.0*toll || b - (x + d) < 2.0*toll){  d = x < mid ? toll : -toll;}
+          golden_step = false;
+        }
+      }
+      if(golden_step)
+      {
+        e = (x < mid ? b : a) - x;
+        d = golden*e;
+      }
+      
+      const double u = x + (std::abs(d) >= toll ? d : (d > 0.0 ? toll : -toll));
+      const double f_u = valid_error(u);
+      
+      //updating the interval and the points
+      if(f_u <= f_x)
+      {
+        if(u < x){  b = x;}  else{  a = x;}
+        v = w;  f_v = f_w;
+        w = x;  f_w = f_x;
+        x = u;  f_x = f_u;
+      }
+      else
+      {
+        if(u < x){  a = u;}  else{  b = u;}
+        if(f_u <= f_w || w == x)
+        {
+          v = w;  f_v = f_w;
+          w = u;  f_w = f_u;
+        }
+        else if(f_u <= f_v || v == x || v == w)
+        {
+          v = u;  f_v = f_u;
+        }
+      }
+    }
+    
+    //best validation error and optimal param
+    m_best_valid_error = f_x;
+    m_param_best = std::pow(10.0,x);
+    
+    //validated parameters, in ascending order, and their errors
+    std::sort(evaluations.begin(),evaluations.end());
+    m_params.resize(evaluations.size());
+    std::transform(evaluations.cbegin(),evaluations.cend(),m_params.begin(),[](const auto &ev){return ev.first;});
+    if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
+    {
+      m_valid_errors.resize(evaluations.size());
+      std::transform(evaluations.cbegin(),evaluations.cend(),m_valid_errors.begin(),[](const auto &ev){return ev.second;});
+    }
+  }
+  
 };
                            
 
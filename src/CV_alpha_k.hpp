@@ -22,6 +22,10 @@
 
 #include "CV.hpp"
 #include "CV_alpha_k.hpp"
+#include "cv_budget.hpp"
+#include "cv_shard.hpp"
+#include <cmath>
+#include <limits>
 
 
 /*!
@@ -69,6 +73,10 @@ private:
   double m_toll;
   /*!Function to predict validation set*/
   pred_func_t<K_IMP::YES> m_pred_f;               
+  /*!Time budget of the cv*/
+  cv_budget m_budget;
+  /*!Cache of the validation errors for each pair and split (not used if nullptr)*/
+  cv_cache *m_cache;
   
 
 public:
@@ -82,6 +90,8 @@ public:
   * @param toll tolerance between consecutive validation errors for looking for element with bigger value in the input space
   * @param pred_f function to make validation set prediction (overloading with k imposed)
   * @param number_threads number of threads for OMP
+  * @param budget time budget of the cv
+  * @param cache cache of the validation errors for each pair and split (not used if nullptr)
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   */
   template<typename STOR_OBJ,typename STRATEGY>
@@ -91,12 +101,16 @@ public:
              const std::vector<int> &k_s,
              double toll,
              const pred_func_t<K_IMP::YES> & pred_f,
-             int number_threads)
+             int number_threads,
+             const cv_budget &budget = cv_budget(),
+             cv_cache *cache = nullptr)
     : CV_base<CV_alpha_k,cv_strat,err_eval,k_imp,valid_err_ret>(std::move(Data),std::move(strategy),number_threads), 
       m_alphas(alphas),
       m_k_s(k_s),
       m_toll(toll),
-      m_pred_f(pred_f)
+      m_pred_f(pred_f),
+      m_budget(budget),
+      m_cache(cache)
       {}
   
   
@@ -134,8 +148,10 @@ public:
   /*!
   * @brief Retaining the best pair regularization parameter-number of retained PPCs
   * @details for each element of the input space for regularization parameters, a cross-validation on the number of retained PPCs is performed.
-  *          Consequently, the best pair is looked for within this ones.
-  * @note eventual usage of 'pragma' directive for OMP
+  *          Consequently, the best pair is looked for within this ones. If the cv is time-budgeted, the regularization parameters are evaluated
+  *          coarse grid first, and the best pair is looked for among the evaluated ones when the budget expires (the validation errors of the 
+  *          ones not evaluated are empty)
+  * @note parallel loops through 'KO_Parallel'
   */
   inline 
   void 
@@ -143,8 +159,44 @@ public:
   {
     std::size_t tot_alphas = m_alphas.size();
     
-    //if OMP: going parallel
-#ifdef _OPENMP
+    //time-budgeted: coarse grid first, until the budget expires
+    if(m_budget.active())
+    {
+      if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
+      {
+        m_valid_errors.resize(tot_alphas);
+      }
+      m_valid_errors_best_pairs.assign(tot_alphas,std::numeric_limits<double>::quiet_NaN());
+      std::vector<int> k_best_alpha(tot_alphas);
+      
+      auto done = budgeted_evaluation(m_budget,
+                                      coarse_first_order(tot_alphas),
+                                      threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                                      [this,&k_best_alpha](std::size_t i)
+                                      {
+                                        //alpha fixed: doing CV on k
+                                        CV_k<cv_strat,err_eval,k_imp,valid_err_ret> cv(std::move(this->Data()),std::move(this->strategy()),m_k_s,m_toll,m_alphas[i],m_pred_f,this->number_threads(),m_cache);
+                                        cv.best_param_search();
+                                        k_best_alpha[i] = cv.param_best();
+                                        m_valid_errors_best_pairs[i] = cv.best_valid_error();
+                                        if constexpr(valid_err_ret == VALID_ERR_RET::YES_err){  m_valid_errors[i] = cv.valid_errors();}
+                                      });
+      
+      //best k given each evaluated alpha
+      for(std::size_t i = 0; i < tot_alphas; ++i)
+      {
+        if(done[i]){  m_best_pairs.insert(std::make_pair(m_alphas[i],k_best_alpha[i]));}
+      }
+      
+      //best validation error (among the evaluated alphas)
+      auto min_err = std::min_element(m_valid_errors_best_pairs.begin(),m_valid_errors_best_pairs.end(),[](double e1, double e2){return !std::isnan(e1) && (std::isnan(e2) || e1 < e2);});
+      m_best_valid_error = *min_err;
+      m_alpha_best = m_alphas[std::distance(m_valid_errors_best_pairs.begin(),min_err)];
+      m_k_best = m_best_pairs.find(m_alpha_best)->second;
+      
+      return;
+    }
+    
     //preparing the containers for the errors
     if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
     {
@@ -152,61 +204,125 @@ public:
     }
     
     m_valid_errors_best_pairs.resize(tot_alphas); //for each alpha: valid error only for the best k
+    std::vector<int> k_best_alpha(tot_alphas);    //for each alpha: the best k
 
-#pragma omp parallel for shared(m_alphas,m_k_s,m_toll,m_pred_f,tot_alphas) num_threads(this->number_threads()) schedule(guided)
+    //going parallel over the regularization parameters: the cost of the cv on k varies with its stopping rule
+    KO_Parallel::parallel_for(tot_alphas,
+                              threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                              [this,&k_best_alpha](std::size_t i)
+                              {
+                                //alpha fixed: doing CV on k
+                                CV_k<cv_strat,err_eval,k_imp,valid_err_ret> cv(std::move(this->Data()),std::move(this->strategy()),m_k_s,m_toll,m_alphas[i],m_pred_f,this->number_threads(),m_cache);
+                                cv.best_param_search();
+                                
+                                //best k given the alpha
+                                k_best_alpha[i] = cv.param_best();
+                                //saving the validation error for the best pair
+                                m_valid_errors_best_pairs[i] = cv.best_valid_error();
+                                
+                                if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
+                                {
+                                  //saving the validation error for each pair (further inspection)
+                                  m_valid_errors[i] = cv.valid_errors();
+                                }
+                              },
+                              PAR_SCHEDULE::DYNAMIC);
+    
+    //best k given each alpha: the map is filled outside the parallel loop
     for(std::size_t i = 0; i < tot_alphas; ++i)
     {
-      //alpha fixed: doing CV on k
-      CV_k<cv_strat,err_eval,k_imp,valid_err_ret> cv(std::move(this->Data()),std::move(this->strategy()),m_k_s,m_toll,m_alphas[i],m_pred_f,this->number_threads());
-      cv.best_param_search();
-      
-      //best k given the alpha
-      m_best_pairs.insert(std::make_pair(m_alphas[i],cv.param_best()));
-      //saving the validation error for the best pair
-      m_valid_errors_best_pairs[i]=cv.best_valid_error();
-      
-      if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
-      {
-        //saving the validation error for each pair (further inspection)
-        m_valid_errors[i]=cv.valid_errors();
-      }
+      m_best_pairs.insert(std::make_pair(m_alphas[i],k_best_alpha[i]));
     }
-#else
+    
+    //best validation error (among the regularization parameters with an error)
+    auto min_err = std::min_element(m_valid_errors_best_pairs.begin(),m_valid_errors_best_pairs.end(),[](double e1, double e2){return !std::isnan(e1) && (std::isnan(e2) || e1 < e2);});
+    m_best_valid_error = *min_err;
+    
+    //best alpha
+    m_alpha_best = m_alphas[std::distance(m_valid_errors_best_pairs.begin(),min_err)];
+    
+    //best k
+    m_k_best = m_best_pairs.find(m_alpha_best)->second;
+  }
+  
+  
+  /*!
+  * @brief Retaining the best pair regularization parameter-number of retained PPCs, evaluating the grid of triplets regularization parameter-number of 
+  *        retained PPCs-split sharded across local worker processes
+  * @param number_processes number of worker processes
+  * @details See 'sharded_evaluation': the cv is constructed with one thread, since the workers take the place of the threads. The whole grid is evaluated
+  *          (apart from the triplets already in the cache), and then, for each regularization parameter, the cv on the number of retained PPCs applies 
+  *          its stopping rule on the evaluated errors: the result is the same of 'best_param_search()'
+  */
+  inline 
+  void 
+  best_param_search_sharded(int number_processes)
+  {
+    const cv_strategy_t &splits = this->strategy().strategy();
+    const std::size_t tot_alphas = m_alphas.size();
+    const std::size_t tot_k_s = m_k_s.size();
+    const std::size_t tot_splits = splits.size();
+    
+    std::vector<std::uint64_t> splits_fp(tot_splits,0);
+    if(m_cache){  std::transform(splits.cbegin(),splits.cend(),splits_fp.begin(),[](const auto &split){return split_fingerprint(split);});}
+    
+    //cell: alpha (slowest index), k, split (fastest index). The ones in the cache are not evaluated
+    std::vector<double> errors(tot_alphas*tot_k_s*tot_splits);
+    std::vector<std::size_t> cells_to_evaluate;
+    for(std::size_t cell = 0; cell < errors.size(); ++cell)
+    {
+      const std::size_t i = cell/(tot_k_s*tot_splits);
+      const std::size_t j = (cell/tot_splits) % tot_k_s;
+      if(!m_cache || !m_cache->lookup(m_alphas[i],m_k_s[j],splits_fp[cell % tot_splits],errors[cell])){  cells_to_evaluate.emplace_back(cell);}
+    }
+    
+    auto evaluated = sharded_evaluation(cells_to_evaluate.size(),
+                                        number_processes,
+                                        [this,&splits,&cells_to_evaluate,tot_k_s,tot_splits](std::size_t c){
+                                          const std::size_t cell = cells_to_evaluate[c];
+                                          auto train_valid_set = this->strategy().train_validation_set(this->Data(),splits[cell % tot_splits]);
+                                          const auto &pred = m_pred_f(train_valid_set.first,m_alphas[cell/(tot_k_s*tot_splits)],m_k_s[(cell/tot_splits) % tot_k_s],this->number_threads());
+                                          return this->err_valid_set_eval(pred,train_valid_set.second);});
+    
+    for(std::size_t c = 0; c < cells_to_evaluate.size(); ++c)
+    {
+      const std::size_t cell = cells_to_evaluate[c];
+      errors[cell] = evaluated[c];
+      if(m_cache){  m_cache->store(m_alphas[cell/(tot_k_s*tot_splits)],m_k_s[(cell/tot_splits) % tot_k_s],splits_fp[cell % tot_splits],errors[cell]);}
+    }
+    
     //preparing the containers for the errors
     if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
     {
-      m_valid_errors.reserve(tot_alphas);  //for each alpha: valid error for each k
+      m_valid_errors.resize(tot_alphas);
     }
+    m_valid_errors_best_pairs.resize(tot_alphas);
     
-    m_valid_errors_best_pairs.reserve(tot_alphas); //for each alpha: valid error only for the best k
-    
-    for(const auto & alpha : m_alphas)
+    for(std::size_t i = 0; i < tot_alphas; ++i)
     {
-      //alpha fixed: doing CV on k
-      CV_k<cv_strat,err_eval,k_imp,valid_err_ret> cv(std::move(this->Data()),std::move(this->strategy()),m_k_s,m_toll,alpha,m_pred_f,this->number_threads());
-      cv.best_param_search();
+      //validation errors of each k: average over the splits
+      std::vector<double> valid_errors_alpha(tot_k_s);
+      for(std::size_t j = 0; j < tot_k_s; ++j)
+      {
+        auto first = errors.cbegin() + (i*tot_k_s + j)*tot_splits;
+        valid_errors_alpha[j] = valid_splits_mean(std::vector<double>(first,first + tot_splits));
+      }
       
-      //best k given the alpha
-      m_best_pairs.insert(std::make_pair(alpha,cv.param_best()));
-      //saving the validation error for the best pair
-      m_valid_errors_best_pairs.emplace_back(cv.best_valid_error());
+      //alpha fixed: stopping rule of the cv on k
+      auto [valid_errors_k,best_k] = k_stopping_rule(valid_errors_alpha,m_toll);
       
+      m_best_pairs.insert(std::make_pair(m_alphas[i],m_k_s[best_k]));
+      m_valid_errors_best_pairs[i] = valid_errors_k[best_k];
       if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
       {
-        //saving the validation error for each pair (further inspection)
-        m_valid_errors.emplace_back(cv.valid_errors());
+        m_valid_errors[i] = std::move(valid_errors_k);
       }
     }
-#endif
     
-    //best validation error
-    auto min_err = std::min_element(m_valid_errors_best_pairs.begin(),m_valid_errors_best_pairs.end());
+    //best validation error, alpha and k
+    auto min_err = std::min_element(m_valid_errors_best_pairs.begin(),m_valid_errors_best_pairs.end(),[](double e1, double e2){return !std::isnan(e1) && (std::isnan(e2) || e1 < e2);});
     m_best_valid_error = *min_err;
-    
-    //best alpha
     m_alpha_best = m_alphas[std::distance(m_valid_errors_best_pairs.begin(),min_err)];
-    
-    //best k
     m_k_best = m_best_pairs.find(m_alpha_best)->second;
   }
   
@@ -31,14 +31,61 @@
 * @brief Error evaluation between a prediction on validation set and validation set (in a fixed cv iteration). L2 norm estimate of the error.
 * @param pred prediction on validation set
 * @param valid validation set
-* @param number_threads number of threads for OMP
 * @details 'CV_ERR_EVAL::MSE' dispatch.
 */
 template< class D, CV_STRAT cv_strat, CV_ERR_EVAL err_eval, K_IMP k_imp, VALID_ERR_RET valid_err_ret >
 double
-CV_base<D,cv_strat,err_eval,k_imp,valid_err_ret>::err_valid_set_eval(const KO_Traits::StoringVector &pred, const KO_Traits::StoringVector &valid, int number_threads, ERR_EVAL_T<CV_ERR_EVAL::MSE>)
+CV_base<D,cv_strat,err_eval,k_imp,valid_err_ret>::err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::MSE>)
 const
 {
   //using mse between predicted and validation
-  return mse<double>( pred.array() - valid.array(), number_threads );
+  return mse(pred,valid);
+}
+
+
+/*!
+* @brief Error evaluation between a prediction on validation set and validation set (in a fixed cv iteration). L1 norm estimate of the error.
+* @param pred prediction on validation set
+* @param valid validation set
+* @details 'CV_ERR_EVAL::MAE' dispatch.
+*/
+template< class D, CV_STRAT cv_strat, CV_ERR_EVAL err_eval, K_IMP k_imp, VALID_ERR_RET valid_err_ret >
+double
+CV_base<D,cv_strat,err_eval,k_imp,valid_err_ret>::err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::MAE>)
+const
+{
+  //using mae between predicted and validation
+  return mae(pred,valid);
+}
+
+
+/*!
+* @brief Error evaluation between a prediction on validation set and validation set (in a fixed cv iteration). Weighted L2 norm estimate of the error.
+* @param pred prediction on validation set
+* @param valid validation set
+* @details 'CV_ERR_EVAL::WEIGHTED_MSE' dispatch. Weights are the inverse of the variance of each evaluation along the fts, if not set otherwise
+*/
+template< class D, CV_STRAT cv_strat, CV_ERR_EVAL err_eval, K_IMP k_imp, VALID_ERR_RET valid_err_ret >
+double
+CV_base<D,cv_strat,err_eval,k_imp,valid_err_ret>::err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::WEIGHTED_MSE>)
+const
+{
+  //using weighted mse between predicted and validation
+  return weighted_mse(pred,valid,m_err_weights);
+}
+
+
+/*!
+* @brief Error evaluation between a prediction on validation set and validation set (in a fixed cv iteration). Relative L2 norm estimate of the error.
+* @param pred prediction on validation set
+* @param valid validation set
+* @details 'CV_ERR_EVAL::RELATIVE_MSE' dispatch.
+*/
+template< class D, CV_STRAT cv_strat, CV_ERR_EVAL err_eval, K_IMP k_imp, VALID_ERR_RET valid_err_ret >
+double
+CV_base<D,cv_strat,err_eval,k_imp,valid_err_ret>::err_valid_set_eval(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, ERR_EVAL_T<CV_ERR_EVAL::RELATIVE_MSE>)
+const
+{
+  //using relative mse between predicted and validation
+  return relative_mse(pred,valid);
 }
\ No newline at end of file
@@ -21,6 +21,7 @@
 #define CV_CRTP_K_PPC_HPP
 
 #include "CV.hpp"
+#include "cv_cache.hpp"
 
 
 /*!
@@ -31,6 +32,59 @@
 
 
 
+/*!
+* @brief Stopping rule of the cv on the number of retained PPCs: the elements of the input space are evaluated in increasing order, until adding 
+*        another PPC changes the validation error less than the tolerance
+* @param tot_params number of elements of the input space
+* @param toll tolerance between consecutive validation errors
+* @param err_f function returning the validation error of the i-th element of the input space
+* @return the validation errors of the evaluated elements, and the index of the best one (among the ones with an error)
+*/
+template<typename ERR_F>
+std::pair<std::vector<double>,std::size_t>
+k_stopping_rule(std::size_t tot_params, double toll, ERR_F &&err_f)
+{
+  std::vector<double> valid_errors;
+  valid_errors.reserve(tot_params);
+  
+  //evaluating validation error for each parameter
+  double previous_error(static_cast<double>(0));
+  
+  //if adding another PPC does not improve too much the validation error: break
+  for(std::size_t i = 0; i < tot_params; ++i)
+  {
+    //evaluate the error for the parameter
+    double curr_err = err_f(i);
+    valid_errors.emplace_back(curr_err);
+    
+    if(std::abs(curr_err - previous_error) < toll) {break;} else {previous_error = curr_err;}
+  }
+  
+  //Shrinking
+  valid_errors.shrink_to_fit();
+  
+  //best validation error (among the parameters with an error)
+  auto min_err = std::min_element(valid_errors.cbegin(),valid_errors.cend(),[](double e1, double e2){return !std::isnan(e1) && (std::isnan(e2) || e1 < e2);});
+  const std::size_t best = std::distance(valid_errors.cbegin(),min_err);
+  
+  return std::make_pair(std::move(valid_errors),best);
+}
+
+
+/*!
+* @brief Stopping rule of the cv on the number of retained PPCs, applied on the validation errors of the whole input space (already evaluated)
+* @param valid_errors validation error of each element of the input space
+* @param toll tolerance between consecutive validation errors
+* @return the validation errors retained by the stopping rule, and the index of the best one (among the ones with an error)
+*/
+inline
+std::pair<std::vector<double>,std::size_t>
+k_stopping_rule(const std::vector<double> &valid_errors, double toll)
+{
+  return k_stopping_rule(valid_errors.size(),toll,[&valid_errors](std::size_t i){ return valid_errors[i];});
+}
+
+
 /*!
 * @class CV_k
 * @brief Template class for performing cross-validation on the number of retained PPCs: derived-from-CV_base thorugh CRTP ('CV_k' its template D parameter).
@@ -62,6 +116,8 @@ private:
   double m_alpha;
   /*!Function to predict validation set*/
   pred_func_t<K_IMP::YES> m_pred_f;           
+  /*!Cache of the validation errors for each split (not used if nullptr)*/
+  cv_cache *m_cache;
   
 
 public:
@@ -75,6 +131,7 @@ public:
   * @param alpha regularization parameter
   * @param pred_f function to make validation set prediction (overloading with k imposed)
   * @param number_threads number of threads for OMP
+  * @param cache cache of the validation errors for each split (not used if nullptr)
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   */
   template<typename STOR_OBJ,typename STRATEGY>
@@ -84,12 +141,14 @@ public:
        double toll,
        double alpha,
        const pred_func_t<K_IMP::YES> & pred_f,
-       int number_threads)
+       int number_threads,
+       cv_cache *cache = nullptr)
     : CV_base<CV_k,cv_strat,err_eval,k_imp,valid_err_ret>(std::move(Data),std::move(strategy),number_threads), 
       m_params(params), 
       m_toll(toll),
       m_alpha(alpha),
-      m_pred_f(pred_f)
+      m_pred_f(pred_f),
+      m_cache(cache)
       {}
   
   
@@ -115,18 +174,45 @@ public:
    /*!
    * @brief Error for a single cross-validation iteration (parameter given), with fixed training and validation sets
    * @param param parameter that is being evaluated through cross-validation
-   * @param training_set training set
-   * @param validation_set validation set
+   * @param training_set training set (view)
+   * @param validation_set validation set (view)
    * @return the error, according to 'err_eval' class template parameter, between prediction on validation set and validation set
    */
    inline 
    double 
-   error_single_cv_iter(const int &param, const KO_Traits::StoringMatrix &training_set, const KO_Traits::StoringMatrix &validation_set)
+   error_single_cv_iter(const int &param, const Eigen::Ref<const KO_Traits::StoringMatrix> &training_set, const Eigen::Ref<const KO_Traits::StoringVector> &validation_set)
    const
    {
       //training the model, making prediction and evaluating the error on the validaiton set
-      auto pred = m_pred_f(training_set,m_alpha,param,this->number_threads());
-      return this->err_valid_set_eval(pred,validation_set,this->number_threads());
+      const auto &pred = m_pred_f(training_set,m_alpha,param,this->number_threads());
+      return this->err_valid_set_eval(pred,validation_set);
+   }
+   
+   
+   /*!
+   * @brief Error for a single cross-validation iteration (parameter given), looked for in the cache before training the model
+   * @param param parameter that is being evaluated through cross-validation
+   * @param split column indices of training and validation set
+   * @return the error, according to 'err_eval' class template parameter, between prediction on validation set and validation set
+   */
+   inline 
+   double 
+   error_single_split(const int &param, const iter_cv_t &split)
+   const
+   {
+     std::uint64_t split_fp = 0;
+     if(m_cache)
+     {
+       split_fp = split_fingerprint(split);
+       double err;
+       if(m_cache->lookup(m_alpha,param,split_fp,err)){  return err;}
+     }
+     
+     auto train_valid_set = this->strategy().train_validation_set(this->Data(),split); 
+     double err = this->error_single_cv_iter(param,train_valid_set.first,train_valid_set.second);
+     
+     if(m_cache){  m_cache->store(m_alpha,param,split_fp,err);}
+     return err;
    }
    
    
@@ -135,35 +221,22 @@ public:
    * @param param element of the input space for number of retained PPCs
    * @param strat strategy for splitting training and validation set
    * @param number_cv_iter total number of different splits
-   * @return the average of the errors between prediction on validation set and validation set, for each split
-   * @note eventual usage of 'pragma' directive for OMP
+   * @return the average of the errors between prediction on validation set and validation set, over the splits with an error (NaN if none)
+   * @note parallel loops through 'KO_Parallel'
    */
    inline 
    double 
    error_single_param(const int &param, const cv_strategy_t &strat, const std::size_t &number_cv_iter) 
    const
    {
-     double err = 0.0;
+     //going parallel over the splits
+     std::vector<double> errors(number_cv_iter);
+     KO_Parallel::parallel_for(number_cv_iter,
+                               threading_policy::outer_threads(KO_PHASE::CV_GRID,this->number_threads()),
+                               [this,&param,&strat,&errors](std::size_t i){ errors[i] = this->error_single_split(param,strat[i]);});
      
-     //if OMP: going parallel
-#ifdef _OPENMP
-#pragma omp parallel for shared(param,strat) num_threads(this->number_threads()) reduction(+:err)
-     for (int i = 0; i < number_cv_iter; ++i)
-     {
-       auto train_valid_set = this->strategy().train_validation_set(this->Data(),strat[i]); 
-       err += this->error_single_cv_iter(param,train_valid_set.first,train_valid_set.second);
-     }
-#else
-     // if not OMP: STL algorithms: transform_reduce to apply at each split the evaluation of the prediction and then summing them up
-     err = std::transform_reduce(strat.cbegin(),
-                                 strat.cend(),
-                                 0.0,
-                                 std::plus{},
-                                 [this,&param](auto el){ auto train_valid_set = this->strategy().train_validation_set(this->Data(),el); return this->error_single_cv_iter(param,train_valid_set.first,train_valid_set.second);});
-#endif     
-     
-     //returning the average
-     return err/(static_cast<double>(number_cv_iter));
+     //returning the average: splits without evaluations in the validation set are skipped
+     return valid_splits_mean(errors);
    }
   
   
@@ -174,31 +247,26 @@ public:
   void 
   best_param_search() 
   { 
-    //preparing the container for the validation errors
-    m_valid_errors.reserve(m_params.size());
-    
-    //evaluating validation error for each parameter
-    double previous_error(static_cast<double>(0));
-    
-    //if adding another PPC does not improve too much the validation error: break
-    for(const auto & el : m_params)
-    {
-      //evaluate the error for the parameter
-      double curr_err = this->error_single_param(el,this->strategy().strategy(),this->strategy().strategy().size());
-      m_valid_errors.emplace_back(curr_err);
-      
-      if(std::abs(curr_err - previous_error) < m_toll) {break;} else {previous_error = curr_err;}
-    }
-    
-    //Shrinking
-    m_valid_errors.shrink_to_fit();
-
-    //best validation error
-    auto min_err = (std::min_element(m_valid_errors.begin(),m_valid_errors.end()));
-    m_best_valid_error = *min_err;
+    this->search([this](std::size_t i){ return this->error_single_param(m_params[i],this->strategy().strategy(),this->strategy().strategy().size());});
+  }
+  
+  
+  /*!
+  * @brief Selecting the best number of retained PPCs, modifying it into the class
+  * @param err_f function returning the validation error of the i-th element of the input space
+  */
+  template<typename ERR_F>
+  inline 
+  void 
+  search(ERR_F &&err_f) 
+  { 
+    //stopping rule on the errors
+    auto [valid_errors,best] = k_stopping_rule(m_params.size(),m_toll,std::forward<ERR_F>(err_f));
+    m_valid_errors = std::move(valid_errors);
+    m_best_valid_error = m_valid_errors[best];
     
     //optimal param
-    m_param_best = m_params[std::distance(m_valid_errors.begin(),min_err)];
+    m_param_best = m_params[best];
     
     //if saving errors
     if constexpr (valid_err_ret == VALID_ERR_RET::NO_err)
@@ -25,14 +25,18 @@
 #include <stdexcept>
 #include <utility>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <exception>
 
 #include "traits_ko.hpp"
 #include "parameters_wrapper.hpp"
 #include "PPC_KO_wrapper.hpp"
+#include "multires_cv.hpp"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include "parallel_backend.hpp"
+#include "ko_log.hpp"
 
 
 /*!
@@ -45,7 +49,7 @@
 /*!
 * @class KO_Factory
 * @brief Generating the PPCKO solver runtime according to an input string
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -54,6 +58,87 @@
 template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval > 
 class KO_Factory
 {	
+private:
+  //! Printing if running the serial or the parallel version
+  /*!
+  * @param num_threads number of threads for OMP
+  */
+  static
+  void
+    print_threads(int num_threads)
+    {
+#if KO_PAR_BACKEND != KO_PAR_SERIAL
+      if(num_threads==1)
+      {
+        std::cout << "Running parallel version (" << KO_Parallel::backend_name() << ") with " << num_threads << " thread" << std::endl;
+      }
+      else
+      {
+        std::cout << "Running parallel version (" << KO_Parallel::backend_name() << ") with " << num_threads << " threads" << std::endl;
+      }
+#else
+      std::cout << "Running serial version" << std::endl;
+#endif
+    }
+  
+  //! Builds the pointer to the right object for the cross-validation requested, without printing (as in 'KO_solver')
+  static 
+  std::unique_ptr<PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>> 
+    make_solver(const std::string &id,
+                KO_Traits::StoringMatrix && X,
+                double alpha,
+                int k,
+                double threshold_ppc,
+                const std::vector<double>& alphas,
+                const std::vector<int>& k_s,
+                double toll,
+                int min_size_ts,
+                int max_size_ts,
+                int num_threads)
+    {
+      if (id == CV_algo::CV1)   //No CV:          if (k=0): explanatory power criterion
+      {
+        return k==0 ? std::make_unique<PPC_KO_wrapper_no_cv<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alpha,threshold_ppc,num_threads) : std::make_unique<PPC_KO_wrapper_no_cv<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alpha,k,num_threads);
+      }
+      
+      if (id == CV_algo::CV2)   //CV on alpha:    if (k=0): explanatory power criterion
+      {
+        return k==0 ? std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,threshold_ppc,min_size_ts,max_size_ts,num_threads) : std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k,min_size_ts,max_size_ts,num_threads);
+      }
+      
+      if (id == CV_algo::CV5)   //continuous CV on alpha:    if (k=0): explanatory power criterion
+      {
+        return k==0 ? std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,threshold_ppc,min_size_ts,max_size_ts,num_threads,ALPHA_SEARCH::BRENT_SEARCH) : std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k,min_size_ts,max_size_ts,num_threads,ALPHA_SEARCH::BRENT_SEARCH);
+      }
+      
+      if (id == CV_algo::CV6)   //successive halving CV on alpha:    if (k=0): explanatory power criterion
+      {
+        return k==0 ? std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,threshold_ppc,min_size_ts,max_size_ts,num_threads,ALPHA_SEARCH::HALVING_SEARCH) : std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k,min_size_ts,max_size_ts,num_threads,ALPHA_SEARCH::HALVING_SEARCH);
+      }
+      
+      if (id == CV_algo::CV7 || id == CV_algo::CV8 || id == CV_algo::CV9)   //closed-form selection: GCV on alpha, eigenvalue ratio on k, or both
+      {
+        const CF_SELECTION selection = id == CV_algo::CV7 ? CF_SELECTION::CF_ALPHA : (id == CV_algo::CV8 ? CF_SELECTION::CF_K : CF_SELECTION::CF_ALPHA_K);
+        return std::make_unique<PPC_KO_wrapper_closed_form<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k_s,alpha,k,threshold_ppc,selection,num_threads);
+      }
+      
+      if (id == CV_algo::CV3)   //CV on k
+      {
+        return std::make_unique<PPC_KO_wrapper_cv_k<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alpha,k_s,toll,min_size_ts,max_size_ts,num_threads);
+      }
+      
+      if (id == CV_algo::CV4)   //CV on both alpha and k
+      {
+        return std::make_unique<PPC_KO_wrapper_cv_alpha_k<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k_s,toll,min_size_ts,max_size_ts,num_threads);
+      }
+      
+      else
+      {
+        std::string error_message = "Wrong input string";
+        throw std::invalid_argument(error_message);
+      }
+    }
+  
 public:
   //! Static method that takes a string as identifier and builds a pointer to the right object for the cross-validation requested
   /*!
@@ -62,7 +147,12 @@ public:
   *           - 'NoCV': no cross-validation is performed. Regularization is imposed. Number of PPCs can be imposed or retrieved through explanatory power criterion;
   *           - 'CV_alpha': cross-validation for regularization parameter. Number of PPCs can be imposed or retrieved through explanatory power criterion;
   *           - 'CV_k': cross-validation for number of retained PPCs. Regularization parameter is imposed;
-  *           - 'CV': cross-validation for both regularization parameter and number of retained PPCs.
+  *           - 'CV': cross-validation for both regularization parameter and number of retained PPCs;
+  *           - 'CV_alpha_cont': cross-validation for regularization parameter, searched continuously (on its logarithm) within the interval spanned by its input space. Number of PPCs can be imposed or retrieved through explanatory power criterion;
+  *           - 'CV_alpha_sh': cross-validation for regularization parameter, discarding the worst half of its input space on growing subsets of the training/validation splits. Number of PPCs can be imposed or retrieved through explanatory power criterion;
+  *           - 'GCV_alpha': regularization parameter selected through generalized cross-validation, from one eigendecomposition of the covariance. Number of PPCs can be imposed or retrieved through explanatory power criterion;
+  *           - 'ER_k': number of retained PPCs selected through eigenvalue-ratio criterion. Regularization parameter is imposed;
+  *           - 'GCV': regularization parameter through generalized cross-validation, and number of retained PPCs through eigenvalue-ratio criterion.
   * @param X matrix containing the fts
   * @param alpha regularization parameter
   * @param k number of retained PPCs:
@@ -93,42 +183,216 @@ public:
               int num_threads)
     {
       
-#ifdef _OPENMP
-      if(num_threads==1)
+      KO_Factory::print_threads(num_threads);
+      
+      return KO_Factory::make_solver(id,std::move(X),alpha,k,threshold_ppc,alphas,k_s,toll,min_size_ts,max_size_ts,num_threads);
+    }
+  
+  //! Static method that builds a pointer to the PPCKO solver whose hyperparameters are selected coarse-to-fine
+  /*!
+  * @brief Generating the PPCKO solver runtime according to an input string, performing firstly the requested cv on a downsampled grid and 
+  *        restricting then the full-grid input spaces to a neighbourhood of the coarse optimum
+  * @param id input string (as in 'KO_solver'): with 'NoCV' and the closed-form selections, no coarse pass is performed
+  * @param X matrix containing the fts
+  * @param rows_coarse rows of the fts lying on the coarse grid (if empty: no coarse pass)
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs ('k' = 0: selected through explanatory power criterion)
+  * @param threshold_ppc requested explanatory power from the PPCs. Used only for selecting 'k' through explanatory power criterion
+  * @param alphas input space for regularization parameter
+  * @param k_s input space for the number of retained PPCs
+  * @param toll tolerance for the cv on the number of retained PPCs (as in 'KO_solver')
+  * @param min_size_ts smallest training set size (number of time instants)
+  * @param max_size_ts biggest training set size (number of time instants)
+  * @param num_threads number of threads for OMP
+  * @param configure function applied to the coarse solver before its cv, giving it the settings of the fine one (time budget, cache file, worker processes)
+  * @return a unique pointer to a PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>, whose cv is on the refined input spaces
+  * @details On the full grid, only the coarse optimum and its closest candidates (one per side for alpha, two per side for k) are validated.
+  *          On the coarse grid, only the numbers of PPCs not greater than half its size (the most the eigensolvers retrieve) are validated
+  */
+  template<typename CONFIGURE>
+  static 
+  std::unique_ptr<PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>> 
+    KO_solver_multires(const std::string &id,
+                       KO_Traits::StoringMatrix && X,
+                       const std::vector<int>& rows_coarse,
+                       double alpha,
+                       int k,
+                       double threshold_ppc,
+                       const std::vector<double>& alphas,
+                       const std::vector<int>& k_s,
+                       double toll,
+                       int min_size_ts,
+                       int max_size_ts,
+                       int num_threads,
+                       CONFIGURE configure)
+    {
+      if (rows_coarse.empty() || id == CV_algo::CV1 || id == CV_algo::CV7 || id == CV_algo::CV8 || id == CV_algo::CV9)
       {
-        std::cout << "Running parallel version with " << num_threads << " thread" << std::endl;
+        return KO_Factory::KO_solver(id,std::move(X),alpha,k,threshold_ppc,alphas,k_s,toll,min_size_ts,max_size_ts,num_threads);
       }
-      else
+      
+      //coarse pass: cv on the downsampled grid (validation errors are not needed)
+      const int m_coarse = rows_coarse.size();
+      const int k_max_coarse = std::max(1,m_coarse/2);
+      std::vector<int> k_s_coarse;
+      std::copy_if(k_s.cbegin(),k_s.cend(),std::back_inserter(k_s_coarse),[k_max_coarse](int k_cand){return k_cand <= k_max_coarse;});
+      if(k_s_coarse.empty()){  k_s_coarse.emplace_back(k_max_coarse);}
+      
+      KO_Log::message("Coarse-to-fine cv: selecting the hyperparameters on ",m_coarse," out of ",X.rows()," discrete evaluations");
+      auto ko_coarse = KO_Factory<solver,k_imp,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>::KO_solver(id,KO_Traits::StoringMatrix(X(rows_coarse,Eigen::all)),alpha,std::min(k,k_max_coarse),threshold_ppc,alphas,k_s_coarse,toll,min_size_ts,max_size_ts,num_threads);
+      configure(ko_coarse);
+      ko_coarse->call_ko();
+      
+      //fine pass: cv on the full grid, within a neighbourhood of the coarse optimum
+      std::vector<double> alphas_fine = (id == CV_algo::CV3) ? alphas : refined_space(alphas,std::get<1>(ko_coarse->results()),1);
+      std::vector<int> k_s_fine       = (id == CV_algo::CV2 || id == CV_algo::CV5 || id == CV_algo::CV6) ? k_s    : refined_space(k_s,std::get<2>(ko_coarse->results()),2);
+      ko_coarse.reset();
+      
+      return KO_Factory::KO_solver(id,std::move(X),alpha,k,threshold_ppc,alphas_fine,k_s_fine,toll,min_size_ts,max_size_ts,num_threads);
+    }
+  
+  //! Static method that fits a batch of independent fts sharing the grid, with series-level parallelism
+  /*!
+  * @brief Building and running the PPCKO solver requested through the input string for each fts of the batch. It raises an error, reporting the fts, if one of the fits fails
+  * @param id input string (as in 'KO_solver')
+  * @param X matrices containing the fts (moved into the solvers)
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs ('k' = 0: selected through explanatory power criterion)
+  * @param threshold_ppc requested explanatory power from the PPCs. Used only for selecting 'k' through explanatory power criterion
+  * @param alphas input space for regularization parameter
+  * @param k_s input space for the number of retained PPCs
+  * @param toll tolerance for the cv on the number of retained PPCs (as in 'KO_solver')
+  * @param sizes_ts smallest and biggest training set size (number of time instants) for each fts
+  * @param h_max maximum forecasting horizon
+  * @param num_threads number of threads for OMP
+  * @return a vector containing the results of each fts
+  * @details Each thread fits whole fts, that are dynamically scheduled since their cost depends on the cv: 
+  *          each fit runs serially, on its own solver, so that no OMP team is started within the fits
+  */
+  static 
+  std::vector<results_t<valid_err_ret>>
+    KO_solver_batch(const std::string &id,
+                    std::vector<KO_Traits::StoringMatrix> && X,
+                    double alpha,
+                    int k,
+                    double threshold_ppc,
+                    const std::vector<double>& alphas,
+                    const std::vector<int>& k_s,
+                    double toll,
+                    const std::vector<std::pair<int,int>>& sizes_ts,
+                    int h_max,
+                    int num_threads)
+    {
+      
+      KO_Factory::print_threads(num_threads);
+      
+      const int n_series = X.size();
+      std::vector<results_t<valid_err_ret>> results(n_series);
+      std::vector<std::string> errors(n_series);
+      
+      KO_Parallel::parallel_for(n_series,
+                                num_threads,
+                                [&](std::size_t i)
+                                {
+                                  //exceptions cannot leave the parallel loop: stored and raised afterwards
+                                  try
+                                  {
+                                    auto ko = KO_Factory::make_solver(id,std::move(X[i]),alpha,k,threshold_ppc,alphas,k_s,toll,sizes_ts[i].first,sizes_ts[i].second,1);
+                                    ko->h_max() = h_max;
+                                    ko->call_ko();
+                                    results[i] = std::move(ko->results());
+                                  }
+                                  catch(const std::exception &e)
+                                  {
+                                    errors[i] = e.what();
+                                  }
+                                },
+                                PAR_SCHEDULE::DYNAMIC);
+      //buffers of the fits on the cv folds released, once no fit is running
+      release_fold_workspaces();
+      
+      auto failed = std::find_if(errors.cbegin(),errors.cend(),[](const std::string &err){return !err.empty();});
+      if(failed != errors.cend())
       {
-        std::cout << "Running parallel version with " << num_threads << " threads" << std::endl;
+        std::string error_message = "Fts " + std::to_string(std::distance(errors.cbegin(),failed)+1) + ": " + *failed;
+        throw std::invalid_argument(error_message);
       }
-#else
-      std::cout << "Running serial version" << std::endl;
-#endif
+      
+      return results;
+    }
+  
+  //! Static method that builds a pointer to the PPCKO solver for a panel of fts sharing the dynamics
+  /*!
+  * @brief Generating the panel PPCKO solver. It raises an error if cross-validation is requested
+  * @param id input string: only 'NoCV' is available
+  * @param X matrix containing the fts of the panel, stacked one after the other along the columns
+  * @param panel_sizes number of time instants of each fts of the panel
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs ('k' = 0: selected through explanatory power criterion)
+  * @param threshold_ppc requested explanatory power from the PPCs. Used only for selecting 'k' through explanatory power criterion
+  * @param num_threads number of threads for OMP
+  * @return a unique pointer to a PPC_KO_wrapper_panel<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>, that gives access to the mean function of each fts
+  */
+  static 
+  std::unique_ptr<PPC_KO_wrapper_panel<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>> 
+    KO_solver_panel(const std::string &id,
+                    KO_Traits::StoringMatrix && X,
+                    const std::vector<std::size_t>& panel_sizes,
+                    double alpha,
+                    int k,
+                    double threshold_ppc,
+                    int num_threads)
+    {
+      
+      KO_Factory::print_threads(num_threads);
       
       if (id == CV_algo::CV1)   //No CV:          if (k=0): explanatory power criterion
       {
-        return k==0 ? std::make_unique<PPC_KO_wrapper_no_cv<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alpha,threshold_ppc,num_threads) : std::make_unique<PPC_KO_wrapper_no_cv<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alpha,k,num_threads);
+        return std::make_unique<PPC_KO_wrapper_panel<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),panel_sizes,alpha,k,threshold_ppc,num_threads);
       }
       
-      if (id == CV_algo::CV2)   //CV on alpha:    if (k=0): explanatory power criterion
+      else
       {
-        return k==0 ? std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,threshold_ppc,min_size_ts,max_size_ts,num_threads) : std::make_unique<PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k,min_size_ts,max_size_ts,num_threads);
+        std::string error_message = "Panel estimator is available only without cross-validation";
+        throw std::invalid_argument(error_message);
       }
+    }
+  
+  //! Static method that builds a pointer to the PPCKO solver for surfaces with separable covariance and cross-covariance
+  /*!
+  * @brief Generating the separable PPCKO solver. It raises an error if cross-validation is requested
+  * @param id input string: only 'NoCV' is available
+  * @param X matrix containing the fts
+  * @param d1 number of evaluations along dimension 1
+  * @param d2 number of evaluations along dimension 2
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs ('k' = 0: selected through explanatory power criterion)
+  * @param threshold_ppc requested explanatory power from the PPCs. Used only for selecting 'k' through explanatory power criterion
+  * @param num_threads number of threads for OMP
+  * @return a unique pointer to a PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>
+  */
+  static 
+  std::unique_ptr<PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>> 
+    KO_solver_separable(const std::string &id,
+                        KO_Traits::StoringMatrix && X,
+                        std::size_t d1,
+                        std::size_t d2,
+                        double alpha,
+                        int k,
+                        double threshold_ppc,
+                        int num_threads)
+    {
       
-      if (id == CV_algo::CV3)   //CV on k
-      {
-        return std::make_unique<PPC_KO_wrapper_cv_k<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alpha,k_s,toll,min_size_ts,max_size_ts,num_threads);
-      }
+      KO_Factory::print_threads(num_threads);
       
-      if (id == CV_algo::CV4)   //CV on both alpha and k
+      if (id == CV_algo::CV1)   //No CV:          if (k=0): explanatory power criterion
       {
-        return std::make_unique<PPC_KO_wrapper_cv_alpha_k<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),alphas,k_s,toll,min_size_ts,max_size_ts,num_threads);
+        return std::make_unique<PPC_KO_wrapper_separable<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>>(std::move(X),d1,d2,alpha,k,threshold_ppc,num_threads);
       }
       
       else
       {
-        std::string error_message = "Wrong input string";
+        std::string error_message = "Separable estimator is available only without cross-validation";
         throw std::invalid_argument(error_message);
       }
     }
@@ -24,22 +24,23 @@
 #include <algorithm>
 #include <iterator>
 #include <numeric>
-#include <execution>
 #include <vector>
 #include <functional>
 #include <utility>
 #include <tuple>
 #include <cmath>
 #include <array>
+#include <limits>
+#include <type_traits>
 
 #include "traits_ko.hpp"
 #include "CV_include.hpp"
 #include "Factory_cv_strategy.hpp"
 #include "strategy_cv.hpp"
-
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include "trace_estimation.hpp"
+#include "explanatory_power.hpp"
+#include "threading_policy.hpp"
+#include "ko_log.hpp"
 
 
 /*!
@@ -58,7 +59,7 @@
 *         -
 *         -
 *         - 
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -77,8 +78,14 @@ private:
   std::size_t m_n;                            
   /*!Fts: data will be centered as soon as object construction (matrix: m x n)*/
   KO_Traits::StoringMatrix m_X;               
+  /*!If the fts contains non-dummy NaNs that have to be handled through pairwise-complete moments*/
+  bool m_masked;
+  /*!Availability of each evaluation of the fts (mask: m x n). Stored only if the fts is masked*/
+  KO_Traits::StoringMask m_mask;
   /*!Fts mean function (array: m x 1)*/
   KO_Traits::StoringArray m_means;            
+  /*!Mean function of each fts, if a panel of fts is pooled (matrix: m x number of fts). Empty for a single fts*/
+  KO_Traits::StoringMatrix m_panel_means;
   /*!Covariance operator estimate (matrix: m x m)*/
   KO_Traits::StoringMatrix m_Cov;             
   /*!Trace of the covariance operator estimate*/
@@ -87,10 +94,10 @@ private:
   KO_Traits::StoringMatrix m_CrossCov;        
   /*!Regularized sample covariance (sample covariance + alpha*trace(cov)*I) (matrix: m x m)*/
   KO_Traits::StoringMatrix m_CovReg;          
-  /*!Square of the cross-covariance operator estimate (matrix: m x m)*/
+  /*!Square of the cross-covariance operator estimate (matrix: m x m, only for gep_solver)*/
   KO_Traits::StoringMatrix m_GammaSquared;    
-  /*!Inverse square root of the regularized covariance (matrix: m x m)*/
-  KO_Traits::StoringMatrix m_CovRegRoot;      
+  /*!Cholesky factorization of the regularized covariance: LL'*/
+  Eigen::LLT<KO_Traits::StoringMatrix> m_CovRegChol;      
   /*!Predictive loading (PPCs directions) (matrix: m x k)*/
   KO_Traits::StoringMatrix m_a;           
   /*!Predictive factors factor (PPCs weights) (matrix: m x k)*/
@@ -101,6 +108,8 @@ private:
   std::vector<double> m_explanatory_power;    
   /*!Total explanatory power intrinsic in the fts*/
   double m_tot_exp_pow;               
+  /*!Estimated variance of the total explanatory power (0 if it is computed exactly)*/
+  double m_tot_exp_pow_var;
   /*!Regularization parameter*/
   double m_alpha;                             
   /*!Number of retained PPCs*/
@@ -113,6 +122,70 @@ private:
   int m_number_threads;                      
   
   
+  /*!
+  * @class phi_op
+  * @brief Matrix-free phi = L^(-1)*CrossCov'*CrossCov*L^(-T), with Cov_reg = LL', as 'Spectra' operator
+  */
+  class phi_op
+  {
+  private:
+    const Eigen::LLT<KO_Traits::StoringMatrix> &m_L;    //Cholesky factorization of the regularized covariance
+    const KO_Traits::StoringMatrix &m_CrossCov;
+    
+  public:
+    using Scalar = double;
+    
+    phi_op(const Eigen::LLT<KO_Traits::StoringMatrix> &L, const KO_Traits::StoringMatrix &CrossCov)
+      : m_L(L), m_CrossCov(CrossCov) {}
+    
+    Eigen::Index rows() const { return m_CrossCov.rows();}
+    Eigen::Index cols() const { return m_CrossCov.rows();}
+    
+    void perform_op(const Scalar* x_in, Scalar* y_out) const
+    {
+      Eigen::Map<const KO_Traits::StoringVector> x(x_in,this->rows());
+      Eigen::Map<KO_Traits::StoringVector> y(y_out,this->rows());
+      y = m_L.matrixL().solve(m_CrossCov.transpose()*(m_CrossCov*m_L.matrixU().solve(x)));
+    }
+  };
+  
+  
+  /*!
+  * @class cov_reg_op
+  * @brief Regularized covariance through its Cholesky factorization, Cov_reg = LL', as 'Spectra' operator of the gep (Cholesky mode)
+  */
+  class cov_reg_op
+  {
+  private:
+    const Eigen::LLT<KO_Traits::StoringMatrix> &m_L;    //Cholesky factorization of the regularized covariance
+    
+  public:
+    using Scalar = double;
+    
+    explicit cov_reg_op(const Eigen::LLT<KO_Traits::StoringMatrix> &L)
+      : m_L(L) {}
+    
+    Eigen::Index rows() const { return m_L.rows();}
+    Eigen::Index cols() const { return m_L.cols();}
+    
+    //y = L^(-1)*x
+    void lower_triangular_solve(const Scalar* x_in, Scalar* y_out) const
+    {
+      Eigen::Map<KO_Traits::StoringVector> y(y_out,this->rows());
+      y = Eigen::Map<const KO_Traits::StoringVector>(x_in,this->rows());
+      m_L.matrixL().solveInPlace(y);
+    }
+    
+    //y = L^(-T)*x
+    void upper_triangular_solve(const Scalar* x_in, Scalar* y_out) const
+    {
+      Eigen::Map<KO_Traits::StoringVector> y(y_out,this->rows());
+      y = Eigen::Map<const KO_Traits::StoringVector>(x_in,this->rows());
+      m_L.matrixU().solveInPlace(y);
+    }
+  };
+  
+  
 public:
   
   /*!
@@ -120,7 +193,7 @@ public:
   * @param X fts
   * @param number_threads number of threads for OMP
   * @details Universal constructor: move semantic used to optimazing handling big size objects
-  * @note eventual usage of 'pragma' directive for OMP
+  * @note parallel loops through 'KO_Parallel'
   */
   template<typename STOR_OBJ>
   PPC_KO_base(STOR_OBJ&& X,int number_threads)
@@ -128,31 +201,89 @@ public:
     m_X{std::forward<STOR_OBJ>(X)},
     m_m(X.rows()),
     m_n(X.cols()),
+    m_tot_exp_pow_var(0),
     m_number_threads(number_threads)
     {  
-      //evaluating row mean and saving it in the m_means
-      m_means = (m_X.rowwise().sum())/m_n;
+      //moments: threads to the loops or to the products, according to the threading policy
+      threading_phase phase(KO_PHASE::MOMENTS,m_number_threads);
+      
+      //NaNs still in the fts: they have been kept to be handled through pairwise-complete moments
+      m_masked = m_X.hasNaN();
       
-      //centering
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(m_number_threads)
-#endif
-      for (size_t i = 0; i < m_n; ++i)
+      if(m_masked)
       {
-        m_X.col(i) = m_X.col(i).array() - m_means;
+        //mean function, centering, covariance and cross-covariance estimates using only the available evaluations
+        this->masked_moments();
       }
+      else
+      {
+        //evaluating row mean and saving it in the m_means
+        m_means = (m_X.rowwise().sum())/m_n;
+      
+        //centering
+        KO_Parallel::parallel_for(m_n,phase.outer_threads(),[this](std::size_t i){ m_X.col(i) = m_X.col(i).array() - m_means;});
       
-      // covariance operator estimate: (X * X')/n
-      m_Cov =  ((m_X*m_X.transpose()).array())/static_cast<double>(m_n);
+        if constexpr(std::is_same_v<KO_Moments_Traits::Scalar,double>)
+        {
+          // covariance operator estimate: (X * X')/n
+          m_Cov =  ((m_X*m_X.transpose()).array())/static_cast<double>(m_n);
+      
+          // cross-covariance operator estimate: (X[,2:n]*(X[,1:(n-1)])')/(n-1)
+          m_CrossCov =  ((m_X.rightCols(m_n-1)*m_X.leftCols(m_n-1).transpose()).array())/(static_cast<double>(m_n-1));
+        }
+        else
+        {
+          //mixed precision: products on the centered fts in lower precision, estimates stored in double
+          KO_Moments_Traits::StoringMatrix X_low = m_X.template cast<KO_Moments_Traits::Scalar>();
+          
+          m_Cov =  ((X_low*X_low.transpose()).template cast<double>().array())/static_cast<double>(m_n);
+          
+          m_CrossCov =  ((X_low.rightCols(m_n-1)*X_low.leftCols(m_n-1).transpose()).template cast<double>().array())/(static_cast<double>(m_n-1));
+        }
+      }
       
       // trace of covariance
       m_trace_cov = m_Cov.trace();
       
-      // cross-covariance operator estimate: (X[,2:n]*(X[,1:(n-1)])')/(n-1)
-      m_CrossCov =  ((m_X.rightCols(m_n-1)*m_X.leftCols(m_n-1).transpose()).array())/(static_cast<double>(m_n-1));
+      // square of cross covariance estimate (the exact solver whitens the cross-covariance directly)
+      if constexpr(solver == SOLVER::gep_solver)
+      {
+        m_GammaSquared = m_CrossCov.transpose()*m_CrossCov;
+      }
+    }
+  
+  
+  /*!
+  * @brief Constructor for a panel of fts sharing the dynamics: each fts is centered with its own mean function, and the moments are pooled
+  * @param X fts of the panel, stacked one after the other along the columns
+  * @param panel_sizes number of time instants of each fts of the panel
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_base(STOR_OBJ&& X, const std::vector<std::size_t> &panel_sizes, int number_threads)
+    :   
+    m_X{std::forward<STOR_OBJ>(X)},
+    m_m(X.rows()),
+    m_n(X.cols()),
+    m_masked(false),
+    m_tot_exp_pow_var(0),
+    m_number_threads(number_threads)
+    {  
+      //moments: threads to the loops or to the products, according to the threading policy
+      threading_phase phase(KO_PHASE::MOMENTS,m_number_threads);
+      
+      //mean functions, centering, pooled covariance and cross-covariance estimates
+      this->panel_moments(panel_sizes);
+      
+      // trace of covariance
+      m_trace_cov = m_Cov.trace();
       
-      // square of cross covariance estimate
-      m_GammaSquared = m_CrossCov.transpose()*m_CrossCov;
+      // square of cross covariance estimate (the exact solver whitens the cross-covariance directly)
+      if constexpr(solver == SOLVER::gep_solver)
+      {
+        m_GammaSquared = m_CrossCov.transpose()*m_CrossCov;
+      }
     }
   
   
@@ -174,12 +305,30 @@ public:
   */
   inline KO_Traits::StoringMatrix X() const {return m_X;};
   
+  /*!
+  * @brief Getter for the flag indicating if moments are pairwise-complete
+  * @return the private m_masked
+  */
+  inline bool masked() const {return m_masked;};
+  
+  /*!
+  * @brief Getter for the availability mask of the fts evaluations
+  * @return the private m_mask
+  */
+  inline const KO_Traits::StoringMask & mask() const {return m_mask;};
+  
   /*!
   * @brief Getter for the mean function
   * @return the private m_means
   */
   inline KO_Traits::StoringArray means() const {return m_means;};
   
+  /*!
+  * @brief Getter for the mean function of each fts of the panel
+  * @return the private m_panel_means
+  */
+  inline const KO_Traits::StoringMatrix & panel_means() const {return m_panel_means;};
+  
   /*!
   * @brief Getter for the covariance operator estimate
   * @return the private m_Cov
@@ -192,6 +341,12 @@ public:
   */
   inline double trace_cov() const {return m_trace_cov;};
   
+  /*!
+  * @brief Getter for the cross-covariance operator estimate
+  * @return the private m_CrossCov
+  */
+  inline const KO_Traits::StoringMatrix & CrossCov() const {return m_CrossCov;};
+  
   /*!
   * @brief Setter for the regularized sample covariance operator
   * @return the private m_CovReg (non-const)
@@ -258,6 +413,40 @@ public:
   */
   inline double & threshold_ppc() {return m_threshold_ppc;};
   
+  /*!
+  * @brief Fts not centered: the mean function is added back, and the eventual missing evaluations are restored
+  * @return the fts as passed to the constructor, to be passed in the various cv iterations
+  * @note parallel loops through 'KO_Parallel'
+  */
+  KO_Traits::StoringMatrix
+  X_non_cent()
+  const
+  {
+    KO_Traits::StoringMatrix X_non_cent(m_m,m_n);
+    
+    KO_Parallel::parallel_for(m_n,m_number_threads,[this,&X_non_cent](std::size_t i){ X_non_cent.col(i) = m_X.col(i).array() + m_means;});
+    
+    //missing evaluations are restored, so that the cv iterations estimate pairwise-complete moments too
+    if(m_masked)
+    {
+      X_non_cent = m_mask.select(X_non_cent.array(),std::numeric_limits<double>::quiet_NaN()).matrix();
+    }
+    
+    return X_non_cent;
+  }
+  
+  /*!
+  * @brief Getter for the total explanatory power
+  * @return the private m_tot_exp_pow
+  */
+  inline double tot_exp_pow() const {return m_tot_exp_pow;};
+  
+  /*!
+  * @brief Getter for the estimated variance of the total explanatory power
+  * @return the private m_tot_exp_pow_var
+  */
+  inline double tot_exp_pow_var() const {return m_tot_exp_pow_var;};
+  
   /*!
   * @brief Getter for the validation errors
   * @return the private m_valid_err
@@ -277,16 +466,41 @@ public:
   inline int number_threads() const {return m_number_threads;};
   
 
+  /*!
+  * @brief Mean function, centering, covariance and cross-covariance estimates of a fts with missing evaluations
+  * @details Missing evaluations are not imputed: each entry of the covariance (cross-covariance) is normalized by the number of 
+  *          instants (pairs of consecutive instants) in which both the evaluations are available
+  */
+  void masked_moments();
+  
+  /*!
+  * @brief Mean functions, centering, covariance and cross-covariance estimates of a panel of fts
+  * @param panel_sizes number of time instants of each fts of the panel
+  * @details Each fts is centered with its own mean function. The covariance is pooled over all the instants, the cross-covariance over
+  *          all the pairs of consecutive instants of the same fts: a single product over the stacked panel, minus the pairs crossing two fts
+  */
+  void panel_moments(const std::vector<std::size_t> &panel_sizes);
+  
   /*!
   * @brief Retaining the the PPCs: pairs eigenvalue-eigenvector and their number
   * @return a tuple containing: the number of retained PPCs, the eigenvalues of phi/of GEP, the eigenvectors of phi/of GEP
   * @details The PPCs are computed according to the solver strategy using 'Spectra'. Only the first k pairs eigenvalue/eigenvactor are evaluated,
-  *          corresponding to the k laregest eigenvalues, if k imposed. If instead (only for 'SOLVER::ex_solver') are computed
+  *          corresponding to the k laregest eigenvalues, if k imposed. If instead are computed
   *          using the explanatory power criterion, the k pairs eigenvalues-eigenvectors are computed increasing the number of computed
-  *          ones until the requested explanatory power is reached
+  *          ones until the requested explanatory power is reached. For 'SOLVER::ex_solver' on grids with at least KO_TRACE_EST_MIN_SIZE
+  *          evaluations, phi is never assembled: it is applied matrix-free, and its trace is estimated through Hutch++
   */
   std::tuple<int,KO_Traits::StoringVector,KO_Traits::StoringMatrix> PPC_retained();
   
+  /*!
+  * @brief Leading eigenpairs of phi ('SOLVER::ex_solver'): k imposed, or increasing their number until the requested explanatory power is reached
+  * @tparam OP 'Spectra' operator for phi (dense or matrix-free)
+  * @param op phi
+  * @return a tuple containing: the number of retained PPCs, the eigenvalues of phi, the eigenvectors of phi
+  */
+  template<typename OP>
+  std::tuple<int,KO_Traits::StoringVector,KO_Traits::StoringMatrix> phi_eigenpairs(OP &op) const;
+  
   /*!
   * @brief Performing PPCKO algorithm once regularization parameter is selected and k or it is fixed or to be retained through explanatory power.
   *        Computes PPCs, direction and weight, their number and their cumulative explanatory power, and the estimate of the autoregressive operator
@@ -300,6 +514,14 @@ public:
   */
   KO_Traits::StoringArray prediction() const;
   
+  /*!
+  * @brief Performs h-step ahead prediction of the fts, for all the horizons h = 1,...,h_max. The mean function is added
+  * @param h_max maximum forecasting horizon
+  * @return a matrix whose h-th column is the (h+1)-step ahead prediction
+  * @details rho^h = a*(b'a)^(h-1)*b': the forecast is propagated in the space of the k PPCs, O(m*k + h_max*k^2)
+  */
+  KO_Traits::StoringMatrix prediction(int h_max) const;
+  
   /*!
   * @brief Computes the scores of the PPCs, defined as scalar product between the direction and the fts at the last instant
   * @return a vector containing the score of each PPC
@@ -35,7 +35,7 @@
 /*!
 * @class PPC_KO_CV_alpha
 * @brief Derived from 'PPC_KO_base' class for computing PPCKO algorithm with cross-validation on regularization parameter
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -48,12 +48,18 @@ private:
 
   /*!Input space for regularization parameter*/
   std::vector<double> m_alphas;
-  /*!Fts not centered*/
-  KO_Traits::StoringMatrix m_X_non_cent;
+  /*!Fts not centered (compressed if compiled with KO_COMPRESSED_FTS)*/
+  cv_storing_t m_X_non_cent;
   /*!Smallest training set size (number of time instants)*/
   int m_min_size_ts;
   /*!Biggest training set size (number of time instants)*/
   int m_max_size_ts;  
+  /*!How the input space for regularization parameter is explored*/
+  ALPHA_SEARCH m_search;
+  /*!Time budget of the cv on the grid*/
+  cv_budget m_budget;
+  /*!Number of local worker processes across which the cv on the grid is sharded (1: no sharding)*/
+  int m_number_processes;
   
   
 public:
@@ -66,28 +72,25 @@ public:
   * @param min_size_ts smallest training set size (number of time instants)
   * @param max_size_ts biggest training set size (number of time instants)
   * @param number_threads number of threads for OMP
+  * @param search how the input space for regularization parameter is explored
+  * @param budget time budget of the cv on the grid (only for ALPHA_SEARCH::GRID_SEARCH)
+  * @param number_processes number of local worker processes across which the cv on the grid is sharded (only for ALPHA_SEARCH::GRID_SEARCH, 1: no sharding)
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   * @note eventual usage of 'pragma' directive for OMP
   */
   template<typename STOR_OBJ>
-  PPC_KO_CV_alpha(STOR_OBJ&& X, const std::vector<double> &alphas, int k, int min_size_ts, int max_size_ts, int number_threads) 
+  PPC_KO_CV_alpha(STOR_OBJ&& X, const std::vector<double> &alphas, int k, int min_size_ts, int max_size_ts, int number_threads, ALPHA_SEARCH search = ALPHA_SEARCH::GRID_SEARCH, const cv_budget &budget = cv_budget(), int number_processes = 1) 
     : 
     PPC_KO_base<PPC_KO_CV_alpha,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(X),number_threads),
     m_alphas(alphas),
-    m_X_non_cent(this->m(),this->n()),
+    m_X_non_cent(this->X_non_cent()),
     m_min_size_ts(min_size_ts),
-    m_max_size_ts(max_size_ts)
+    m_max_size_ts(max_size_ts),
+    m_search(search),
+    m_budget(budget),
+    m_number_processes(number_processes)
     {
       this->k() = k; 
-      
-      //decentering the data, to pass them in the various cv iterations not centered
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(this->number_threads())
-#endif
-      for (size_t i = 0; i < this->n(); ++i)
-      {
-        m_X_non_cent.col(i) = this->X().col(i).array() + this->means();
-      }
     }
   
   /*!
@@ -98,30 +101,70 @@ public:
   * @param min_size_ts smallest training set size (number of time instants)
   * @param max_size_ts biggest training set size (number of time instants)
   * @param number_threads number of threads for OMP
+  * @param search how the input space for regularization parameter is explored
+  * @param budget time budget of the cv on the grid (only for ALPHA_SEARCH::GRID_SEARCH)
+  * @param number_processes number of local worker processes across which the cv on the grid is sharded (only for ALPHA_SEARCH::GRID_SEARCH, 1: no sharding)
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   * @note eventual usage of 'pragma' directive for OMP
   */
   template<typename STOR_OBJ>
-  PPC_KO_CV_alpha(STOR_OBJ&& X, const std::vector<double> &alphas, double threshold_ppc, int min_size_ts, int max_size_ts, int number_threads) 
+  PPC_KO_CV_alpha(STOR_OBJ&& X, const std::vector<double> &alphas, double threshold_ppc, int min_size_ts, int max_size_ts, int number_threads, ALPHA_SEARCH search = ALPHA_SEARCH::GRID_SEARCH, const cv_budget &budget = cv_budget(), int number_processes = 1) 
     : 
     PPC_KO_base<PPC_KO_CV_alpha,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(X),number_threads),
     m_alphas(alphas),
-    m_X_non_cent(this->m(),this->n()),
+    m_X_non_cent(this->X_non_cent()),
     m_min_size_ts(min_size_ts),
-    m_max_size_ts(max_size_ts)
+    m_max_size_ts(max_size_ts),
+    m_search(search),
+    m_budget(budget),
+    m_number_processes(number_processes)
     {
       this->threshold_ppc() = threshold_ppc; 
-      
-      //decentering the data, to pass them in the various cv iterations not centered
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(this->number_threads())
-#endif
-      for (size_t i = 0; i < this->n(); ++i)
-      {
-        m_X_non_cent.col(i) = this->X().col(i).array() + this->means();
-      }
     }
   
+  /*!
+  * @brief Getter for the input space for regularization parameter
+  * @return the private m_alphas (after a continuous cv: the validated regularization parameters, in ascending order)
+  */
+  inline std::vector<double> alphas() const {return m_alphas;};
+  
+  /*!
+  * @brief Number of threads of the cv: one if it is sharded across worker processes
+  */
+  inline int cv_number_threads() const {return m_search == ALPHA_SEARCH::GRID_SEARCH && m_number_processes > 1 ? 1 : this->number_threads();};
+  
+  /*!
+  * @brief Cv on the regularization parameter, exploring its input space according to the requested search
+  * @param cv object performing the cv on the regularization parameter
+  * @details After a continuous cv, the input space is replaced by the validated regularization parameters
+  */
+  template<typename CV_OBJ>
+  inline
+  void
+  alpha_search(CV_OBJ &cv)
+  {
+    if(m_search == ALPHA_SEARCH::BRENT_SEARCH)
+    {
+      cv.best_param_search_continuous();
+      m_alphas = cv.params();
+      KO_Log::message("Continuous cv on the regularization parameter: ",m_alphas.size()," validation errors evaluated");
+    }
+    else if(m_search == ALPHA_SEARCH::HALVING_SEARCH)
+    {
+      cv.best_param_search_halving();
+      KO_Log::message("Successive halving cv on the regularization parameter: ",cv.fits()," fits, ",cv.fits_saved()," saved with respect to the whole grid");
+    }
+    else if(m_number_processes > 1)
+    {
+      cv.best_param_search_sharded(m_number_processes);
+      KO_Log::message("Cv on the regularization parameter sharded across ",m_number_processes," worker processes");
+    }
+    else
+    {
+      cv.best_param_search();
+    }
+  }
+  
   /*!
   * @brief Method to perform PPCKO if cv is performed on regularization parameter
   * @details Selects the regularization parameter through cv, and then call the .KO_algo() method of the base class  
@@ -130,6 +173,9 @@ public:
   void 
   solving()
   {
+    //cv grid: threads to the loops over parameters and splits or to the kernels of the fits, according to the threading policy
+    threading_phase phase(KO_PHASE::CV_GRID,this->number_threads());
+    
     //factory to create the cv strategy
     auto strategy_cv = Factory_cv_strat<cv_strat>::cv_strat_obj(m_min_size_ts,m_max_size_ts);
 
@@ -137,13 +183,13 @@ public:
     if constexpr(k_imp == K_IMP::YES)
     {
       //lambda wrapper for the correct overload for prediction function
-      auto predictor = [](KO_Traits::StoringMatrix&& data, double alpha, int k, int number_threads) { return cv_pred_func<solver,K_IMP::YES,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(std::move(data),alpha,k,number_threads);};
+      auto predictor = [](const Eigen::Ref<const KO_Traits::StoringMatrix> &data, double alpha, int k, int number_threads) -> const KO_Traits::StoringVector & { return cv_pred_func<solver,K_IMP::YES,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(data,alpha,k,number_threads);};
       
       //cv knowing k
-      CV_alpha<cv_strat,cv_err_eval,k_imp,valid_err_ret> cv(std::move(m_X_non_cent),std::move(*strategy_cv),m_alphas,this->k(),predictor,this->number_threads());
+      CV_alpha<cv_strat,cv_err_eval,k_imp,valid_err_ret> cv(std::move(m_X_non_cent),std::move(*strategy_cv),m_alphas,this->k(),predictor,this->cv_number_threads(),m_budget);
       
       //best alpha
-      cv.best_param_search();
+      this->alpha_search(cv);
       this->alpha() = cv.param_best();      //finding the best alpha using CV
       
       //if errors to be saved
@@ -161,13 +207,13 @@ public:
     if constexpr(k_imp == K_IMP::NO)
     {
       //lambda wrapper for the correct overload for prediction function
-      auto predictor = [](KO_Traits::StoringMatrix&& data, double alpha, double threshold_ppc, int number_threads) { return cv_pred_func<solver,K_IMP::NO,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(std::move(data),alpha,threshold_ppc,number_threads);};
+      auto predictor = [](const Eigen::Ref<const KO_Traits::StoringMatrix> &data, double alpha, double threshold_ppc, int number_threads) -> const KO_Traits::StoringVector & { return cv_pred_func<solver,K_IMP::NO,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(data,alpha,threshold_ppc,number_threads);};
       
       //cv with k to be found with explanatory power
-      CV_alpha<cv_strat,cv_err_eval,k_imp,valid_err_ret> cv(std::move(m_X_non_cent),std::move(*strategy_cv),m_alphas,this->threshold_ppc(),predictor,this->number_threads());
+      CV_alpha<cv_strat,cv_err_eval,k_imp,valid_err_ret> cv(std::move(m_X_non_cent),std::move(*strategy_cv),m_alphas,this->threshold_ppc(),predictor,this->cv_number_threads(),m_budget);
       
       //best alpha
-      cv.best_param_search();
+      this->alpha_search(cv);
       this->alpha() = cv.param_best();      //finding the best alpha using CV
       
       //only if errors are saved
@@ -35,7 +35,7 @@
 /*!
 * @class PPC_KO_CV_alpha_k
 * @brief Derived from 'PPC_KO_base' class for computing PPCKO algorithm with cross-validation on both regularization parameter and number of retained PPCs
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -50,8 +50,8 @@ private:
   std::vector<double> m_alphas;
   /*!Input space for the number of retained PPCs*/
   std::vector<int> m_k_s;
-  /*!Fts not centered*/
-  KO_Traits::StoringMatrix m_X_non_cent; 
+  /*!Fts not centered (compressed if compiled with KO_COMPRESSED_FTS)*/
+  cv_storing_t m_X_non_cent;
   /*!Tolerance: the cv continues only if between two parameters, that are checked in increasing order, 
   * the absolute difference between two validation errors is bigger than tolerance*trace(covariance). 
   * If not, stops and look for k only between the tested ones 
@@ -61,6 +61,12 @@ private:
   int m_min_size_ts;
   /*!Biggest training set size (number of time instants)*/
   int m_max_size_ts;
+  /*!Time budget of the cv*/
+  cv_budget m_budget;
+  /*!File of the cache of the validation errors (empty: no cache)*/
+  std::string m_cache_file;
+  /*!Number of local worker processes across which the cv is sharded (1: no sharding)*/
+  int m_number_processes;
   
 public:
   
@@ -73,30 +79,26 @@ public:
   * @param min_size_ts smallest training set size (number of time instants)
   * @param max_size_ts biggest training set size (number of time instants)
   * @param number_threads number of threads for OMP
+  * @param budget time budget of the cv
+  * @param cache_file file of the cache of the validation errors for each pair and split (empty: no cache)
+  * @param number_processes number of local worker processes across which the cv is sharded (1: no sharding)
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   * @note eventual usage of 'pragma' directive for OMP
   */
   template<typename STOR_OBJ>
-  PPC_KO_CV_alpha_k(STOR_OBJ&& X, const std::vector<double> &alphas, const std::vector<int> &k_s, double toll, int min_size_ts, int max_size_ts, int number_threads) 
+  PPC_KO_CV_alpha_k(STOR_OBJ&& X, const std::vector<double> &alphas, const std::vector<int> &k_s, double toll, int min_size_ts, int max_size_ts, int number_threads, const cv_budget &budget = cv_budget(), const std::string &cache_file = "", int number_processes = 1) 
     : 
     PPC_KO_base<PPC_KO_CV_alpha_k,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(X),number_threads),
     m_alphas(alphas),
     m_k_s(k_s),
-    m_X_non_cent(this->m(),this->n()),
+    m_X_non_cent(this->X_non_cent()),
     m_toll(toll),
     m_min_size_ts(min_size_ts),
-    m_max_size_ts(max_size_ts)
-    {
-
-      //decentering the data, to pass them in the various cv iterations not centered     
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(this->number_threads())
-#endif
-      for (size_t i = 0; i < this->n(); ++i)
-      {
-        m_X_non_cent.col(i) = this->X().col(i).array() + this->means();
-      }
-    }
+    m_max_size_ts(max_size_ts),
+    m_budget(budget),
+    m_cache_file(cache_file),
+    m_number_processes(number_processes)
+    {}
   
 
   /*!
@@ -107,21 +109,45 @@ public:
   void 
   solving()
   {
+    //cv grid: threads to the loops over parameters and splits or to the kernels of the fits, according to the threading policy
+    threading_phase phase(KO_PHASE::CV_GRID,this->number_threads());
+    
     //factory to create the cv strategy
     auto strategy_cv = Factory_cv_strat<cv_strat>::cv_strat_obj(m_min_size_ts,m_max_size_ts);
   
     //lambda wrapper for the correct overload for prediction function
-    auto predictor = [](KO_Traits::StoringMatrix&& data, double alpha, int k, int number_threads) { return cv_pred_func<solver,K_IMP::YES,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(std::move(data),alpha,k,number_threads);};
+    auto predictor = [](const Eigen::Ref<const KO_Traits::StoringMatrix> &data, double alpha, int k, int number_threads) -> const KO_Traits::StoringVector & { return cv_pred_func<solver,K_IMP::YES,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(data,alpha,k,number_threads);};
 
     //to stop the algorithm if adding a PPC useless
     double toll_param = m_toll*this->trace_cov();
     
+    //cache of the validation errors, keyed by data and solver settings
+    std::unique_ptr<cv_cache> cache;
+    if(!m_cache_file.empty())
+    {
+      //data, solver settings, and everything of the build changing the validation errors: precision of the moments and fits in the fold workspace
+      auto fingerprint = cv_fingerprint().add(this->X_non_cent()).add(solver).add(cv_strat).add(cv_err_eval);
+      fingerprint.add(sizeof(KO_Moments_Traits::Scalar)).add(fold_workspace_fit(this->X_non_cent())).add(KO_FOLD_WORKSPACE_MAX_SIZE);
+#ifdef KO_COMPRESSED_FTS
+      fingerprint.add(true);
+#endif
+      cache = std::make_unique<cv_cache>(m_cache_file,fingerprint.value());
+    }
+    
     //cv for both parameters
-    CV_alpha_k<cv_strat,cv_err_eval,K_IMP::YES,valid_err_ret> cv(std::move(m_X_non_cent),std::move(*strategy_cv),m_alphas,m_k_s,toll_param,predictor,this->number_threads());
+    CV_alpha_k<cv_strat,cv_err_eval,K_IMP::YES,valid_err_ret> cv(std::move(m_X_non_cent),std::move(*strategy_cv),m_alphas,m_k_s,toll_param,predictor,m_number_processes > 1 ? 1 : this->number_threads(),m_budget,cache.get());
     
     //best pair alpha-k
-    cv.best_param_search();
-    
+    if(m_number_processes > 1)
+    {
+      cv.best_param_search_sharded(m_number_processes);
+      KO_Log::message("Cv sharded across ",m_number_processes," worker processes");
+    }
+    else
+    {
+      cv.best_param_search();
+    }
+    if(cache){  KO_Log::message("Cv cache: ",cache->hits()," validation errors reused, ",cache->added()," evaluated and added to ",m_cache_file);}
     this->alpha() = cv.alpha_best();
     //regularized covariance
     this->CovReg() = this->Cov().array() + this->alpha()*this->trace_cov()*(KO_Traits::StoringMatrix::Identity(this->m(),this->m()).array());
@@ -35,7 +35,7 @@
 /*!
 * @class PPC_KO_CV_k
 * @brief Derived from 'PPC_KO_base' class for computing PPCKO algorithm with cross-validation on the number of retained PPCs
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -48,8 +48,8 @@ private:
 
   /*!Input space for the number of retained PPCs*/
   std::vector<int> m_k_s;
-  /*!Fts not centered*/
-  KO_Traits::StoringMatrix m_X_non_cent;
+  /*!Fts not centered (compressed if compiled with KO_COMPRESSED_FTS)*/
+  cv_storing_t m_X_non_cent;
   /*!Tolerance: the cv continues only if between two parameters, that are checked in increasing order, 
   * the absolute difference between two validation errors is bigger than tolerance*trace(covariance). 
   * If not, stops and look for k only between the tested ones 
@@ -79,7 +79,7 @@ public:
     : 
     PPC_KO_base<PPC_KO_CV_k,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(X),number_threads),
     m_k_s(k_s),
-    m_X_non_cent(this->m(),this->n()),
+    m_X_non_cent(this->X_non_cent()),
     m_toll(toll),
     m_min_size_ts(min_size_ts),
     m_max_size_ts(max_size_ts)
@@ -87,15 +87,6 @@ public:
       //computing regularized covariance
       this->alpha() = alpha;
       this->CovReg() = this->Cov().array() + this->alpha()*this->trace_cov()*(KO_Traits::StoringMatrix::Identity(this->m(),this->m()).array());
-      
-      //decentering the data, to pass them in the various cv iterations not centered
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(this->number_threads())
-#endif
-      for (size_t i = 0; i < this->n(); ++i)
-      {
-        m_X_non_cent.col(i) = this->X().col(i).array() + this->means();
-      }
     }
   
   
@@ -107,11 +98,14 @@ public:
   void 
   solving()
   {
+    //cv grid: threads to the loops over parameters and splits or to the kernels of the fits, according to the threading policy
+    threading_phase phase(KO_PHASE::CV_GRID,this->number_threads());
+    
     //factory to create the cv strategy
     auto strategy_cv = Factory_cv_strat<cv_strat>::cv_strat_obj(m_min_size_ts,m_max_size_ts);
 
     //lambda wrapper for the correct overload for prediction function
-    auto predictor = [](KO_Traits::StoringMatrix&& data, double alpha, int k, int number_threads) { return cv_pred_func<solver,K_IMP::YES,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(std::move(data),alpha,k,number_threads);};
+    auto predictor = [](const Eigen::Ref<const KO_Traits::StoringMatrix> &data, double alpha, int k, int number_threads) -> const KO_Traits::StoringVector & { return cv_pred_func<solver,K_IMP::YES,VALID_ERR_RET::NO_err,cv_strat,cv_err_eval>(data,alpha,k,number_threads);};
     
     //to stop the algorithm if adding a PPC useless
     double toll_param = m_toll*this->trace_cov();
@@ -122,7 +116,6 @@ public:
     //best number of PPCs
     cv.best_param_search();
     this->k() = cv.param_best();
-    
     //if errors to be saved
     if constexpr (valid_err_ret == VALID_ERR_RET::YES_err)
     {
@@ -21,13 +21,15 @@
 #define KO_PPC_NOCV_CRTP_HPP
 
 #include "PPC_KO.hpp"
+#include "fold_workspace.hpp"
 
 
 /*!
 * @file PPC_KO_NoCV.hpp
 * @brief Class for computing PPCKO algortihm without cross-validation: alpha as parameter, k can be a parameter or selected through explanatory power criterion
 * @author Andrea Enrico Franzoni
-* @note definition of the function to make prediction on the validation set during cv process is done here: they simply wrap a PPCKO without cross-validation
+* @note definition of the function to make prediction on the validation set during cv process is done here: they simply wrap a PPCKO without cross-validation,
+*       or fit it inside the workspace of the calling thread
 */
 
 
@@ -35,7 +37,7 @@
 /*!
 * @class PPC_KO_NoCV
 * @brief Derived from 'PPC_KO_base' class for computing PPCKO algorithm without cross-validation
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -101,55 +103,94 @@ public:
 
 
 
+/*!
+* @brief If the fit on a cv fold can be performed inside the workspace of the calling thread
+* @param training_data training set (not centered)
+* @return true if the grid is not larger than KO_FOLD_WORKSPACE_MAX_SIZE (and than KO_TRACE_EST_MIN_SIZE), and there are no missing evaluations
+*/
+inline
+bool
+fold_workspace_fit(const Eigen::Ref<const KO_Traits::StoringMatrix> &training_data)
+{
+  return training_data.rows() >= 2 && training_data.cols() >= 2 && training_data.rows() <= KO_FOLD_WORKSPACE_MAX_SIZE && training_data.rows() < KO_TRACE_EST_MIN_SIZE && !training_data.hasNaN();
+}
+
+
 /*!
 * @brief Function to make prediction on the validation set during cross-validation process is k is imposed (by the user or by cv process)
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
 * @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
-* @param training_data training set (not centered)
+* @param training_data training set (not centered), view on the fts
 * @param alpha regularization parameter
 * @param k number of retained PPCs
 * @param number_threads number of threads for OMP
-* @return The prediction on the validation set
-* @details It creates a 'PPC_KO_NoCV' object with the given parameters, trains it with 'training_data' and makes prediction
+* @return The prediction on the validation set, valid until the next one of the calling thread
+* @details It creates a 'PPC_KO_NoCV' object with the given parameters, trains it with 'training_data' and makes prediction. With 'SOLVER::ex_solver', on
+*          complete training sets of grids not larger than KO_FOLD_WORKSPACE_MAX_SIZE, the fit is performed inside the workspace of the calling thread
 */
 template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
-KO_Traits::StoringVector 
-cv_pred_func(KO_Traits::StoringMatrix && training_data, double alpha, int k, int number_threads)
+const KO_Traits::StoringVector &
+cv_pred_func(const Eigen::Ref<const KO_Traits::StoringMatrix> &training_data, double alpha, int k, int number_threads)
 {  
+  //exact solver on a complete fts: fit inside the workspace of the thread, without heap allocations
+  if constexpr(solver == SOLVER::ex_solver && std::is_same_v<KO_Moments_Traits::Scalar,double>)
+  {
+    if(fold_workspace_fit(training_data))
+    {
+      return thread_fold_workspace().fit_predict(training_data,alpha,k);
+    }
+  }
+  
   //k imposed: template parameter fixed
-  PPC_KO_NoCV<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> iter(std::move(training_data),alpha,k,number_threads);
+  PPC_KO_NoCV<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> iter(KO_Traits::StoringMatrix(training_data),alpha,k,number_threads);
   iter.solving();
   
-  return iter.prediction(); 
+  //prediction kept by the calling thread
+  thread_local KO_Traits::StoringVector prediction;
+  prediction = iter.prediction();
+  return prediction; 
 };
 
 
 /*!
 * @brief Function to make prediction on the validation set during cross-validation process is k is selected through explanatory power criterion
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
 * @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
-* @param training_data training set (not centered)
+* @param training_data training set (not centered), view on the fts
 * @param alpha regularization parameter
 * @param threshold_ppc requested explanatory power by the retained PPCs
 * @param number_threads number of threads for OMP
-* @return The prediction on the validation set
-* @details It creates a 'PPC_KO_NoCV' object with the given parameters, trains it with 'training_data' and makes prediction
+* @return The prediction on the validation set, valid until the next one of the calling thread
+* @details It creates a 'PPC_KO_NoCV' object with the given parameters, trains it with 'training_data' and makes prediction. With 'SOLVER::ex_solver', on
+*          complete training sets of grids not larger than KO_FOLD_WORKSPACE_MAX_SIZE, the fit is performed inside the workspace of the calling thread
 */
 template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
-KO_Traits::StoringVector 
-cv_pred_func(KO_Traits::StoringMatrix && training_data, double alpha, double threshold_ppc, int number_threads)
+const KO_Traits::StoringVector &
+cv_pred_func(const Eigen::Ref<const KO_Traits::StoringMatrix> &training_data, double alpha, double threshold_ppc, int number_threads)
 {  
+  //exact solver on a complete fts: fit inside the workspace of the thread, without heap allocations
+  if constexpr(solver == SOLVER::ex_solver && std::is_same_v<KO_Moments_Traits::Scalar,double>)
+  {
+    if(fold_workspace_fit(training_data))
+    {
+      return thread_fold_workspace().fit_predict(training_data,alpha,0,threshold_ppc);
+    }
+  }
+  
   //k not imposed: template parameter fixed
-  PPC_KO_NoCV<solver,K_IMP::NO,valid_err_ret,cv_strat,cv_err_eval> iter(std::move(training_data),alpha,threshold_ppc,number_threads);
+  PPC_KO_NoCV<solver,K_IMP::NO,valid_err_ret,cv_strat,cv_err_eval> iter(KO_Traits::StoringMatrix(training_data),alpha,threshold_ppc,number_threads);
   iter.solving();
   
-  return iter.prediction(); 
+  //prediction kept by the calling thread
+  thread_local KO_Traits::StoringVector prediction;
+  prediction = iter.prediction();
+  return prediction; 
 };
 
 #endif  //KO_PPC_NOCV_CRTP_HPP
\ No newline at end of file
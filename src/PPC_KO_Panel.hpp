@@ -0,0 +1,125 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_PPC_PANEL_CRTP_HPP
+#define KO_PPC_PANEL_CRTP_HPP
+
+#include "PPC_KO.hpp"
+
+
+/*!
+* @file PPC_KO_Panel.hpp
+* @brief Class for computing PPCKO algortihm over a panel of fts sharing the dynamics: one operator is estimated from the pooled moments, without cross-validation
+* @author Andrea Enrico Franzoni
+*/
+
+
+
+/*!
+* @class PPC_KO_Panel
+* @brief Derived from 'PPC_KO_base' class for computing PPCKO algorithm over a panel of fts, without cross-validation
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
+* @tparam k_imp if k is imposed or has to be found through explanatory power criterion
+* @tparam valid_err_ret if validation error are stored
+* @tparam cv_strat strategy for splitting training/validation sets
+* @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
+* @details Each fts is centered with its own mean function, and predicted from its own last instant
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval > 
+class PPC_KO_Panel : public PPC_KO_base<PPC_KO_Panel<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>
+{
+private:
+  
+  /*!Number of time instants of each fts of the panel*/
+  std::vector<std::size_t> m_panel_sizes;
+  
+public:
+  
+  /*!
+  * @brief Constructor for the panel version
+  * @param X fts of the panel, stacked one after the other along the columns
+  * @param panel_sizes number of time instants of each fts of the panel
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs (used if k_imp = K_IMP::YES)
+  * @param threshold_ppc requested explanatory power of the retained PPCs (used if k_imp = K_IMP::NO)
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_Panel(STOR_OBJ&& X, const std::vector<std::size_t> &panel_sizes, double alpha, int k, double threshold_ppc, int number_threads)
+    :   PPC_KO_base<PPC_KO_Panel,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(X),panel_sizes,number_threads), m_panel_sizes(panel_sizes)
+    { 
+      //saving parameters in the base class
+      this->alpha() = alpha;
+      if constexpr(k_imp == K_IMP::YES){  this->k() = k;}  else{  this->threshold_ppc() = threshold_ppc;}
+      //computing the regularized covariance
+      this->CovReg() = this->Cov().array() + this->alpha()*this->trace_cov()*(KO_Traits::StoringMatrix::Identity(this->m(),this->m()).array());
+    }
+  
+  /*!
+  * @brief Method to perform PPCKO over the panel
+  * @details Wraps the .KO_algo() method of the base class since parameters are known
+  */
+  inline 
+  void
+  solving()
+  {
+    //PPCKO
+    this->KO_algo(); 
+  }
+  
+  /*!
+  * @brief Performs h-step ahead prediction of each fts of the panel, for all the horizons h = 1,...,h_max. Its own mean function is added to each one
+  * @param h_max maximum forecasting horizon
+  * @return a matrix whose columns, from (s*h_max) to ((s+1)*h_max-1), are the predictions of the s-th fts
+  * @details As for a single fts, the scores of the last instant are propagated through the k x k matrix b'a
+  */
+  KO_Traits::StoringMatrix
+  panel_prediction(int h_max)
+  const
+  {
+    const std::size_t n_series = m_panel_sizes.size();
+    KO_Traits::StoringMatrix forecasts(this->m(),n_series*h_max);
+    
+    //last instant of each fts, and their scores onto the weights
+    const KO_Traits::StoringMatrix X = this->X();
+    KO_Traits::StoringMatrix last_instants(this->m(),n_series);
+    std::size_t end = 0;
+    for(std::size_t s = 0; s < n_series; ++s)
+    {
+      end += m_panel_sizes[s];
+      last_instants.col(s) = X.col(end-1);
+    }
+    const KO_Traits::StoringMatrix a = this->a();
+    const KO_Traits::StoringMatrix b = this->b();
+    KO_Traits::StoringMatrix z = b.transpose()*last_instants;
+    const KO_Traits::StoringMatrix ba = b.transpose()*a;
+    
+    for(int h = 0; h < h_max; ++h)
+    {
+      KO_Traits::StoringMatrix pred_h = a*z + this->panel_means();
+      for(std::size_t s = 0; s < n_series; ++s){  forecasts.col(s*h_max + h) = pred_h.col(s);}
+      z = ba*z;
+    }
+    
+    return forecasts;
+  }
+};
+
+#endif  //KO_PPC_PANEL_CRTP_HPP
@@ -20,10 +20,17 @@
 #include <RcppEigen.h>
 
 #include <string>
+#include <chrono>
+#include <algorithm>
+#include <limits>
 #include "traits_ko.hpp"
 #include "parameters_wrapper.hpp"
 #include "utils.hpp"
 #include "data_reader.hpp"
+#include "quadrature.hpp"
+#include "basis.hpp"
+#include "fpca.hpp"
+#include "multires_cv.hpp"
 #include "Factory_ko.hpp"
 
 #include "ADF_test.hpp"
@@ -40,6 +47,83 @@
 
 using namespace Rcpp;
 
+
+//checking for user interrupts without jumping out of the C++ stack: R_CheckUserInterrupt is run at R top level
+static void check_interrupt_fn(void*){  R_CheckUserInterrupt();}
+/*!
+* @brief Checking if the user asked to interrupt the computations (has to be called from the main thread)
+* @return true if an interrupt is pending
+*/
+inline bool r_interrupted(){  return R_ToplevelExec(check_interrupt_fn,nullptr) == FALSE;}
+
+
+/*!
+* @struct ko_settings
+* @brief Settings of a PPCKO call, shared by all the combinations of solver, imposition of k and returning of the validation errors
+*/
+struct ko_settings
+{
+  /*!Maximum forecasting horizon*/
+  int horizon = 1;
+  /*!Time budget of the cv, in seconds (0: no budget)*/
+  double budget_seconds = 0.0;
+  /*!File caching the validation errors (empty: no cache)*/
+  std::string cache_file;
+  /*!Number of local worker processes across which the cv grid is sharded*/
+  int num_processes = 1;
+  /*!Cv algorithm*/
+  std::string id_CV = CV_algo::CV1;
+  /*!Instant from which the time budget runs: shared by the coarse and the fine pass of a coarse-to-fine cv*/
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+
+/*!
+* @brief Passing the settings of the call to a PPCKO wrapper
+* @param ko pointer to the PPCKO wrapper
+* @param settings settings of the call
+* @details The time budget is what is left of the one of the call: the coarse pass of a coarse-to-fine cv consumes it as well
+*/
+template<typename KO_PTR>
+void
+configure_ko(KO_PTR &ko, const ko_settings &settings)
+{
+  //seconds left (still a deadline, even if already expired: only the first candidate is evaluated)
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - settings.start).count();
+  const double seconds = settings.budget_seconds > 0.0 ? std::max(settings.budget_seconds - elapsed,std::numeric_limits<double>::min()) : 0.0;
+  
+  ko->h_max()            = settings.horizon;
+  ko->budget()           = cv_budget(seconds,r_interrupted);
+  ko->cache_file()       = settings.cache_file;
+  ko->number_processes() = settings.num_processes;
+}
+
+
+/*!
+* @brief Solving a PPCKO wrapper with the settings of the call, mapping its results back onto the grid
+* @param ko pointer to the PPCKO wrapper
+* @param settings settings of the call
+* @param alphas input space for the regularization parameter: replaced by the validated ones after a continuous cv
+* @param basis_synthesis synthesis operator of the basis expansion (empty: no basis expansion)
+* @param quad_sqrt_w square root of the quadrature weights (empty: uniform grid)
+*/
+template<typename KO_PTR>
+void
+solve_ko(KO_PTR &ko, const ko_settings &settings, std::vector<double> &alphas, const KO_Traits::StoringMatrix &basis_synthesis, const KO_Traits::StoringArray &quad_sqrt_w)
+{
+  configure_ko(ko,settings);
+  ko->call_ko();
+  //buffers of the fits on the cv folds released, once no fit is running
+  release_fold_workspaces();
+  
+  //validated regularization parameters (continuous cv)
+  if(settings.id_CV == CV_algo::CV5){  alphas = ko->alphas_validated();}
+  
+  //mapping the results back onto the grid (if basis expansion and quadrature weights are used)
+  from_coefficients(ko->results(),basis_synthesis);
+  to_original_geometry(ko->results(),quad_sqrt_w);
+}
+
 //
 // [[Rcpp::depends(RcppEigen)]]
 
@@ -47,7 +131,7 @@ using namespace Rcpp;
 /*!
 * @brief Function to perform one-step ahead prediction of Functional Time Series of curves using PPCKO.
 * @param X Rcpp::NumericMatrix (matrix of double) containing the curve time series: each row (m) is the evaluation of the curve in a point of its domain, each column (n) a time instant
-* @param id_CV string denoting which version of the algorithm the user wants to use: 'NoCV', 'CV_alpha', 'CV_k' or 'CV' 
+* @param id_CV string denoting which version of the algorithm the user wants to use: 'NoCV', 'CV_alpha', 'CV_k', 'CV', 'CV_alpha_cont', 'CV_alpha_sh', 'GCV_alpha', 'ER_k' or 'GCV' 
 * @param alpha regularization parameter (positive real number)
 * @param k number of PPCs: if 0, is selected through explanatory power criterion; if between 1 and m: k is imposed
 * @param threshold_ppc minimum requested proportion of explanatory power: used only if k=0. Duble between 0 and 1
@@ -62,7 +146,17 @@ using namespace Rcpp;
 * @param err_ret true if validation errors are stored and returned, false if not
 * @param ex_solver true if solving PPCKO inverting the regularized covariance matrix, false if relaying on GEP to avoid id
 * @param num_threads number of threads to be used in OMP parallel directives
-* @param id_rem_nan string that defines how to handle NaNs for some instant: 'MR': replacing them with the mean of the fts in that point, 'ZR' with 0s
+* @param id_rem_nan string that defines how to handle NaNs for some instant: 'MR': replacing them with the mean of the fts in that point, 'ZR' with 0s, 'PC': keeping them, estimating covariance and cross-covariance with pairwise-complete observations
+* @param id_quadrature string that defines the L2 geometry on the grid of discrete evaluations: 'UNIF': uniform unweighted grid, 'TRAPZ': trapezoidal weights, 'SIMPS': Simpson weights
+* @param id_basis string that defines the basis onto which the curves are projected, performing PPCKO on the coefficients: 'NONE': no projection, 'BSPLINE': cubic B-splines, 'FOURIER': Fourier basis
+* @param num_basis number of basis functions (used only if 'id_basis' is not 'NONE')
+* @param threshold_fpca if not NULL, requested explained variance of the leading functional principal components onto which the curves are projected, performing PPCKO on their scores
+* @param coarse_step if greater than 1, the cv is performed firstly on the coarse grid made by every 'coarse_step'-th discrete evaluation, and then refined on the full grid within a neighbourhood of the coarse optimum
+* @param horizon maximum forecasting horizon: the predictions for all the horizons between 1 and it are computed
+* @param time_budget if not NULL, seconds available for the cv ('CV_alpha' and 'CV'): candidates are evaluated coarse grid first, and when the budget expires the best one among the evaluated ones is retained
+* @param cv_cache_file if not NULL, path of the file caching the validation error of each regularization parameter, number of PPCs and split ('CV' only): reruns on the same data and settings evaluate only the missing entries
+* @param num_processes number of local worker processes across which the grid of the cv is sharded ('CV_alpha' and 'CV' only, 1: no sharding). Each worker is single-threaded
+* @param id_threading string that defines how the threads are split, in each phase (moments, eigensolve, cv grid), between outer loops and inner kernels (Eigen, BLAS): 'AUTO': outer loops in the cv grid, inner kernels elsewhere, 'OUTER': always outer loops, 'INNER': always inner kernels. Nested parallelism is disabled
 * @return an R list containing:
 * - one step ahead prediction of the fts
 * - used regularization parameter
@@ -82,6 +176,8 @@ using namespace Rcpp;
 * - which PPCKO version has been performed
 * - input space for regularization parameter
 * - input space for the number of PPCs
+* - predictions of the fts for all the horizons between 1 and 'horizon' (only if horizon greater than 1)
+* The threading policy used, and the threads of outer loops and inner kernels for each phase, are recorded in the attribute 'Threading'
 */
 //
 // [[Rcpp::export]]
@@ -101,35 +197,100 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
                   bool                          err_ret       = false,
                   bool                          ex_solver     = true,
                   Rcpp::Nullable<int>           num_threads   = R_NilValue,
-                  Rcpp::Nullable<std::string>   id_rem_nan    = R_NilValue
+                  Rcpp::Nullable<std::string>   id_rem_nan    = R_NilValue,
+                  Rcpp::Nullable<std::string>   id_quadrature = R_NilValue,
+                  Rcpp::Nullable<std::string>   id_basis      = R_NilValue,
+                  int                           num_basis     = 20,
+                  Rcpp::Nullable<double>        threshold_fpca = R_NilValue,
+                  int                           coarse_step   = 1,
+                  int                           horizon       = 1,
+                  Rcpp::Nullable<double>        time_budget   = R_NilValue,
+                  Rcpp::Nullable<std::string>   cv_cache_file = R_NilValue,
+                  int                           num_processes = 1,
+                  Rcpp::Nullable<std::string>   id_threading  = R_NilValue
                   )
 { 
   using T = double;                   //real-values functional time series
   
   //wrapping and checking parameters
+  const BASIS id_b                   = wrap_id_basis(id_basis);
+  const int dim_space                = wrap_num_basis(num_basis,id_b,X.nrow());  //dimension of the space in which PPCKO is performed
   check_threshold_ppc(threshold_ppc);
   check_alpha(alpha);
-  check_k(k,X.nrow());
-  check_solver(ex_solver,id_CV,k);
+  check_k(k,dim_space);
   std::vector<double> alphas         = wrap_alpha_vec(alpha_vec);
-  std::vector<int> k_s               = wrap_k_vec(k_vec,X.nrow());
+  std::vector<int> k_s               = wrap_k_vec(k_vec,dim_space);
   const REM_NAN id_RN                = wrap_id_rem_nans(id_rem_nan);
+  const double thr_fpca              = wrap_threshold_fpca(threshold_fpca);
+  check_coarse_step(coarse_step,id_b,threshold_fpca.isNotNull());
+  check_horizon(horizon);
+  const double budget_seconds        = wrap_time_budget(time_budget);
+  const std::string cache_file       = wrap_cv_cache_file(cv_cache_file,id_CV);
+  check_num_processes(num_processes,id_CV);
+  const THREADING id_thr             = wrap_id_threading(id_threading);
+  const QUADRATURE id_quad           = wrap_id_quadrature(id_quadrature);
   std::vector<double> disc_ev_points = wrap_disc_ev(disc_ev,left_extreme,right_extreme,X.nrow());
   auto sizes_CV_sets                 = wrap_sizes_set_CV(min_size_ts,max_size_ts,X.ncol());
   int min_dim_train_set              = sizes_CV_sets.first;
   int max_dim_train_set              = sizes_CV_sets.second;
   int number_threads                 = wrap_num_thread(num_threads);
+  //threading policy: active until returning
+  threading_policy policy(id_thr);
 
   //reading data, handling NANs
   auto data_read = reader_data<T>(X,id_RN);
   KO_Traits::StoringMatrix x = data_read.first;
+  
+  //grid of the discrete evaluations
+  Geometry::Mesh1D grid(Geometry::GivenNodes(Geometry::Domain1D(left_extreme,right_extreme),disc_ev_points));
+  
+  //quadrature weights on the grid: folded into the fts as a diagonal similarity transform
+  KO_Traits::StoringArray quad_sqrt_w;
+  if(id_quad != QUADRATURE::UNIF)
+  {
+    quad_sqrt_w = quadrature_sqrt_weights(quadrature_weights(grid,id_quad),data_read.second);
+    to_weighted_geometry(x,quad_sqrt_w);
+  }
+  
+  //basis expansion: PPCKO is performed on the coefficients
+  KO_Traits::StoringMatrix basis_synthesis;
+  if(id_b != BASIS::NONE)
+  {
+    auto basis_maps = basis_coordinates(basis_evaluation(grid,id_b,dim_space),data_read.second,quad_sqrt_w);
+    to_coefficients(x,basis_maps.first);
+    basis_synthesis = std::move(basis_maps.second);
+  }
+  
+  //functional principal components: PPCKO is performed on the scores along the leading ones
+  if(threshold_fpca.isNotNull())
+  {
+    auto fpca_maps = fpca_coordinates(x,thr_fpca);
+    to_coefficients(x,fpca_maps.first);
+    basis_synthesis = basis_synthesis.size()==0 ? fpca_maps.second : KO_Traits::StoringMatrix(basis_synthesis*fpca_maps.second);
+    //number of PPCs cannot be greater than the number of retained FPCs
+    check_k(k,x.rows());
+    k_s = wrap_k_vec(k_vec,x.rows());
+  }
+  
+  //rows on the coarse grid, for the coarse-to-fine cv
+  std::vector<int> rows_coarse = coarse_rows(data_read.second,X.nrow(),X.nrow(),coarse_step);
     
   //returning element
   Rcpp::List l;
+  //predictions for all the horizons
+  KO_Traits::StoringMatrix predictions;
+  
+  //settings shared by all the solvers
+  const ko_settings settings{horizon,budget_seconds,cache_file,num_processes,id_CV};
+  
+  //messages of the library (cv progress and summaries) on the R console, for this call
+  KO_Log::scoped_sink log_sink(r_console_log);
   
   Rcout << "--------------------------------------------------------------------------------------------" << std::endl;
   Rcout << "Running Kargin-Onatski algorithm, " << wrap_string_CV_to_be_printed(id_CV) << std::endl;
   Rcout << "Functional data defined over: [" << left_extreme << "," << right_extreme << "], with " << disc_ev_points.size() << " discrete evaluations" << std::endl;
+  if(threshold_fpca.isNotNull()){  Rcout << "Performed on the scores along the leading " << x.rows() << " functional principal components" << std::endl;}
+  Rcout << "Threading policy: " << threading_policy::name(id_thr) << ", with " << number_threads << " threads" << std::endl;
 
   if(ex_solver)               //EXACT ALGORITHM FOR PPCs
   {
@@ -141,11 +302,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
       { 
         //exact solver, k imposed, returning errors
         //solver
-        auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-        //solving
-        ko->call_ko();
+        auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+        //solving, mapping the results back onto the grid
+        solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
         //results
-        auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+        auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+        predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
         double alpha_used         = std::get<1>(ko->results());                                          //alpha used
         int n_PPC                 = std::get<2>(ko->results());                                          //number of retained PPCs
         auto scores_PPC           = std::get<3>(ko->results());                                          //scores along the k PPCs
@@ -192,11 +354,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
       { 
         //1D domain, k not imposed, returning errors
         //solver
-        auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-        //solving
-        ko->call_ko();
+        auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+        //solving, mapping the results back onto the grid
+        solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
         //results
-        auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+        auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+        predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
         double alpha_used         = std::get<1>(ko->results());                                          //alpha used
         int n_PPC                 = std::get<2>(ko->results());                                          //number of retained PPCs
         auto scores_PPC           = std::get<3>(ko->results());                                          //scores along the k PPCs
@@ -249,11 +412,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
     {
       //1D domain, k imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -295,11 +459,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
     {
       //1D domain, k not imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -347,11 +512,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
     { 
       //1D domain, k imposed, returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -396,11 +562,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
     { 
       //1D domain, k not imposed, returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -451,11 +618,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
     {
       //1D domain, k imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -497,11 +665,12 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
     {
       //1D domain, k not imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -549,6 +718,9 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
   l["CV"]                                   = id_CV;
   l["Alphas"]                               = alphas;
   l["K_s"]                                  = k_s;
+  if(horizon > 1){  l["Multi-step ahead predictions"] = add_nans_mat(predictions,data_read.second,X.nrow());}
+  //threading policy used, as attribute: elements of the list unchanged
+  l.attr("Threading") = threading_record(number_threads);
   
   return l;
 }
@@ -562,7 +734,7 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
 /*!
 * @brief Function to perform one-step ahead prediction of Functional Time Series of surfaces using PPCKO.
 * @param X Rcpp::NumericMatrix (matrix of double) containing the surface time series: each row (m) is the evaluation of the curve in a point of its domain, each column (n) a time instant
-* @param id_CV string denoting which version of the algorithm the user wants to use: 'NoCV', 'CV_alpha', 'CV_k' or 'CV' 
+* @param id_CV string denoting which version of the algorithm the user wants to use: 'NoCV', 'CV_alpha', 'CV_k', 'CV', 'CV_alpha_cont', 'CV_alpha_sh', 'GCV_alpha', 'ER_k' or 'GCV' 
 * @param alpha regularization parameter (positive real number)
 * @param k number of PPCs: if 0, is selected through explanatory power criterion; if between 1 and m: k is imposed
 * @param threshold_ppc minimum requested proportion of explanatory power: used only if k=0. Duble between 0 and 1
@@ -582,7 +754,19 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
 * @param err_ret true if validation errors are stored and returned, false if not
 * @param ex_solver true if solving PPCKO inverting the regularized covariance matrix, false if relaying on GEP to avoid id
 * @param num_threads number of threads to be used in OMP parallel directives
-* @param id_rem_nan string that defines how to handle NaNs for some instant: 'MR': replacing them with the mean of the fts in that point, 'ZR' with 0s
+* @param id_rem_nan string that defines how to handle NaNs for some instant: 'MR': replacing them with the mean of the fts in that point, 'ZR' with 0s, 'PC': keeping them, estimating covariance and cross-covariance with pairwise-complete observations
+* @param id_quadrature string that defines the L2 geometry on the grid of discrete evaluations: 'UNIF': uniform unweighted grid, 'TRAPZ': trapezoidal weights, 'SIMPS': Simpson weights
+* @param id_basis string that defines the basis onto which the surfaces are projected, performing PPCKO on the coefficients: 'NONE': no projection, 'BSPLINE': tensor-product cubic B-splines, 'FOURIER': tensor-product Fourier basis
+* @param num_basis_x1 number of basis functions along dimension 1 (used only if 'id_basis' is not 'NONE')
+* @param num_basis_x2 number of basis functions along dimension 2 (used only if 'id_basis' is not 'NONE')
+* @param separable true if covariance and cross-covariance are estimated as Kronecker products of the two dimensions' factors (only with ex_solver and 'NoCV')
+* @param threshold_fpca if not NULL, requested explained variance of the leading functional principal components onto which the surfaces are projected, performing PPCKO on their scores
+* @param coarse_step if greater than 1, the cv is performed firstly on the coarse grid made by every 'coarse_step'-th discrete evaluation along each dimension, and then refined on the full grid within a neighbourhood of the coarse optimum
+* @param horizon maximum forecasting horizon: the predictions for all the horizons between 1 and it are computed
+* @param time_budget if not NULL, seconds available for the cv ('CV_alpha' and 'CV'): candidates are evaluated coarse grid first, and when the budget expires the best one among the evaluated ones is retained
+* @param cv_cache_file if not NULL, path of the file caching the validation error of each regularization parameter, number of PPCs and split ('CV' only): reruns on the same data and settings evaluate only the missing entries
+* @param num_processes number of local worker processes across which the grid of the cv is sharded ('CV_alpha' and 'CV' only, 1: no sharding). Each worker is single-threaded
+* @param id_threading string that defines how the threads are split, in each phase (moments, eigensolve, cv grid), between outer loops and inner kernels (Eigen, BLAS): 'AUTO': outer loops in the cv grid, inner kernels elsewhere, 'OUTER': always outer loops, 'INNER': always inner kernels. Nested parallelism is disabled
 * @return an R list containing:
 * - one step ahead prediction of the fts
 * - used regularization parameter
@@ -605,6 +789,8 @@ Rcpp::List PPC_KO(Rcpp::NumericMatrix           X,
 * - which PPCKO version has been performed
 * - input space for regularization parameter
 * - input space for the number of PPCs
+* - predictions of the fts for all the horizons between 1 and 'horizon' (only if horizon greater than 1)
+* The threading policy used, and the threads of outer loops and inner kernels for each phase, are recorded in the attribute 'Threading'
 */
 //
 // [[Rcpp::export]]
@@ -629,38 +815,111 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
                      bool                          err_ret          = false,
                      bool                          ex_solver        = true,
                      Rcpp::Nullable<int>           num_threads      = R_NilValue,
-                     Rcpp::Nullable<std::string>   id_rem_nan       = R_NilValue
+                     Rcpp::Nullable<std::string>   id_rem_nan       = R_NilValue,
+                     Rcpp::Nullable<std::string>   id_quadrature    = R_NilValue,
+                     Rcpp::Nullable<std::string>   id_basis         = R_NilValue,
+                     int                           num_basis_x1     = 5,
+                     int                           num_basis_x2     = 5,
+                     bool                          separable        = false,
+                     Rcpp::Nullable<double>        threshold_fpca   = R_NilValue,
+                     int                           coarse_step      = 1,
+                     int                           horizon          = 1,
+                     Rcpp::Nullable<double>        time_budget      = R_NilValue,
+                     Rcpp::Nullable<std::string>   cv_cache_file    = R_NilValue,
+                     int                           num_processes    = 1,
+                     Rcpp::Nullable<std::string>   id_threading     = R_NilValue
 )
 { 
   //2D DOMAIN
   using T = double;       //version for real-values time series
   
   //wrapping and checking parameters
+  const BASIS id_b          = wrap_id_basis(id_basis);
+  const int dim_basis_x1    = wrap_num_basis(num_basis_x1,id_b,num_disc_ev_x1);
+  const int dim_basis_x2    = wrap_num_basis(num_basis_x2,id_b,num_disc_ev_x2);
+  const int dim_space       = id_b == BASIS::NONE ? X.nrow() : dim_basis_x1*dim_basis_x2;  //dimension of the space in which PPCKO is performed
+  const int dim_sep_x1      = id_b == BASIS::NONE ? num_disc_ev_x1 : dim_basis_x1;           //dimensions of the surface for the separable estimator
+  const int dim_sep_x2      = id_b == BASIS::NONE ? num_disc_ev_x2 : dim_basis_x2;
   check_threshold_ppc(threshold_ppc);
   check_alpha(alpha);
-  check_k(k,X.nrow());
-  check_solver(ex_solver,id_CV,k);
+  check_k(k,dim_space);
+  check_separable(separable,ex_solver,id_CV);
+  const double thr_fpca      = wrap_threshold_fpca(threshold_fpca,separable);
+  check_coarse_step(coarse_step,id_b,threshold_fpca.isNotNull());
+  check_horizon(horizon);
+  const double budget_seconds = wrap_time_budget(time_budget);
+  const std::string cache_file = wrap_cv_cache_file(cv_cache_file,id_CV);
+  check_num_processes(num_processes,id_CV);
+  const THREADING id_thr     = wrap_id_threading(id_threading);
   std::vector<double> alphas = wrap_alpha_vec(alpha_vec);
-  std::vector<int> k_s       = wrap_k_vec(k_vec,X.nrow());
+  std::vector<int> k_s       = wrap_k_vec(k_vec,dim_space);
   const REM_NAN id_RN = wrap_id_rem_nans(id_rem_nan);
+  const QUADRATURE id_quad = wrap_id_quadrature(id_quadrature);
   std::vector<double> disc_ev_points_x1 = wrap_disc_ev(disc_ev_x1,left_extreme_x1,right_extreme_x1,num_disc_ev_x1);
   std::vector<double> disc_ev_points_x2 = wrap_disc_ev(disc_ev_x2,left_extreme_x2,right_extreme_x2,num_disc_ev_x2);
   auto sizes_CV_sets                    = wrap_sizes_set_CV(min_size_ts,max_size_ts,X.ncol());
   int min_dim_train_set                 = sizes_CV_sets.first;
   int max_dim_train_set                 = sizes_CV_sets.second;
   int number_threads                    = wrap_num_thread(num_threads);
+  //threading policy: active until returning
+  threading_policy policy(id_thr);
 
   //reading data, handling NANs
   auto data_read = reader_data<T>(X,id_RN);
   KO_Traits::StoringMatrix x = data_read.first;
   
+  //grids of the discrete evaluations, along the two dimensions
+  Geometry::Mesh1D grid_x1(Geometry::GivenNodes(Geometry::Domain1D(left_extreme_x1,right_extreme_x1),disc_ev_points_x1));
+  Geometry::Mesh1D grid_x2(Geometry::GivenNodes(Geometry::Domain1D(left_extreme_x2,right_extreme_x2),disc_ev_points_x2));
+  
+  //tensor-product quadrature weights on the grid: folded into the fts as a diagonal similarity transform
+  KO_Traits::StoringArray quad_sqrt_w;
+  if(id_quad != QUADRATURE::UNIF)
+  {
+    quad_sqrt_w = quadrature_sqrt_weights(quadrature_weights(quadrature_weights(grid_x1,id_quad),quadrature_weights(grid_x2,id_quad)),data_read.second);
+    to_weighted_geometry(x,quad_sqrt_w);
+  }
+  
+  //tensor-product basis expansion: PPCKO is performed on the coefficients
+  KO_Traits::StoringMatrix basis_synthesis;
+  if(id_b != BASIS::NONE)
+  {
+    auto basis_maps = basis_coordinates(basis_evaluation(basis_evaluation(grid_x1,id_b,dim_basis_x1),basis_evaluation(grid_x2,id_b,dim_basis_x2)),data_read.second,quad_sqrt_w);
+    to_coefficients(x,basis_maps.first);
+    basis_synthesis = std::move(basis_maps.second);
+  }
+  
+  //functional principal components: PPCKO is performed on the scores along the leading ones
+  if(threshold_fpca.isNotNull())
+  {
+    auto fpca_maps = fpca_coordinates(x,thr_fpca);
+    to_coefficients(x,fpca_maps.first);
+    basis_synthesis = basis_synthesis.size()==0 ? fpca_maps.second : KO_Traits::StoringMatrix(basis_synthesis*fpca_maps.second);
+    //number of PPCs cannot be greater than the number of retained FPCs
+    check_k(k,x.rows());
+    k_s = wrap_k_vec(k_vec,x.rows());
+  }
+  
+  //rows on the coarse grid, for the coarse-to-fine cv
+  std::vector<int> rows_coarse = coarse_rows(data_read.second,X.nrow(),num_disc_ev_x1,coarse_step);
+  
   
   //returning element
   Rcpp::List l;
+  //predictions for all the horizons
+  KO_Traits::StoringMatrix predictions;
+  
+  //settings shared by all the solvers
+  const ko_settings settings{horizon,budget_seconds,cache_file,num_processes,id_CV};
+  
+  //messages of the library (cv progress and summaries) on the R console, for this call
+  KO_Log::scoped_sink log_sink(r_console_log);
   
   Rcout << "--------------------------------------------------------------------------------------------" << std::endl;
   Rcout << "Running Kargin-Onatski algorithm, " << wrap_string_CV_to_be_printed(id_CV) << std::endl;
   Rcout << "Functional data defined over: [" << left_extreme_x1 << "," << right_extreme_x1 << "] x [" << left_extreme_x2 << "," << right_extreme_x2 <<"], with " << disc_ev_points_x1.size() << " x " << disc_ev_points_x2.size() << " discrete evaluations" << std::endl;
+  if(threshold_fpca.isNotNull()){  Rcout << "Performed on the scores along the leading " << x.rows() << " functional principal components" << std::endl;}
+  Rcout << "Threading policy: " << threading_policy::name(id_thr) << ", with " << number_threads << " threads" << std::endl;
   
   if(ex_solver)   //EX SOLVER
   {
@@ -671,11 +930,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     {
       //2D domain, k imposed, returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = separable ? KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_separable(id_CV,std::move(x),dim_sep_x1,dim_sep_x2,alpha,k,threshold_ppc,number_threads) : KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -719,11 +979,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     {
       //2D domain, k not imposed, returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = separable ? KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_separable(id_CV,std::move(x),dim_sep_x1,dim_sep_x2,alpha,k,threshold_ppc,number_threads) : KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -774,11 +1035,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     { 
       //2D domain, k imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = separable ? KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_separable(id_CV,std::move(x),dim_sep_x1,dim_sep_x2,alpha,k,threshold_ppc,number_threads) : KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -820,11 +1082,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     {
       //2D domain, k not imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = separable ? KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_separable(id_CV,std::move(x),dim_sep_x1,dim_sep_x2,alpha,k,threshold_ppc,number_threads) : KO_Factory< SOLVER::ex_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -872,11 +1135,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     {
       //2D domain, k imposed, returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -920,11 +1184,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     {
       //2D domain, k not imposed, returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::YES_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -975,11 +1240,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     { 
       //2D domain, k imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -1021,11 +1287,12 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
     {
       //2D domain, k not imposed, not returning errors
       //solver
-      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads);
-      //solving
-      ko->call_ko();
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_multires(id_CV,std::move(x),rows_coarse,alpha,k,threshold_ppc,alphas,k_s,toll,min_dim_train_set,max_dim_train_set,number_threads,[&settings](auto &ko_coarse){ configure_ko(ko_coarse,settings);});
+      //solving, mapping the results back onto the grid
+      solve_ko(ko,settings,alphas,basis_synthesis,quad_sqrt_w);
       //results
-      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      auto one_step_ahead_pred  = from_col_to_matrix(add_nans_vec(std::get<0>(ko->results()).col(0),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());  //estimate of the prediction (NaN for the points in which you do not have measurements)
+      predictions               = std::get<0>(ko->results());                                           //predictions for all the horizons
       double alpha_used         = std::get<1>(ko->results());   //alpha used
       int n_PPC                 = std::get<2>(ko->results());   //number of PPC retained
       auto scores_PPC           = std::get<3>(ko->results());   //scores along the k PPCs
@@ -1080,6 +1347,369 @@ Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix           X,
   l["CV"]                                        = id_CV;
   l["Alphas"]                                    = alphas;
   l["K_s"]                                       = k_s;
+  if(horizon > 1)
+  {
+    Rcpp::List predictions_wrapped;
+    for(int h = 0; h < horizon; ++h)
+    {
+      std::string name_h = "Horizon " + std::to_string(h+1);
+      predictions_wrapped[name_h] = from_col_to_matrix(add_nans_vec(predictions.col(h),data_read.second,X.nrow()),disc_ev_points_x1.size(),disc_ev_points_x2.size());
+    }
+    l["Multi-step ahead predictions"] = predictions_wrapped;
+  }
+  //threading policy used, as attribute: elements of the list unchanged
+  l.attr("Threading") = threading_record(number_threads);
+  
+  return l;
+}
+
+
+/*!
+* @brief Function to perform PPCKO over a batch of independent curve fts, sharing the same grid of discrete evaluations. The fits are distributed among the threads
+* @param X R list of numeric matrices: each one contains a curve time series: each row (m, the same for all the fts) is the evaluation of the curve in a point of its domain, each column a time instant
+* @param id_CV string containing which version of PPCKO is performed ('NoCV': no cv, 'CV_alpha': cv on the regularization parameter, 'CV_k': cv on the number of retained PPCs, 'CV': cv on both, 'CV_alpha_cont': continuous cv on the regularization parameter, 'CV_alpha_sh': successive halving cv on the regularization parameter, 'GCV_alpha', 'ER_k', 'GCV': closed-form selection of the regularization parameter, the number of PPCs, or both)
+* @param alpha double containing the regularization parameter (if it is not cross-validated)
+* @param k integer containing the number of PPCs to be retained (if it is not cross-validated). If 0, explanatory power criterion is used
+* @param threshold_ppc double containing the requested explanatory power, if k not cross-validated and not imposed
+* @param alpha_vec vector containing the input space for the regularization parameter (if NULL: default one)
+* @param k_vec vector containing the input space for the number of retained PPCs (if NULL: default one)
+* @param toll tolerance over which cross-validation process stops looking for bigger number of PPCs if the validation errors between two consecutive iterations is smaller than it
+* @param disc_ev vector of double containing the points of the domain for which the curve's evaluations are available
+* @param left_extreme double indicating the left extreme of the domain of the curve
+* @param right_extreme double indicating the right extreme of the domain of the curve
+* @param min_size_ts time instants that define the smallest training set (between 2 and max_size_ts), for each fts
+* @param max_size_ts time instants that define the biggest training set (between min_size_ts and n-1), for each fts
+* @param ex_solver true if solving PPCKO inverting the regularized covariance matrix, false if relaying on GEP to avoid id
+* @param num_threads number of threads among which the fts are distributed
+* @param id_rem_nan string that defines how to handle NaNs for some instant: 'MR': replacing them with the mean of the fts in that point, 'ZR' with 0s, 'PC': keeping them
+* @param horizon maximum forecasting horizon: the predictions for all the horizons between 1 and it are computed
+* @return an R list containing:
+* - one step ahead prediction of each fts
+* - used regularization parameter for each fts
+* - number of retained PPCs for each fts
+* - scores along the PPCs for each fts
+* - cumulative explanatory power of the PPCs for each fts
+* - directions of the PPCs for each fts
+* - weights of the PPCs for each fts
+* - mean function of each fts
+* - points of the domain for which the evaluation of the curves are available
+* - left extreme of the curves' domain
+* - right extreme of the curves' domain
+* - which PPCKO version has been performed
+* - input space for regularization parameter
+* - input space for the number of PPCs
+* - predictions of each fts for all the horizons between 1 and 'horizon' (only if horizon greater than 1)
+*/
+//
+// [[Rcpp::export]]
+Rcpp::List PPC_KO_batch(Rcpp::List                    X,
+                        std::string                   id_CV         = "NoCV",
+                        double                        alpha         = 0.75,
+                        int                           k             = 0, 
+                        double                        threshold_ppc = 0.95,
+                        Rcpp::Nullable<NumericVector> alpha_vec     = R_NilValue,
+                        Rcpp::Nullable<IntegerVector> k_vec         = R_NilValue,
+                        double                        toll          = 1e-4,
+                        Rcpp::Nullable<NumericVector> disc_ev       = R_NilValue,
+                        double                        left_extreme  = 0,
+                        double                        right_extreme = 1,
+                        Rcpp::Nullable<int>           min_size_ts   = R_NilValue,
+                        Rcpp::Nullable<int>           max_size_ts   = R_NilValue,
+                        bool                          ex_solver     = true,
+                        Rcpp::Nullable<int>           num_threads   = R_NilValue,
+                        Rcpp::Nullable<std::string>   id_rem_nan    = R_NilValue,
+                        int                           horizon       = 1
+                        )
+{ 
+  using T = double;                   //real-values functional time series
+  
+  const int n_series = X.size();
+  if(n_series == 0)
+  {
+    std::string error_message1 = "Empty batch";
+    throw std::invalid_argument(error_message1);
+  }
+  const int m = Rcpp::as<Rcpp::NumericMatrix>(X[0]).nrow();
+  
+  //wrapping and checking parameters: once for the whole batch
+  check_threshold_ppc(threshold_ppc);
+  check_alpha(alpha);
+  check_k(k,m);
+  std::vector<double> alphas         = wrap_alpha_vec(alpha_vec);
+  std::vector<int> k_s               = wrap_k_vec(k_vec,m);
+  const REM_NAN id_RN                = wrap_id_rem_nans(id_rem_nan);
+  check_horizon(horizon);
+  std::vector<double> disc_ev_points = wrap_disc_ev(disc_ev,left_extreme,right_extreme,m);
+  int number_threads                 = wrap_num_thread(num_threads);
+  
+  //reading data, handling NANs: R objects are accessed only before the parallel fits
+  std::vector<KO_Traits::StoringMatrix> x;
+  x.reserve(n_series);
+  std::vector<std::vector<int>> rows_retained;
+  rows_retained.reserve(n_series);
+  std::vector<std::pair<int,int>> sizes_CV_sets;
+  sizes_CV_sets.reserve(n_series);
+  for(int i = 0; i < n_series; ++i)
+  {
+    Rcpp::NumericMatrix X_i = X[i];
+    if(X_i.nrow() != m)
+    {
+      std::string error_message2 = "All the fts of the batch have to be evaluated over the same grid";
+      throw std::invalid_argument(error_message2);
+    }
+    auto data_read = reader_data<T>(X_i,id_RN);
+    x.emplace_back(std::move(data_read.first));
+    rows_retained.emplace_back(std::move(data_read.second));
+    sizes_CV_sets.emplace_back(wrap_sizes_set_CV(min_size_ts,max_size_ts,X_i.ncol()));
+  }
+  
+  //messages of the library (cv progress and summaries) on the R console, for this call
+  KO_Log::scoped_sink log_sink(r_console_log);
+  
+  Rcout << "--------------------------------------------------------------------------------------------" << std::endl;
+  Rcout << "Running Kargin-Onatski algorithm, " << wrap_string_CV_to_be_printed(id_CV) << ", over a batch of " << n_series << " fts" << std::endl;
+  Rcout << "Functional data defined over: [" << left_extreme << "," << right_extreme << "], with " << disc_ev_points.size() << " discrete evaluations" << std::endl;
+  
+  //fitting: validation errors are not returned
+  std::vector<results_t<VALID_ERR_RET::NO_err>> results;
+  if(ex_solver)
+  {
+    results = k>0 ? KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_batch(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,sizes_CV_sets,horizon,number_threads)
+                  : KO_Factory< SOLVER::ex_solver, K_IMP::NO,  VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_batch(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,sizes_CV_sets,horizon,number_threads);
+  }
+  else
+  {
+    results = k>0 ? KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_batch(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,sizes_CV_sets,horizon,number_threads)
+                  : KO_Factory< SOLVER::gep_solver, K_IMP::NO,  VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_batch(id_CV,std::move(x),alpha,k,threshold_ppc,alphas,k_s,toll,sizes_CV_sets,horizon,number_threads);
+  }
+  
+  //results: predictions and mean functions are stored column-wise, one column for each fts
+  KO_Traits::StoringMatrix one_step_ahead_preds(m,n_series);
+  KO_Traits::StoringMatrix mean_funcs(m,n_series);
+  std::vector<double> alphas_used;
+  alphas_used.reserve(n_series);
+  std::vector<int> n_PPCs;
+  n_PPCs.reserve(n_series);
+  Rcpp::List scores_PPCs(n_series);
+  Rcpp::List explanatory_powers(n_series);
+  Rcpp::List directions_wrapped(n_series);
+  Rcpp::List weights_wrapped(n_series);
+  Rcpp::List predictions_wrapped(n_series);
+  for(int i = 0; i < n_series; ++i)
+  {
+    one_step_ahead_preds.col(i) = add_nans_vec(std::get<0>(results[i]).col(0),rows_retained[i],m);  //estimate of the prediction (NaN for the points in which you do not have measurements)
+    mean_funcs.col(i)           = add_nans_vec(std::get<8>(results[i]),rows_retained[i],m);         //mean function
+    alphas_used.emplace_back(std::get<1>(results[i]));                                              //alpha used
+    n_PPCs.emplace_back(std::get<2>(results[i]));                                                   //number of retained PPCs
+    scores_PPCs[i]              = std::get<3>(results[i]);                                          //scores along the k PPCs
+    explanatory_powers[i]       = std::get<4>(results[i]);                                          //explanatory power
+    directions_wrapped[i]       = add_nans_mat(std::get<5>(results[i]),rows_retained[i],m);         //PPCs directions
+    weights_wrapped[i]          = add_nans_mat(std::get<6>(results[i]),rows_retained[i],m);         //PPCs weights
+    if(horizon > 1){  predictions_wrapped[i] = add_nans_mat(std::get<0>(results[i]),rows_retained[i],m);}
+  }
+  
+  //saving results in a list, that will be returned
+  Rcpp::List l;
+  l["One-step ahead predictions"]           = one_step_ahead_preds;
+  l["Alpha"]                                = alphas_used;
+  l["Number of PPCs retained"]              = n_PPCs;
+  l["Scores along PPCs"]                    = scores_PPCs;
+  l["Explanatory power PPCs"]               = explanatory_powers;
+  l["Directions of PPCs"]                   = directions_wrapped;
+  l["Weights of PPCs"]                      = weights_wrapped;
+  l["Mean functions"]                       = mean_funcs;
+  l["Function discrete evaluations points"] = disc_ev_points;
+  l["Left extreme domain"]                  = left_extreme; 
+  l["Right extreme domain"]                 = right_extreme;
+  l["CV"]                                   = id_CV;
+  l["Alphas"]                               = alphas;
+  l["K_s"]                                  = k_s;
+  if(horizon > 1){  l["Multi-step ahead predictions"] = predictions_wrapped;}
+  
+  return l;
+}
+
+
+/*!
+* @brief Function to perform PPCKO over a panel of short curve fts sharing the same dynamics, and the same grid of discrete evaluations. One operator is estimated pooling the moments of all the fts
+* @param X R list of numeric matrices: each one contains a curve time series: each row (m, the same for all the fts) is the evaluation of the curve in a point of its domain, each column a time instant (at least 2)
+* @param alpha double containing the regularization parameter
+* @param k integer containing the number of PPCs to be retained. If 0, explanatory power criterion is used
+* @param threshold_ppc double containing the requested explanatory power, if k not imposed
+* @param disc_ev vector of double containing the points of the domain for which the curve's evaluations are available
+* @param left_extreme double indicating the left extreme of the domain of the curve
+* @param right_extreme double indicating the right extreme of the domain of the curve
+* @param ex_solver true if solving PPCKO inverting the regularized covariance matrix, false if relaying on GEP to avoid id
+* @param num_threads number of threads for OMP
+* @param id_rem_nan string that defines how to handle NaNs for some instant: 'MR': replacing them with the mean of the fts in that point, 'ZR' with 0s ('PC' is not available for a panel)
+* @param horizon maximum forecasting horizon: the predictions for all the horizons between 1 and it are computed
+* @return an R list containing:
+* - one step ahead prediction of each fts
+* - used regularization parameter
+* - number of retained PPCs
+* - scores along the PPCs
+* - cumulative explanatory power of the PPCs
+* - directions of the PPCs
+* - weights of the PPCs
+* - mean function of each fts
+* - points of the domain for which the evaluation of the curves are available
+* - left extreme of the curves' domain
+* - right extreme of the curves' domain
+* - predictions of each fts for all the horizons between 1 and 'horizon' (only if horizon greater than 1)
+*/
+//
+// [[Rcpp::export]]
+Rcpp::List PPC_KO_panel(Rcpp::List                    X,
+                        double                        alpha         = 0.75,
+                        int                           k             = 0, 
+                        double                        threshold_ppc = 0.95,
+                        Rcpp::Nullable<NumericVector> disc_ev       = R_NilValue,
+                        double                        left_extreme  = 0,
+                        double                        right_extreme = 1,
+                        bool                          ex_solver     = true,
+                        Rcpp::Nullable<int>           num_threads   = R_NilValue,
+                        Rcpp::Nullable<std::string>   id_rem_nan    = R_NilValue,
+                        int                           horizon       = 1
+                        )
+{ 
+  using T = double;                   //real-values functional time series
+  
+  const int n_series = X.size();
+  if(n_series == 0)
+  {
+    std::string error_message1 = "Empty panel";
+    throw std::invalid_argument(error_message1);
+  }
+  const int m = Rcpp::as<Rcpp::NumericMatrix>(X[0]).nrow();
+  
+  //wrapping and checking parameters
+  check_threshold_ppc(threshold_ppc);
+  check_alpha(alpha);
+  check_k(k,m);
+  const REM_NAN id_RN                = wrap_id_rem_nans(id_rem_nan);
+  check_horizon(horizon);
+  std::vector<double> disc_ev_points = wrap_disc_ev(disc_ev,left_extreme,right_extreme,m);
+  int number_threads                 = wrap_num_thread(num_threads);
+  
+  //reading data, handling NANs: the fts are stacked one after the other along the columns
+  std::vector<KO_Traits::StoringMatrix> x;
+  x.reserve(n_series);
+  std::vector<std::size_t> panel_sizes;
+  panel_sizes.reserve(n_series);
+  std::vector<int> rows_retained;
+  for(int i = 0; i < n_series; ++i)
+  {
+    Rcpp::NumericMatrix X_i = X[i];
+    if(X_i.nrow() != m)
+    {
+      std::string error_message2 = "All the fts of the panel have to be evaluated over the same grid";
+      throw std::invalid_argument(error_message2);
+    }
+    if(X_i.ncol() < 2)
+    {
+      std::string error_message3 = "Each fts of the panel has to contain at least 2 time instants";
+      throw std::invalid_argument(error_message3);
+    }
+    auto data_read = reader_data<T>(X_i,id_RN);
+    if(data_read.first.hasNaN())
+    {
+      std::string error_message4 = "Missing evaluations have to be imputed ('MR' or 'ZR') for a panel of fts";
+      throw std::invalid_argument(error_message4);
+    }
+    if(i == 0){  rows_retained = std::move(data_read.second);}
+    else if(data_read.second != rows_retained)
+    {
+      std::string error_message5 = "The points without any evaluation have to be the same for all the fts of the panel";
+      throw std::invalid_argument(error_message5);
+    }
+    panel_sizes.emplace_back(static_cast<std::size_t>(X_i.ncol()));
+    x.emplace_back(std::move(data_read.first));
+  }
+  
+  KO_Traits::StoringMatrix x_panel(x[0].rows(),std::reduce(panel_sizes.cbegin(),panel_sizes.cend(),static_cast<std::size_t>(0)));
+  std::size_t start = 0;
+  for(int i = 0; i < n_series; ++i)
+  {
+    x_panel.middleCols(start,panel_sizes[i]) = x[i];
+    start += panel_sizes[i];
+  }
+  x.clear();
+  
+  //messages of the library (cv progress and summaries) on the R console, for this call
+  KO_Log::scoped_sink log_sink(r_console_log);
+  
+  Rcout << "--------------------------------------------------------------------------------------------" << std::endl;
+  Rcout << "Running Kargin-Onatski algorithm, " << wrap_string_CV_to_be_printed(CV_algo::CV1) << ", over a panel of " << n_series << " fts" << std::endl;
+  Rcout << "Functional data defined over: [" << left_extreme << "," << right_extreme << "], with " << disc_ev_points.size() << " discrete evaluations" << std::endl;
+  
+  //fitting: no cross-validation, validation errors are not returned
+  KO_Traits::StoringMatrix panel_means;
+  results_t<VALID_ERR_RET::NO_err> results;
+  if(ex_solver)
+  {
+    if(k>0)
+    {
+      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_panel(CV_algo::CV1,std::move(x_panel),panel_sizes,alpha,k,threshold_ppc,number_threads);
+      configure_ko(ko,ko_settings{horizon});
+      ko->call_ko();
+      results = ko->results();
+      panel_means = ko->panel_means();
+    }
+    else
+    {
+      auto ko = KO_Factory< SOLVER::ex_solver, K_IMP::NO,  VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_panel(CV_algo::CV1,std::move(x_panel),panel_sizes,alpha,k,threshold_ppc,number_threads);
+      configure_ko(ko,ko_settings{horizon});
+      ko->call_ko();
+      results = ko->results();
+      panel_means = ko->panel_means();
+    }
+  }
+  else
+  {
+    if(k>0)
+    {
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::YES, VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_panel(CV_algo::CV1,std::move(x_panel),panel_sizes,alpha,k,threshold_ppc,number_threads);
+      configure_ko(ko,ko_settings{horizon});
+      ko->call_ko();
+      results = ko->results();
+      panel_means = ko->panel_means();
+    }
+    else
+    {
+      auto ko = KO_Factory< SOLVER::gep_solver, K_IMP::NO,  VALID_ERR_RET::NO_err, CV_STRAT::AUGMENTING_WINDOW, CV_ERR_EVAL::MSE >::KO_solver_panel(CV_algo::CV1,std::move(x_panel),panel_sizes,alpha,k,threshold_ppc,number_threads);
+      configure_ko(ko,ko_settings{horizon});
+      ko->call_ko();
+      results = ko->results();
+      panel_means = ko->panel_means();
+    }
+  }
+  
+  //results: predictions and mean functions are stored column-wise, one column for each fts
+  const KO_Traits::StoringMatrix & predictions = std::get<0>(results);
+  KO_Traits::StoringMatrix one_step_ahead_preds(m,n_series);
+  KO_Traits::StoringMatrix mean_funcs(m,n_series);
+  Rcpp::List predictions_wrapped(n_series);
+  for(int i = 0; i < n_series; ++i)
+  {
+    one_step_ahead_preds.col(i) = add_nans_vec(predictions.col(i*horizon),rows_retained,m);                                 //estimate of the prediction (NaN for the points in which you do not have measurements)
+    mean_funcs.col(i)           = add_nans_vec(panel_means.col(i),rows_retained,m);                                         //mean function
+    if(horizon > 1){  predictions_wrapped[i] = add_nans_mat(predictions.middleCols(i*horizon,horizon),rows_retained,m);}
+  }
+  
+  //saving results in a list, that will be returned
+  Rcpp::List l;
+  l["One-step ahead predictions"]           = one_step_ahead_preds;
+  l["Alpha"]                                = std::get<1>(results);
+  l["Number of PPCs retained"]              = std::get<2>(results);
+  l["Scores along PPCs"]                    = std::get<3>(results);
+  l["Explanatory power PPCs"]               = std::get<4>(results);
+  l["Directions of PPCs"]                   = add_nans_mat(std::get<5>(results),rows_retained,m);
+  l["Weights of PPCs"]                      = add_nans_mat(std::get<6>(results),rows_retained,m);
+  l["Mean functions"]                       = mean_funcs;
+  l["Function discrete evaluations points"] = disc_ev_points;
+  l["Left extreme domain"]                  = left_extreme; 
+  l["Right extreme domain"]                 = right_extreme;
+  if(horizon > 1){  l["Multi-step ahead predictions"] = predictions_wrapped;}
   
   return l;
 }
@@ -1278,4 +1908,41 @@ Rcpp::NumericMatrix data_2d_wrapper_from_array(Rcpp::NumericVector Xt)
   }
   
   return x;
-}
\ No newline at end of file
+}
+
+
+/*!
+* @brief Function to map an R array into a coherent list for PPC_KO_batch
+* @param Xt an R array such that element [i,j,l] represents the l-th curve fts in the evaluation x_i at instant j
+* @return Rcpp::List containing, for each fts, a Rcpp::NumericMatrix (matrix of double): each row (m) is the evaluation of the curve in a point of its domain, each column (n) a time instant
+*/
+//
+// [[Rcpp::export]]
+Rcpp::List data_batch_wrapper_from_array(Rcpp::NumericVector Xt)
+{
+  //obtaining the dimensions from the array
+  IntegerVector dimensions = Xt.attr("dim");
+  int number_point_evaluations = dimensions[0];
+  int number_time_instants = dimensions[1];
+  int number_series = dimensions[2];
+  
+  if(number_series==0)
+  {
+    std::string error_message1 = "Empty array";
+    throw std::invalid_argument(error_message1);
+  }
+  
+  //object that will be returned
+  Rcpp::List x(number_series);
+  
+  //each slice is contiguous in the array: copied as it is
+  const int slice_size = number_point_evaluations*number_time_instants;
+  for(int l = 0; l < number_series; ++l)
+  {
+    Rcpp::NumericMatrix series_data(number_point_evaluations,number_time_instants);
+    std::copy(Xt.begin() + l*slice_size, Xt.begin() + (l+1)*slice_size, series_data.begin());
+    x[l] = series_data;
+  }
+  
+  return x;
+}
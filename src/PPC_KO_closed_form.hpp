@@ -0,0 +1,174 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_PPC_CLOSED_FORM_CRTP_HPP
+#define KO_PPC_CLOSED_FORM_CRTP_HPP
+
+#include "PPC_KO.hpp"
+#include <limits>
+
+
+/*!
+* @file PPC_KO_closed_form.hpp
+* @brief Class for computing PPCKO algortihm selecting the regularization parameter and/or the number of retained PPCs in closed form, from the spectra of a single fit
+* @author Andrea Enrico Franzoni
+*/
+
+
+
+/*!
+* @class PPC_KO_closed_form
+* @brief Derived from 'PPC_KO_base' class for computing PPCKO algorithm with closed-form selection of the parameters
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
+* @tparam k_imp if k is imposed or has to be found through explanatory power criterion (K_IMP::YES if k is selected)
+* @tparam valid_err_ret if validation error are stored
+* @tparam cv_strat strategy for splitting training/validation sets
+* @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
+* @details The regularization parameter is selected through generalized cross-validation (GCV) of the full-rank ridge estimator C_1*(C + alpha*tr(C)*I)^(-1),
+*          computed along the whole regularization path from one eigendecomposition of the covariance. 
+*          The number of PPCs is selected through the eigenvalue-ratio criterion: the k maximizing lambda_k/lambda_(k+1), among the eigenvalues of phi
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval > 
+class PPC_KO_closed_form : public PPC_KO_base<PPC_KO_closed_form<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>
+{
+private:
+  
+  /*!Input space for regularization parameter*/
+  std::vector<double> m_alphas;
+  /*!Input space for the number of retained PPCs*/
+  std::vector<int> m_k_s;
+  /*!Which parameters are selected*/
+  CF_SELECTION m_selection;
+  
+public:
+  
+  /*!
+  * @brief Constructor for the closed-form selection
+  * @param X fts
+  * @param alphas regularization parameter input space (used if it is selected)
+  * @param k_s number of retained PPCs input space (used if it is selected)
+  * @param alpha regularization parameter (used if it is not selected)
+  * @param k number of retained PPCs (used if it is not selected and k_imp = K_IMP::YES)
+  * @param threshold_ppc requested explanatory power of the retained PPCs (used if k_imp = K_IMP::NO)
+  * @param selection which parameters are selected
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_closed_form(STOR_OBJ&& X, const std::vector<double> &alphas, const std::vector<int> &k_s, double alpha, int k, double threshold_ppc, CF_SELECTION selection, int number_threads)
+    :   PPC_KO_base<PPC_KO_closed_form,solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(X),number_threads), m_alphas(alphas), m_k_s(k_s), m_selection(selection)
+    { 
+      this->alpha() = alpha;
+      if constexpr(k_imp == K_IMP::YES){  this->k() = k;}  else{  this->threshold_ppc() = threshold_ppc;}
+    }
+  
+  /*!
+  * @brief GCV score of each element of the regularization parameter input space
+  * @return a vector containing RSS(alpha)/(1 - df(alpha)/(n-1))^2, with RSS the estimated one-step residual variance and df the effective degrees of freedom
+  * @details Being C = U*diag(c)*U' and g_i = ||C_1*u_i||^2, with lambda = alpha*tr(C): RSS = tr(C) - sum_i (2*g_i/(c_i+lambda) - c_i*g_i/(c_i+lambda)^2), 
+  *          df = sum_i c_i/(c_i+lambda). Each alpha costs O(m), after the O(m^3) eigendecomposition
+  */
+  std::vector<double>
+  gcv_scores()
+  const
+  {
+    Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> eig_cov(this->Cov());
+    const KO_Traits::StoringVector c = eig_cov.eigenvalues().cwiseMax(0.0);
+    const KO_Traits::StoringVector g = (this->CrossCov()*eig_cov.eigenvectors()).colwise().squaredNorm().transpose();
+    const double n_pairs = static_cast<double>(this->n() - 1);
+    
+    std::vector<double> scores(m_alphas.size());
+    std::transform(m_alphas.cbegin(),m_alphas.cend(),scores.begin(),[this,&c,&g,n_pairs](double alpha){
+      const KO_Traits::StoringArray den = c.array() + alpha*this->trace_cov();
+      const double rss = this->trace_cov() - (2.0*g.array()/den - c.array()*g.array()/den.square()).sum();
+      const double df  = (c.array()/den).sum();
+      return df < n_pairs ? rss/((1.0 - df/n_pairs)*(1.0 - df/n_pairs)) : std::numeric_limits<double>::infinity();});
+    
+    return scores;
+  }
+  
+  /*!
+  * @brief Eigenvalue ratio lambda_k/lambda_(k+1) of phi, for each element of the number of retained PPCs input space
+  * @return a vector containing the ratios (0 for the candidates for which lambda_(k+1) cannot be computed)
+  * @details Only the leading eigenvalues of phi are computed, through a fit retaining one PPC more than the biggest candidate (at most m/2)
+  */
+  std::vector<double>
+  eigenvalue_ratios()
+  {
+    const int k_max = std::min(*std::max_element(m_k_s.cbegin(),m_k_s.cend()) + 1,static_cast<int>(this->m())/2);
+    std::vector<double> ratios(m_k_s.size(),0.0);
+    if(k_max < 2){  return ratios;}
+    
+    //eigenvalues of phi, up to a constant, from the cumulative explanatory power
+    this->k() = k_max;
+    this->KO_algo();
+    std::vector<double> eigenvalues = this->explanatory_power();
+    std::adjacent_difference(eigenvalues.cbegin(),eigenvalues.cend(),eigenvalues.begin());
+    
+    std::transform(m_k_s.cbegin(),m_k_s.cend(),ratios.begin(),[&eigenvalues,k_max](int k_cand){
+      if(k_cand >= k_max){  return 0.0;}
+      return eigenvalues[k_cand] > 0.0 ? eigenvalues[k_cand-1]/eigenvalues[k_cand] : std::numeric_limits<double>::infinity();});
+    
+    return ratios;
+  }
+  
+  /*!
+  * @brief Method to perform PPCKO selecting the parameters in closed form
+  * @details Selects the regularization parameter, then the number of retained PPCs given it, and then call the .KO_algo() method of the base class.
+  *          The GCV scores (or the eigenvalue ratios, if only the number of PPCs is selected) are stored as validation errors
+  */
+  inline 
+  void
+  solving()
+  {
+    std::vector<double> criterion;
+    
+    //regularization parameter: minimum GCV score
+    if(m_selection != CF_SELECTION::CF_K)
+    {
+      criterion = this->gcv_scores();
+      this->alpha() = m_alphas[std::distance(criterion.cbegin(),std::min_element(criterion.cbegin(),criterion.cend()))];
+    }
+    
+    //computing the regularized covariance
+    this->CovReg() = this->Cov().array() + this->alpha()*this->trace_cov()*(KO_Traits::StoringMatrix::Identity(this->m(),this->m()).array());
+    
+    //number of PPCs: maximum eigenvalue ratio
+    if constexpr(k_imp == K_IMP::YES)
+    {
+      if(m_selection != CF_SELECTION::CF_ALPHA)
+      {
+        std::vector<double> ratios = this->eigenvalue_ratios();
+        this->k() = m_k_s[std::distance(ratios.cbegin(),std::max_element(ratios.cbegin(),ratios.cend()))];
+        if(m_selection == CF_SELECTION::CF_K){  criterion = std::move(ratios);}
+      }
+    }
+    
+    //PPCKO
+    this->KO_algo();
+    
+    //if errors to be saved
+    if constexpr(valid_err_ret == VALID_ERR_RET::YES_err)
+    {
+      this->ValidErr() = valid_err_cv_1_t(criterion);
+    }
+  }
+};
+
+#endif  //KO_PPC_CLOSED_FORM_CRTP_HPP
@@ -22,7 +22,6 @@
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
 #include "spectra/include/Spectra/MatOp/DenseSymMatProd.h"
-#include "spectra/include/Spectra/MatOp/DenseCholesky.h"
 #include "spectra/include/Spectra/SymEigsSolver.h"
 #include "spectra/include/Spectra/SymGEigsSolver.h"
 
@@ -35,13 +34,124 @@
 
 
 
+/*!
+* @brief Mean function, centering, covariance and cross-covariance estimates of a fts with missing evaluations
+* @details Missing evaluations are not imputed: each entry of the covariance (cross-covariance) is normalized by the number of 
+*          instants (pairs of consecutive instants) in which both the evaluations are available. Products and counts are 
+*          accumulated over blocks of time instants, so that the mask is never converted into a full m x n matrix of doubles.
+*          Entries without any available pair are set to 0.
+* @note the covariance estimate is not guaranteed to be positive semi-definite: the regularization is in charge of it
+*/
+template< class D, SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+void
+PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::masked_moments()
+{
+  //number of time instants accumulated at once
+  constexpr std::size_t block_size = 256;
+  
+  //availability of each evaluation (NaN is the only value not equal to itself)
+  m_mask = (m_X.array() == m_X.array());
+  
+  //mean function: only available evaluations, for each point of the domain
+  //(accumulated column by column: no m x n temporary)
+  KO_Traits::StoringArray counts = m_mask.rowwise().count().template cast<double>();
+  KO_Traits::StoringArray sums   = KO_Traits::StoringArray::Zero(m_m);
+  for (std::size_t i = 0; i < m_n; ++i){  sums += m_mask.col(i).select(m_X.col(i).array(),0.0);}
+  m_means = sums / (counts.max(1.0));
+  
+  //centering: missing evaluations are set to 0, so they do not contribute to the products
+  KO_Parallel::parallel_for(m_n,
+                            threading_policy::outer_threads(KO_PHASE::MOMENTS,m_number_threads),
+                            [this](std::size_t i){ m_X.col(i) = m_mask.col(i).select(m_X.col(i).array() - m_means, 0.0);});
+  
+  //accumulating products and number of available pairs
+  m_Cov      = KO_Traits::StoringMatrix::Zero(m_m,m_m);
+  m_CrossCov = KO_Traits::StoringMatrix::Zero(m_m,m_m);
+  KO_Traits::StoringMatrix pairs_cov       = KO_Traits::StoringMatrix::Zero(m_m,m_m);
+  KO_Traits::StoringMatrix pairs_cross_cov = KO_Traits::StoringMatrix::Zero(m_m,m_m);
+  
+  for (std::size_t start = 0; start < m_n; start += block_size)
+  {
+    const std::size_t size = std::min(block_size, m_n - start);
+    KO_Traits::StoringMatrix mask_block = m_mask.middleCols(start,size).template cast<double>().matrix();
+    
+    m_Cov.noalias()     += m_X.middleCols(start,size)*m_X.middleCols(start,size).transpose();
+    pairs_cov.noalias() += mask_block*mask_block.transpose();
+    
+    //cross-covariance: pairs (t+1,t), with t+1 in the block
+    const std::size_t start_lag = std::max(start,static_cast<std::size_t>(1));
+    const std::size_t size_lag  = start + size - start_lag;
+    if (size_lag > 0)
+    {
+      m_CrossCov.noalias()      += m_X.middleCols(start_lag,size_lag)*m_X.middleCols(start_lag-1,size_lag).transpose();
+      pairs_cross_cov.noalias() += m_mask.middleCols(start_lag,size_lag).template cast<double>().matrix()*m_mask.middleCols(start_lag-1,size_lag).template cast<double>().matrix().transpose();
+    }
+  }
+  
+  // covariance and cross-covariance operators estimates: normalizing each entry by its number of available pairs
+  m_Cov      = (pairs_cov.array() > 0.0).select(m_Cov.array() / pairs_cov.array(), 0.0).matrix();
+  m_CrossCov = (pairs_cross_cov.array() > 0.0).select(m_CrossCov.array() / pairs_cross_cov.array(), 0.0).matrix();
+}
+
+
+
+/*!
+* @brief Mean functions, centering, covariance and cross-covariance estimates of a panel of fts
+* @param panel_sizes number of time instants of each fts of the panel
+* @details Each fts is centered with its own mean function. The covariance is pooled over all the instants, the cross-covariance over
+*          all the pairs of consecutive instants of the same fts: a single product over the stacked panel, minus the pairs crossing two fts.
+*          The mean function of the panel is the average of the mean functions, weighted by the number of instants
+*/
+template< class D, SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+void
+PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::panel_moments(const std::vector<std::size_t> &panel_sizes)
+{
+  const std::size_t n_series = panel_sizes.size();
+  
+  //first instant of each fts in the stacked panel
+  std::vector<std::size_t> panel_starts(n_series);
+  std::exclusive_scan(panel_sizes.cbegin(),panel_sizes.cend(),panel_starts.begin(),static_cast<std::size_t>(0));
+  
+  //mean function of each fts, and centering
+  m_panel_means.resize(m_m,n_series);
+  KO_Parallel::parallel_for(n_series,
+                            threading_policy::outer_threads(KO_PHASE::MOMENTS,m_number_threads),
+                            [this,&panel_starts,&panel_sizes](std::size_t s)
+                            {
+                              m_panel_means.col(s) = m_X.middleCols(panel_starts[s],panel_sizes[s]).rowwise().mean();
+                              m_X.middleCols(panel_starts[s],panel_sizes[s]).colwise() -= m_panel_means.col(s);
+                            });
+  
+  KO_Traits::StoringVector weights(n_series);
+  std::transform(panel_sizes.cbegin(),panel_sizes.cend(),weights.begin(),[this](std::size_t n_s){return static_cast<double>(n_s)/static_cast<double>(m_n);});
+  m_means = (m_panel_means*weights).array();
+  
+  // covariance operator estimate: pooled over all the instants
+  m_Cov = ((m_X*m_X.transpose()).array())/static_cast<double>(m_n);
+  
+  // cross-covariance operator estimate: pooled over the pairs of consecutive instants, removing the ones crossing two fts
+  KO_Traits::StoringMatrix first_instants(m_m,n_series-1);
+  KO_Traits::StoringMatrix last_instants(m_m,n_series-1);
+  for (size_t s = 1; s < n_series; ++s)
+  {
+    first_instants.col(s-1) = m_X.col(panel_starts[s]);
+    last_instants.col(s-1)  = m_X.col(panel_starts[s]-1);
+  }
+  m_CrossCov = m_X.rightCols(m_n-1)*m_X.leftCols(m_n-1).transpose();
+  m_CrossCov.noalias() -= first_instants*last_instants.transpose();
+  m_CrossCov /= static_cast<double>(m_n-n_series);
+}
+
+
+
 /*!
 * @brief Retaining the the PPCs: pairs eigenvalue-eigenvector and their number
 * @return a tuple containing: the number of retained PPCs, the eigenvalues of phi/of GEP, the eigenvectors of phi/of GEP
 * @details The PPCs are computed according to the solver strategy using 'Spectra'. Only the first k pairs eigenvalue/eigenvactor are evaluated,
-*          corresponding to the k laregest eigenvalues, if k imposed. If instead (only for 'SOLVER::ex_solver') are computed
-*          using the explanatory power criterion, the k pairs eigenvalues-eigenvectors are computed increasing the number of computed
-*          ones until the requested explanatory power is reached
+*          corresponding to the k laregest eigenvalues, if k imposed. If instead are computed
+*          using the explanatory power criterion, the number of computed pairs is doubled until the requested explanatory power is reached,
+*          and the smallest number of leading pairs reaching it is retained. For 'SOLVER::ex_solver' on grids with at least KO_TRACE_EST_MIN_SIZE
+*          evaluations, phi is never assembled: it is applied matrix-free, and its trace is estimated through Hutch++
 */
 template< class D, SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
 std::tuple<int,KO_Traits::StoringVector,KO_Traits::StoringMatrix>
@@ -51,65 +161,126 @@ PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::PPC_retaine
   //exact solver: can be used for k not imp (selected through explanatory power criterion) and k imp (by the user of by cv process)
   if constexpr(solver == SOLVER::ex_solver)
   {
-    //Square root inverse of reg covariance: self-adjoint:exploiting it
-    Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> eigensolver_cov_reg(m_CovReg);
-    m_CovRegRoot = eigensolver_cov_reg.operatorInverseSqrt();
+    //whitening through the Cholesky factor of reg covariance (m_CovReg = LL'): L^(-1)*m_GammaSquared*L^(-T) has the same spectrum 
+    //of the one whitened through the inverse square root, avoiding its eigendecomposition
+    m_CovRegChol.compute(m_CovReg);
+    
+    //very large grids: phi is applied matrix-free, its trace (sum of phi eigenvalues) is estimated stochastically
+    if(m_m >= KO_TRACE_EST_MIN_SIZE)
+    {
+      phi_op op(m_CovRegChol,m_CrossCov);
+      
+      auto tot_exp_pow_est = hutchpp_trace(op,KO_TRACE_EST_MATVECS,threading_policy::outer_threads(KO_PHASE::EIGENSOLVE,m_number_threads));
+      m_tot_exp_pow     = tot_exp_pow_est.first;
+      m_tot_exp_pow_var = tot_exp_pow_est.second;
+      
+      return this->phi_eigenpairs(op);
+    }
+    
+    KO_Traits::StoringMatrix L_inv_CrossCov_t = m_CovRegChol.matrixL().solve(m_CrossCov.transpose());
 
-    //Phi estimate: self-adjoint:exploiting it
-    KO_Traits::StoringMatrix phi_hat = m_CovRegRoot*m_GammaSquared*m_CovRegRoot.transpose();
+    //Phi estimate: self-adjoint: only its lower part is computed, as the one used by Spectra
+    KO_Traits::StoringMatrix phi_hat = KO_Traits::StoringMatrix::Zero(m_m,m_m);
+    phi_hat.selfadjointView<Eigen::Lower>().rankUpdate(L_inv_CrossCov_t);
     //sum of phi eigenvalues: its trace
-    m_tot_exp_pow = phi_hat.trace();
+    m_tot_exp_pow = L_inv_CrossCov_t.squaredNorm();
+    L_inv_CrossCov_t.resize(0,0);
 
     //PPCS are found through Spectra, for efficiency
     Spectra::DenseSymMatProd<double> op(phi_hat);
     
-    if constexpr( k_imp == K_IMP::NO )    //number of PPCs to be selected through explanatory power
+    return this->phi_eigenpairs(op);
+  }
+
+  //gep solver: quicker, since the inverse square root of the regularized covariance is not needed
+  else if constexpr(solver == SOLVER::gep_solver)
+  {
+    //preparing GEP: m_GammaSquared*v = lambda*m_CovReg*v, v geigvct, lambda geigval
+    Spectra::DenseSymMatProd<double> op(m_GammaSquared);
+    m_CovRegChol.compute(m_CovReg);       //since it is a covariance: sdp: Cholesky dec for efficiency, shared by the trace and the gep
+    cov_reg_op Bop(m_CovRegChol);
+    
+    if constexpr(k_imp == K_IMP::NO)      //number of PPCs to be selected through explanatory power
     {
-      //compute i pairs, with i staring from 1, increasing i until the requested explnatory power is reached
-      for(std::size_t i = 0; i < m_m; ++i)
+      //sum of the geigenvalues: trace(m_CovReg^(-1)*m_GammaSquared) = ||L^(-1)*m_CrossCov'||_F^2, with m_CovReg = LL', through one triangular solve
+      m_tot_exp_pow = m_CovRegChol.matrixL().solve(m_CrossCov.transpose()).squaredNorm();
+      
+      //compute nev pairs, doubling nev until the requested explanatory power is reached (O(log k) solves): then only the pairs needed to reach it are retained
+      const int max_ppcs = m_m - 1;
+      for(int nev = 1; ; nev = std::min(2*nev,max_ppcs))
       {
-        int n_ppcs = i+1;
         //Spectra framework
-        Spectra::SymEigsSolver<Spectra::DenseSymMatProd<double>> eigsolver_phi(op, n_ppcs, 2*n_ppcs);
-        eigsolver_phi.init();
-        int nconv = eigsolver_phi.compute(Spectra::SortRule::LargestAlge);
-
-        //if explanatory power reached: return
-        if(eigsolver_phi.eigenvalues().sum()/m_tot_exp_pow >= m_threshold_ppc)
+        Spectra::SymGEigsSolver<Spectra::DenseSymMatProd<double>, cov_reg_op, Spectra::GEigsMode::Cholesky> eigsolver_ppc(op, Bop, nev, std::min(2*nev+1,static_cast<int>(m_m)));
+        eigsolver_ppc.init();
+        eigsolver_ppc.compute(Spectra::SortRule::LargestAlge);
+        
+        //if explanatory power reached (or no more pairs can be computed): return
+        const KO_Traits::StoringVector eigvals = eigsolver_ppc.eigenvalues();
+        const int n_ppcs = ppcs_reaching_threshold(eigvals,m_tot_exp_pow,m_threshold_ppc);
+        if(eigvals.head(n_ppcs).sum()/m_tot_exp_pow >= m_threshold_ppc || nev >= max_ppcs)
         {
-          return std::make_tuple(n_ppcs,eigsolver_phi.eigenvalues(),eigsolver_phi.eigenvectors());
+          return std::make_tuple(n_ppcs,eigvals.head(n_ppcs),eigsolver_ppc.eigenvectors().leftCols(n_ppcs));
         }
       }
-    } 
-    else              // number of PPCs already known (imposed by the user of by cv process)
+    }
+    else                                  // number of PPCs already known (imposed by the user of by cv process)
     {
       //Spectra framework
-      Spectra::SymEigsSolver<Spectra::DenseSymMatProd<double>> eigsolver_phi(op, m_k, 2*m_k);
-      eigsolver_phi.init();
-      int nconv = eigsolver_phi.compute(Spectra::SortRule::LargestAlge);
+      Spectra::SymGEigsSolver<Spectra::DenseSymMatProd<double>, cov_reg_op, Spectra::GEigsMode::Cholesky> eigsolver_ppc(op, Bop, m_k, 2*m_k);
+      eigsolver_ppc.init();
+      eigsolver_ppc.compute(Spectra::SortRule::LargestAlge);
+      //since the total sum of the eigenvalues is not for free: at least we can compare magnitude between the retained ones
+      m_tot_exp_pow = eigsolver_ppc.eigenvalues().sum();
       
-      return std::make_tuple(m_k,eigsolver_phi.eigenvalues(),eigsolver_phi.eigenvectors());
+      return std::make_tuple(m_k,eigsolver_ppc.eigenvalues(),eigsolver_ppc.eigenvectors());
     }
   }
+}
 
-  //gep solver: quicker, but only if you impose k by the user of by cv process
-  else if constexpr(solver == SOLVER::gep_solver)
+
+
+
+
+/*!
+* @brief Leading eigenpairs of phi ('SOLVER::ex_solver'): k imposed, or increasing their number until the requested explanatory power is reached
+* @tparam OP 'Spectra' operator for phi (dense or matrix-free)
+* @param op phi
+* @return a tuple containing: the number of retained PPCs, the eigenvalues of phi, the eigenvectors of phi
+*/
+template< class D, SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+template< typename OP >
+std::tuple<int,KO_Traits::StoringVector,KO_Traits::StoringMatrix>
+PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::phi_eigenpairs(OP &op)
+const
+{
+  if constexpr( k_imp == K_IMP::NO )    //number of PPCs to be selected through explanatory power
   {
-    if constexpr(k_imp == K_IMP::YES)    
+    //compute nev pairs, doubling nev until the requested explanatory power is reached (O(log k) solves): then only the pairs needed to reach it are retained
+    const int max_ppcs = m_m - 1;
+    for(int nev = 1; ; nev = std::min(2*nev,max_ppcs))
     {
-      //preparing GEP: m_GammaSquared*v = lambda*m_CovReg*v, v geigvct, lambda geigval
-      Spectra::DenseSymMatProd<double> op(m_GammaSquared);
-      Spectra::DenseCholesky<double>  Bop(m_CovReg);    //since it is a covariance: sdp: Cholesky dec for efficiency
-
       //Spectra framework
-      Spectra::SymGEigsSolver<Spectra::DenseSymMatProd<double>, Spectra::DenseCholesky<double>, Spectra::GEigsMode::Cholesky> eigsolver_ppc(op, Bop, m_k, 2*m_k);
-      eigsolver_ppc.init();
-      int nconv = eigsolver_ppc.compute(Spectra::SortRule::LargestAlge);
-      //since the total sum of the eigenvalues is not for free: at least we can compare magnitude between the retained ones
-      m_tot_exp_pow = eigsolver_ppc.eigenvalues().sum();
-      
-      return std::make_tuple(m_k,eigsolver_ppc.eigenvalues(),eigsolver_ppc.eigenvectors());
+      Spectra::SymEigsSolver<OP> eigsolver_phi(op, nev, std::min(2*nev+1,static_cast<int>(m_m)));
+      eigsolver_phi.init();
+      eigsolver_phi.compute(Spectra::SortRule::LargestAlge);
+
+      //if explanatory power reached (or no more pairs can be computed): return
+      const KO_Traits::StoringVector eigvals = eigsolver_phi.eigenvalues();
+      const int n_ppcs = ppcs_reaching_threshold(eigvals,m_tot_exp_pow,m_threshold_ppc);
+      if(eigvals.head(n_ppcs).sum()/m_tot_exp_pow >= m_threshold_ppc || nev >= max_ppcs)
+      {
+        return std::make_tuple(n_ppcs,eigvals.head(n_ppcs),eigsolver_phi.eigenvectors().leftCols(n_ppcs));
+      }
     }
+  } 
+  else              // number of PPCs already known (imposed by the user of by cv process)
+  {
+    //Spectra framework
+    Spectra::SymEigsSolver<OP> eigsolver_phi(op, m_k, 2*m_k);
+    eigsolver_phi.init();
+    eigsolver_phi.compute(Spectra::SortRule::LargestAlge);
+    
+    return std::make_tuple(m_k,eigsolver_phi.eigenvalues(),eigsolver_phi.eigenvectors());
   }
 }
 
@@ -126,6 +297,9 @@ template< class D, SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_S
 void
 PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::KO_algo()
 { 
+  //eigensolve: threads to the loops or to the products, according to the threading policy
+  threading_phase phase(KO_PHASE::EIGENSOLVE,m_number_threads);
+  
   //finding the PPCs
   auto ppcs_ret = this->PPC_retained();
     
@@ -135,13 +309,13 @@ PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::KO_algo()
     m_k = std::get<0>(ppcs_ret);
   }
   
-  //cumulative explanatory power: if ex_solver, is coherent. If gep_solver, is only the relative magnitude of the retained eigenvalues
+  //cumulative explanatory power: if ex_solver or k not imposed, is coherent. If gep_solver with k imposed, is only the relative magnitude of the retained eigenvalues
   m_explanatory_power.resize(m_k);
   std::partial_sum(std::get<1>(ppcs_ret).begin(),std::get<1>(ppcs_ret).end(),m_explanatory_power.begin());        
   std::for_each(m_explanatory_power.begin(),m_explanatory_power.end(),[this](auto &el){el=el/m_tot_exp_pow;});
   
-  //Weights (b_i): if gep, their for free. If not, cross-covariance has to be applie
-  if constexpr(solver == SOLVER::ex_solver){m_b = m_CovRegRoot*std::get<2>(ppcs_ret);}  else{m_b = std::get<2>(ppcs_ret);}
+  //Weights (b_i): if gep, their for free. If not, whitening has to be undone through a triangular solve: b = L^(-T)*v
+  if constexpr(solver == SOLVER::ex_solver){m_b = m_CovRegChol.matrixU().solve(std::get<2>(ppcs_ret));}  else{m_b = std::get<2>(ppcs_ret);}
   
   //Directions (a_i)
   m_a = m_CrossCov*m_b;
@@ -167,6 +341,33 @@ const
 }
 
 
+/*!
+* @brief Performs h-step ahead prediction of the fts, for all the horizons h = 1,...,h_max. The mean function is added
+* @param h_max maximum forecasting horizon
+* @return a matrix whose h-th column is the (h+1)-step ahead prediction
+* @details rho^h = a*(b'a)^(h-1)*b': the scores b'x_n are propagated through the k x k matrix b'a, and only then mapped back through the directions
+*/
+template< class D, SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+KO_Traits::StoringMatrix
+PPC_KO_base<D, solver, k_imp, valid_err_ret, cv_strat, cv_err_eval>::prediction(int h_max)
+const
+{
+  KO_Traits::StoringMatrix forecasts(m_m,h_max);
+  
+  //scores of the last instant onto the weights, and the operator restricted to the PPCs space
+  KO_Traits::StoringVector z = m_b.transpose()*m_X.col(m_n-1);
+  const KO_Traits::StoringMatrix ba = m_b.transpose()*m_a;
+  
+  for(int h = 0; h < h_max; ++h)
+  {
+    forecasts.col(h) = m_a*z + m_means.matrix();
+    z = ba*z;
+  }
+  
+  return forecasts;
+}
+
+
 
 /*!
 * @brief Computes the scores of the PPCs, defined as scalar product between the direction and the fts at the last instant
@@ -24,6 +24,8 @@
 #include "PPC_KO_CV_alpha.hpp"
 #include "PPC_KO_CV_k.hpp"
 #include "PPC_KO_CV_alpha_k.hpp"
+#include "PPC_KO_Panel.hpp"
+#include "PPC_KO_closed_form.hpp"
 
 
 /*!
@@ -0,0 +1,329 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_PPC_SEPARABLE_HPP
+#define KO_PPC_SEPARABLE_HPP
+
+#include <vector>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <numeric>
+#include <string>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+#include "spectra/include/Spectra/SymEigsSolver.h"
+
+#include "traits_ko.hpp"
+
+#include "parallel_backend.hpp"
+#include "explanatory_power.hpp"
+
+
+/*!
+* @file PPC_KO_separable.hpp
+* @brief Class for computing PPCKO on surfaces approximating covariance and cross-covariance with Kronecker products of the two dimensions' factors
+* @author Andrea Enrico Franzoni
+* @details A surface X_t is stored column-wise (d1 x d2, index i1 + i2*d1): if Cov ~ B kron A (A: d1 x d1, B: d2 x d2), Cov*vec(X_t) = vec(A*X_t*B').
+*          The factors are the nearest (Frobenius norm) Kronecker product of the sample operators, found through alternating power iterations on 
+*          their rearrangement, starting from the partial trace. The (m x m) operators are never assembled: memory goes from O(d1^2*d2^2) to O(d1^2+d2^2)
+*/
+
+
+/*!
+* @brief Nearest Kronecker product estimate of the sample (cross-)covariance between the surfaces 'X_lead' and 'X_lag': (1/n)*sum_t vec(L_t)vec(R_t)' ~ B kron A
+* @param X_lead fts leading the product (matrix: m x n, columns are the flattened surfaces L_t)
+* @param X_lag fts lagging the product (matrix: m x n, columns are the flattened surfaces R_t)
+* @param d1 number of evaluations along dimension 1
+* @param d2 number of evaluations along dimension 2
+* @param number_threads number of threads for OMP
+* @return a pair containing the factor along dimension 1 (A, d1 x d1) and the one along dimension 2 (B, d2 x d2, unit Frobenius norm)
+* @details Alternating updates: A = (1/n)*sum_t L_t*B*R_t', B = (1/n)*sum_t L_t'*A*R_t, starting from B = I (partial trace)
+*/
+inline
+std::pair<KO_Traits::StoringMatrix,KO_Traits::StoringMatrix>
+nearest_kronecker(const KO_Traits::StoringMatrix &X_lead, const KO_Traits::StoringMatrix &X_lag, std::size_t d1, std::size_t d2, int number_threads)
+{
+  constexpr int max_iter = 100;
+  constexpr double toll  = 1e-10;
+  
+  const std::size_t n = X_lead.cols();
+  
+  //surfaces side by side (d1 x (d2*n)): no copy, column-major storage
+  Eigen::Map<const KO_Traits::StoringMatrix> L(X_lead.data(),d1,d2*n);
+  Eigen::Map<const KO_Traits::StoringMatrix> R(X_lag.data(),d1,d2*n);
+  KO_Traits::StoringMatrix tmp(d1,d2*n);
+  
+  KO_Traits::StoringMatrix B = KO_Traits::StoringMatrix::Identity(d2,d2)/std::sqrt(static_cast<double>(d2));
+  KO_Traits::StoringMatrix A(d1,d1);
+  
+  for(int iter = 0; iter < max_iter; ++iter)
+  {
+    //A = (1/n)*sum_t L_t*B*R_t'
+    KO_Parallel::parallel_for(n,number_threads,[&tmp,&R,&B,d2](std::size_t t){ tmp.middleCols(t*d2,d2).noalias() = R.middleCols(t*d2,d2)*B.transpose();});
+    A.noalias() = L*tmp.transpose();
+    A /= static_cast<double>(n);
+    
+    //B = (1/n)*sum_t L_t'*(A/|A|)*R_t
+    tmp.noalias() = (A/A.norm())*R;
+    KO_Traits::StoringMatrix B_new = KO_Traits::StoringMatrix::Zero(d2,d2);
+    for(std::size_t t = 0; t < n; ++t)
+    {
+      B_new.noalias() += L.middleCols(t*d2,d2).transpose()*tmp.middleCols(t*d2,d2);
+    }
+    B_new /= B_new.norm();
+    
+    const double diff = (B_new - B).norm();
+    B = std::move(B_new);
+    if(diff < toll){  break;}
+  }
+  
+  //final factor along dimension 1, coherent with the last B
+  KO_Parallel::parallel_for(n,number_threads,[&tmp,&R,&B,d2](std::size_t t){ tmp.middleCols(t*d2,d2).noalias() = R.middleCols(t*d2,d2)*B.transpose();});
+  A.noalias() = L*tmp.transpose();
+  A /= static_cast<double>(n);
+  
+  return std::make_pair(A,B);
+}
+
+
+
+/*!
+* @class PPC_KO_separable
+* @brief Class for computing PPCKO on surfaces, without cross-validation, with separable covariance and cross-covariance estimates
+* @tparam k_imp if k is imposed or has to be found through explanatory power criterion
+* @details Only the exact solver is available: PPCs are the eigenvectors of phi = Cov_reg^(-1/2)*CrossCov'*CrossCov*Cov_reg^(-1/2), 
+*          applied matrix-free exploiting Kronecker algebra
+*/
+template< K_IMP k_imp >
+class PPC_KO_separable
+{
+private:
+  
+  /*!Number of evaluations along dimension 1*/
+  std::size_t m_d1;
+  /*!Number of evaluations along dimension 2*/
+  std::size_t m_d2;
+  /*!Number of time instants of the fts*/
+  std::size_t m_n;
+  /*!Fts: data will be centered as soon as object construction (matrix: (d1*d2) x n)*/
+  KO_Traits::StoringMatrix m_X;
+  /*!Fts mean function (array: (d1*d2) x 1)*/
+  KO_Traits::StoringArray m_means;
+  /*!Covariance factor along dimension 1 (matrix: d1 x d1)*/
+  KO_Traits::StoringMatrix m_Cov_x1;
+  /*!Covariance factor along dimension 2 (matrix: d2 x d2)*/
+  KO_Traits::StoringMatrix m_Cov_x2;
+  /*!Cross-covariance factor along dimension 1 (matrix: d1 x d1)*/
+  KO_Traits::StoringMatrix m_CrossCov_x1;
+  /*!Cross-covariance factor along dimension 2 (matrix: d2 x d2)*/
+  KO_Traits::StoringMatrix m_CrossCov_x2;
+  /*!Trace of the covariance operator estimate*/
+  double m_trace_cov;
+  /*!Predictive loading (PPCs directions) (matrix: (d1*d2) x k)*/
+  KO_Traits::StoringMatrix m_a;
+  /*!Predictive factors (PPCs weights) (matrix: (d1*d2) x k)*/
+  KO_Traits::StoringMatrix m_b;
+  /*!Cumulative explanatory power of PPCs (vector of size k)*/
+  std::vector<double> m_explanatory_power;
+  /*!Regularization parameter*/
+  double m_alpha;
+  /*!Number of retained PPCs*/
+  int m_k;
+  /*!Requested explanatory power from the retained PPCs*/
+  double m_threshold_ppc;
+  /*!Number of threads for OMP*/
+  int m_number_threads;
+  
+  
+  /*!
+  * @class phi_op
+  * @brief Matrix-free phi = Cov_reg^(-1/2)*(CrossCov_x2'CrossCov_x2 kron CrossCov_x1'CrossCov_x1)*Cov_reg^(-1/2), as 'Spectra' operator
+  */
+  class phi_op
+  {
+  private:
+    std::size_t m_d1;
+    std::size_t m_d2;
+    const KO_Traits::StoringMatrix &m_U1;      //eigenvectors of the covariance factors
+    const KO_Traits::StoringMatrix &m_U2;
+    const KO_Traits::StoringMatrix &m_S;       //inverse square root of the regularized covariance eigenvalues (d1 x d2)
+    const KO_Traits::StoringMatrix &m_G1;      //square of the cross-covariance factors
+    const KO_Traits::StoringMatrix &m_G2;
+    
+  public:
+    using Scalar = double;
+    
+    phi_op(std::size_t d1, std::size_t d2, const KO_Traits::StoringMatrix &U1, const KO_Traits::StoringMatrix &U2, const KO_Traits::StoringMatrix &S, const KO_Traits::StoringMatrix &G1, const KO_Traits::StoringMatrix &G2)
+      : m_d1(d1), m_d2(d2), m_U1(U1), m_U2(U2), m_S(S), m_G1(G1), m_G2(G2) {}
+    
+    Eigen::Index rows() const { return m_d1*m_d2;}
+    Eigen::Index cols() const { return m_d1*m_d2;}
+    
+    //Cov_reg^(-1/2)*vec(V)
+    KO_Traits::StoringMatrix cov_reg_inv_sqrt(const KO_Traits::StoringMatrix &V) const
+    {
+      KO_Traits::StoringMatrix Y = (m_U1.transpose()*V*m_U2).cwiseProduct(m_S);
+      return m_U1*Y*m_U2.transpose();
+    }
+    
+    void perform_op(const Scalar* x_in, Scalar* y_out) const
+    {
+      Eigen::Map<const KO_Traits::StoringMatrix> V(x_in,m_d1,m_d2);
+      Eigen::Map<KO_Traits::StoringMatrix> Y(y_out,m_d1,m_d2);
+      Y = this->cov_reg_inv_sqrt(m_G1*this->cov_reg_inv_sqrt(V)*m_G2);
+    }
+  };
+  
+  
+public:
+  
+  /*!
+  * @brief Constructor: centers data, evaluate mean function and the separable estimates of covariance and cross-covariance
+  * @param X fts ((d1*d2) x n, surfaces flattened column-wise)
+  * @param d1 number of evaluations along dimension 1
+  * @param d2 number of evaluations along dimension 2
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_separable(STOR_OBJ&& X, std::size_t d1, std::size_t d2, int number_threads)
+    : m_d1(d1), m_d2(d2), m_X{std::forward<STOR_OBJ>(X)}, m_number_threads(number_threads)
+    {
+      if(m_X.rows() != m_d1*m_d2 || m_X.hasNaN())
+      {
+        std::string error_message = "Separable estimator needs the evaluations of the surfaces over the entire grid";
+        throw std::invalid_argument(error_message);
+      }
+      
+      m_n = m_X.cols();
+      
+      //evaluating row mean and saving it in the m_means
+      m_means = (m_X.rowwise().sum())/m_n;
+      
+      //centering
+      KO_Parallel::parallel_for(m_n,m_number_threads,[this](std::size_t i){ m_X.col(i) = m_X.col(i).array() - m_means;});
+      
+      //covariance estimate: Cov_x2 kron Cov_x1
+      std::tie(m_Cov_x1,m_Cov_x2) = nearest_kronecker(m_X,m_X,m_d1,m_d2,m_number_threads);
+      m_trace_cov = m_Cov_x1.trace()*m_Cov_x2.trace();
+      
+      //cross-covariance estimate: CrossCov_x2 kron CrossCov_x1
+      KO_Traits::StoringMatrix X_lead = m_X.rightCols(m_n-1);
+      KO_Traits::StoringMatrix X_lag  = m_X.leftCols(m_n-1);
+      std::tie(m_CrossCov_x1,m_CrossCov_x2) = nearest_kronecker(X_lead,X_lag,m_d1,m_d2,m_number_threads);
+    }
+  
+  /*!
+  * @brief Setter for the regularization parameter
+  * @return the private m_alpha (non-const)
+  */
+  inline double & alpha() {return m_alpha;};
+  
+  /*!
+  * @brief Getter for the regularization parameter
+  * @return the private m_alpha
+  */
+  inline double alpha() const {return m_alpha;};
+  
+  /*!
+  * @brief Setter for the number of retained PPCs
+  * @return the private m_k (non-const)
+  */
+  inline int & k() {return m_k;};
+  
+  /*!
+  * @brief Getter for the number of retained PPCs
+  * @return the private m_k
+  */
+  inline int k() const {return m_k;};
+  
+  /*!
+  * @brief Setter for the requested explanatory power
+  * @return the private m_threshold_ppc (non-const)
+  */
+  inline double & threshold_ppc() {return m_threshold_ppc;};
+  
+  /*!
+  * @brief Getter for the mean function
+  * @return the private m_means
+  */
+  inline const KO_Traits::StoringArray & means() const {return m_means;};
+  
+  /*!
+  * @brief Getter for the PPCs directions
+  * @return the private m_a
+  */
+  inline const KO_Traits::StoringMatrix & a() const {return m_a;};
+  
+  /*!
+  * @brief Getter for the PPCs weights
+  * @return the private m_b
+  */
+  inline const KO_Traits::StoringMatrix & b() const {return m_b;};
+  
+  /*!
+  * @brief Getter for the cumulative explanatory power of the PPCs
+  * @return the private m_explanatory_power
+  */
+  inline const std::vector<double> & explanatory_power() const {return m_explanatory_power;};
+  
+  /*!
+  * @brief Computing the PPCs, directions and weights, their number and explanatory power
+  * @details Eigenpairs of phi found through 'Spectra' with a matrix-free operator. Total explanatory power is the trace of phi, 
+  *          computed through the eigendecompositions of the covariance factors
+  */
+  void solve();
+  
+  /*!
+  * @brief Performs one-step ahead prediction of the fts. The mean function is added
+  * @return the array of the prediction
+  */
+  KO_Traits::StoringArray prediction() const;
+  
+  /*!
+  * @brief Performs h-step ahead prediction of the fts, for all the horizons h = 1,...,h_max. The mean function is added
+  * @param h_max maximum forecasting horizon
+  * @return a matrix whose h-th column is the (h+1)-step ahead prediction
+  * @details rho^h = a*(b'a)^(h-1)*b': the forecast is propagated in the space of the k PPCs, O(m*k + h_max*k^2)
+  */
+  KO_Traits::StoringMatrix prediction(int h_max) const;
+  
+  /*!
+  * @brief Computes the scores of the PPCs, defined as scalar product between the direction and the fts at the last instant
+  * @return a vector containing the score of each PPC
+  */
+  std::vector<double> scores() const;
+  
+  /*!
+  * @brief Computes the standard deviation of the scores of directions (instants 2:n) and weights (instants 1:n-1)
+  * @return a vector (of size equal to the number of PPCs) containing arrays with two elements (standard deviation of direction and weight score of the PPC)
+  */
+  std::vector<std::array<double,2>> sd_scores_dir_wei() const;
+};
+
+
+#include "PPC_KO_separable_imp.hpp"
+
+#endif  //KO_PPC_SEPARABLE_HPP
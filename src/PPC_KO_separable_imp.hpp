@@ -0,0 +1,198 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#include "PPC_KO_separable.hpp"
+
+#include <algorithm>
+
+
+/*!
+* @file PPC_KO_separable_imp.hpp
+* @brief Definition of methods of the class for computing PPCKO with separable covariance and cross-covariance estimates
+* @author Andrea Enrico Franzoni
+*/
+
+
+
+/*!
+* @brief Computing the PPCs, directions and weights, their number and explanatory power
+* @details Eigenpairs of phi found through 'Spectra' with a matrix-free operator. Total explanatory power is the trace of phi, 
+*          computed through the eigendecompositions of the covariance factors
+*/
+template< K_IMP k_imp >
+void
+PPC_KO_separable<k_imp>::solve()
+{
+  //eigendecompositions of the covariance factors: Cov_reg = (U2 kron U1)(L2 kron L1 + alpha*trace(Cov)*I)(U2 kron U1)'
+  Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> eigensolver_x1(m_Cov_x1);
+  Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> eigensolver_x2(m_Cov_x2);
+  const KO_Traits::StoringMatrix &U1 = eigensolver_x1.eigenvectors();
+  const KO_Traits::StoringMatrix &U2 = eigensolver_x2.eigenvectors();
+  
+  //inverse square root of the regularized covariance eigenvalues (d1 x d2)
+  KO_Traits::StoringMatrix S = ((eigensolver_x1.eigenvalues()*eigensolver_x2.eigenvalues().transpose()).array() + m_alpha*m_trace_cov).max(std::numeric_limits<double>::min()).rsqrt().matrix();
+  
+  //square of the cross-covariance: CrossCov_x2'CrossCov_x2 kron CrossCov_x1'CrossCov_x1
+  KO_Traits::StoringMatrix G1 = m_CrossCov_x1.transpose()*m_CrossCov_x1;
+  KO_Traits::StoringMatrix G2 = m_CrossCov_x2.transpose()*m_CrossCov_x2;
+  
+  //sum of phi eigenvalues: its trace, sum_(i1,i2) S(i1,i2)^2 * (U1'G1U1)(i1,i1) * (U2'G2U2)(i2,i2)
+  KO_Traits::StoringVector g1 = (U1.transpose()*G1*U1).diagonal();
+  KO_Traits::StoringVector g2 = (U2.transpose()*G2*U2).diagonal();
+  const double tot_exp_pow = (S.array().square()*(g1*g2.transpose()).array()).sum();
+  
+  phi_op op(m_d1,m_d2,U1,U2,S,G1,G2);
+  const int m = m_d1*m_d2;
+  
+  KO_Traits::StoringVector eigvals;
+  KO_Traits::StoringMatrix eigvecs;
+  
+  if constexpr( k_imp == K_IMP::NO )    //number of PPCs to be selected through explanatory power
+  {
+    //compute nev pairs, doubling nev until the requested explanatory power is reached: then only the pairs needed to reach it are retained
+    for(int nev = 1; ; nev = std::min(2*nev,m-1))
+    {
+      Spectra::SymEigsSolver<phi_op> eigsolver_phi(op, nev, std::min(2*nev+1,m));
+      eigsolver_phi.init();
+      eigsolver_phi.compute(Spectra::SortRule::LargestAlge);
+      eigvals = eigsolver_phi.eigenvalues();
+      
+      //if explanatory power reached (or no more pairs can be computed): stop
+      const int n_ppcs = ppcs_reaching_threshold(eigvals,tot_exp_pow,m_threshold_ppc);
+      if(eigvals.head(n_ppcs).sum()/tot_exp_pow >= m_threshold_ppc || nev >= m-1)
+      {
+        eigvals.conservativeResize(n_ppcs);
+        eigvecs = eigsolver_phi.eigenvectors().leftCols(n_ppcs);
+        break;
+      }
+    }
+    m_k = eigvals.size();
+  } 
+  else              // number of PPCs already known
+  {
+    Spectra::SymEigsSolver<phi_op> eigsolver_phi(op, m_k, std::min(2*m_k+1,m));
+    eigsolver_phi.init();
+    eigsolver_phi.compute(Spectra::SortRule::LargestAlge);
+    eigvals = eigsolver_phi.eigenvalues();
+    eigvecs = eigsolver_phi.eigenvectors();
+  }
+  
+  //cumulative explanatory power
+  m_explanatory_power.resize(m_k);
+  std::partial_sum(eigvals.begin(),eigvals.end(),m_explanatory_power.begin());
+  std::for_each(m_explanatory_power.begin(),m_explanatory_power.end(),[tot_exp_pow](auto &el){el=el/tot_exp_pow;});
+  
+  //weights (b_i = Cov_reg^(-1/2)v_i) and directions (a_i = CrossCov*b_i)
+  m_a.resize(m,m_k);
+  m_b.resize(m,m_k);
+  for(int i = 0; i < m_k; ++i)
+  {
+    Eigen::Map<const KO_Traits::StoringMatrix> V(eigvecs.col(i).data(),m_d1,m_d2);
+    KO_Traits::StoringMatrix B = op.cov_reg_inv_sqrt(V);
+    m_b.col(i) = B.reshaped();
+    m_a.col(i) = (m_CrossCov_x1*B*m_CrossCov_x2.transpose()).reshaped();
+  }
+}
+
+
+
+/*!
+* @brief Performs one-step ahead prediction of the fts. The mean function is added
+* @return the array of the prediction
+* @details The autoregressive operator is never assembled: prediction = sum_i a_i*(b_i'x_n)
+*/
+template< K_IMP k_imp >
+KO_Traits::StoringArray
+PPC_KO_separable<k_imp>::prediction()
+const 
+{
+  return (m_a*(m_b.transpose()*m_X.col(m_n-1))).array() + m_means;
+}
+
+
+/*!
+* @brief Performs h-step ahead prediction of the fts, for all the horizons h = 1,...,h_max. The mean function is added
+* @param h_max maximum forecasting horizon
+* @return a matrix whose h-th column is the (h+1)-step ahead prediction
+* @details rho^h = a*(b'a)^(h-1)*b': the scores b'x_n are propagated through the k x k matrix b'a, and only then mapped back through the directions
+*/
+template< K_IMP k_imp >
+KO_Traits::StoringMatrix
+PPC_KO_separable<k_imp>::prediction(int h_max)
+const
+{
+  KO_Traits::StoringMatrix forecasts(m_X.rows(),h_max);
+  
+  //scores of the last instant onto the weights, and the operator restricted to the PPCs space
+  KO_Traits::StoringVector z = m_b.transpose()*m_X.col(m_n-1);
+  const KO_Traits::StoringMatrix ba = m_b.transpose()*m_a;
+  
+  for(int h = 0; h < h_max; ++h)
+  {
+    forecasts.col(h) = m_a*z + m_means.matrix();
+    z = ba*z;
+  }
+  
+  return forecasts;
+}
+
+
+
+/*!
+* @brief Computes the scores of the PPCs, defined as scalar product between the direction and the fts at the last instant
+* @return a vector containing the score of each PPC
+*/
+template< K_IMP k_imp >
+std::vector<double>
+PPC_KO_separable<k_imp>::scores()
+const
+{ 
+  KO_Traits::StoringVector scores = m_a.transpose()*m_X.col(m_n-1);
+  
+  return std::vector<double>(scores.begin(),scores.end());
+}
+
+
+
+/*!
+* @brief Computes the standard deviation of the scores of directions (instants 2:n) and weights (instants 1:n-1)
+* @return a vector (of size equal to the number of PPCs) containing arrays with two elements (standard deviation of direction and weight score of the PPC)
+*/
+template< K_IMP k_imp >
+std::vector<std::array<double,2>>
+PPC_KO_separable<k_imp>::sd_scores_dir_wei()
+const
+{
+  //scores of directions (next value) and weights (current value): (n-1) x k
+  KO_Traits::StoringMatrix scores_dir = m_X.rightCols(m_n-1).transpose()*m_a;
+  KO_Traits::StoringMatrix scores_wei = m_X.leftCols(m_n-1).transpose()*m_b;
+  
+  std::vector<std::array<double,2>> standard_dev;
+  standard_dev.reserve(m_k);
+  
+  for(int comp = 0; comp < m_k; ++comp)
+  {
+    const double sd_dir = std::sqrt((scores_dir.col(comp).array() - scores_dir.col(comp).mean()).square().mean());
+    const double sd_wei = std::sqrt((scores_wei.col(comp).array() - scores_wei.col(comp).mean()).square().mean());
+    standard_dev.emplace_back(std::array<double, 2>{sd_dir,sd_wei});
+  }
+  
+  return standard_dev;
+}
@@ -21,12 +21,17 @@
 #define PPC_KO_WRAPPER_HPP
 
 #include <vector>
+#include <string>
 #include <tuple>
+#include <algorithm>
+#include <stdexcept>
 #include "utility"
 
 
 #include "traits_ko.hpp"
 #include "PPC_KO_include.hpp"
+#include "PPC_KO_separable.hpp"
+#include "cv_budget.hpp"
 
 
 /*!
@@ -40,7 +45,7 @@
 /*!
 * @class PPC_KO_wrapper
 * @brief Base virtual class for wrapping class that performs PPCKO computations. Which child class is constructed is selected run-time through virtual polymorphism
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -58,6 +63,16 @@ private:
   results_t<valid_err_ret> m_results;   
   /*!Number of threads for OMP*/
   int m_number_threads;                
+  /*!Maximum forecasting horizon*/
+  int m_h_max = 1;
+  /*!Regularization parameters validated by a continuous cv on it (empty otherwise)*/
+  std::vector<double> m_alphas_validated;
+  /*!Time budget of the cv (no deadline by default)*/
+  cv_budget m_budget;
+  /*!File of the cache of the validation errors (empty: no cache)*/
+  std::string m_cache_file;
+  /*!Number of local worker processes across which the cv is sharded (1: no sharding)*/
+  int m_number_processes = 1;
   
 
 public:
@@ -100,11 +115,71 @@ public:
   */
   inline int number_threads() const {return m_number_threads;};
   
+  /*!
+  * @brief Getter for the maximum forecasting horizon
+  * @return the private m_h_max
+  */
+  inline int h_max() const {return m_h_max;};
+  
+  /*!
+  * @brief Getter for the regularization parameters validated by a continuous cv
+  * @return the private m_alphas_validated
+  */
+  inline std::vector<double> alphas_validated() const {return m_alphas_validated;};
+  
+  /*!
+  * @brief Getter for the time budget of the cv
+  * @return the private m_budget
+  */
+  inline cv_budget budget() const {return m_budget;};
+  
+  /*!
+  * @brief Getter for the file of the cache of the validation errors
+  * @return the private m_cache_file
+  */
+  inline std::string cache_file() const {return m_cache_file;};
+  
+  /*!
+  * @brief Getter for the number of local worker processes across which the cv is sharded
+  * @return the private m_number_processes
+  */
+  inline int number_processes() const {return m_number_processes;};
+  
   /*!
   * @brief Setter for the results
   * @return the private m_results (not-const)
   */
   inline results_t<valid_err_ret> & results() {return m_results;};
+  
+  /*!
+  * @brief Setter for the maximum forecasting horizon
+  * @return the private m_h_max (not-const)
+  */
+  inline int & h_max() {return m_h_max;};
+  
+  /*!
+  * @brief Setter for the regularization parameters validated by a continuous cv
+  * @return the private m_alphas_validated (not-const)
+  */
+  inline std::vector<double> & alphas_validated() {return m_alphas_validated;};
+  
+  /*!
+  * @brief Setter for the time budget of the cv
+  * @return the private m_budget (not-const)
+  */
+  inline cv_budget & budget() {return m_budget;};
+  
+  /*!
+  * @brief Setter for the file of the cache of the validation errors
+  * @return the private m_cache_file (not-const)
+  */
+  inline std::string & cache_file() {return m_cache_file;};
+  
+  /*!
+  * @brief Setter for the number of local worker processes across which the cv is sharded
+  * @return the private m_number_processes (not-const)
+  */
+  inline int & number_processes() {return m_number_processes;};
 };
 
 
@@ -112,7 +187,7 @@ public:
 /*!
 * @class PPC_KO_wrapper_no_cv
 * @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations without cross-validation
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -169,7 +244,7 @@ public:
 /*!
 * @class PPC_KO_wrapper_cv_alpha
 * @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations with cross-validation on regularization parameter
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -191,6 +266,8 @@ private:
   int m_min_size_ts;
   /*!Maximum size (number of time instants) of the training set*/ 
   int m_max_size_ts;
+  /*!How the input space for regularization parameter is explored*/
+  ALPHA_SEARCH m_search;
 
 
 public:
@@ -203,11 +280,12 @@ public:
   * @param min_size_ts minimum size (number of time instants) of the training set
   * @param max_size_ts maximum size (number of time instants) of the training set
   * @param number_threads number of threads for OMP
+  * @param search how the input space for regularization parameter is explored
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   */
   template<typename STOR_OBJ>
-  PPC_KO_wrapper_cv_alpha(STOR_OBJ&& data, const std::vector<double> & alphas, int k, int min_size_ts, int max_size_ts, int number_threads)
-    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_alphas(alphas), m_k(k), m_min_size_ts(min_size_ts), m_max_size_ts(max_size_ts) {}
+  PPC_KO_wrapper_cv_alpha(STOR_OBJ&& data, const std::vector<double> & alphas, int k, int min_size_ts, int max_size_ts, int number_threads, ALPHA_SEARCH search = ALPHA_SEARCH::GRID_SEARCH)
+    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_alphas(alphas), m_k(k), m_min_size_ts(min_size_ts), m_max_size_ts(max_size_ts), m_search(search) {}
   
   /*!
   * @brief Constructor if k is retained through explanatory power criterion (k_imp = K_IMP::NO)
@@ -217,11 +295,12 @@ public:
   * @param min_size_ts minimum size (number of time instants) of the training set
   * @param max_size_ts maximum size (number of time instants) of the training set
   * @param number_threads number of threads for OMP
+  * @param search how the input space for regularization parameter is explored
   * @details Universal constructor: move semantic used to optimazing handling big size objects
   */
   template<typename STOR_OBJ>
-  PPC_KO_wrapper_cv_alpha(STOR_OBJ&& data, const std::vector<double> & alphas, double threshold_ppc, int min_size_ts, int max_size_ts, int number_threads)
-    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_alphas(alphas), m_threshold_ppc(threshold_ppc), m_min_size_ts(min_size_ts), m_max_size_ts(max_size_ts) {}
+  PPC_KO_wrapper_cv_alpha(STOR_OBJ&& data, const std::vector<double> & alphas, double threshold_ppc, int min_size_ts, int max_size_ts, int number_threads, ALPHA_SEARCH search = ALPHA_SEARCH::GRID_SEARCH)
+    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_alphas(alphas), m_threshold_ppc(threshold_ppc), m_min_size_ts(min_size_ts), m_max_size_ts(max_size_ts), m_search(search) {}
   
   /*!
   * @brief Override for calling the regularization parameter cross-validation PPCKO version at runtime
@@ -234,7 +313,7 @@ public:
 /*!
 * @class PPC_KO_wrapper_cv_k
 * @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations with cross-validation on the number of retained PPCs
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -289,7 +368,7 @@ public:
 /*!
 * @class PPC_KO_wrapper_cv_alpha_k
 * @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations with cross-validation on both the regularization parameter and the number of retained PPCs
-* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (not possible if retaining the number of PPCs with explanatory power criterion)
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
 * @tparam k_imp if k is imposed or has to be found through explanatory power criterion
 * @tparam valid_err_ret if validation error are stored
 * @tparam cv_strat strategy for splitting training/validation sets
@@ -340,6 +419,188 @@ public:
 };
 
 
+
+/*!
+* @class PPC_KO_wrapper_closed_form
+* @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations selecting the parameters in closed form
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
+* @tparam k_imp if k is imposed or has to be found through explanatory power criterion
+* @tparam valid_err_ret if validation error are stored
+* @tparam cv_strat strategy for splitting training/validation sets
+* @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
+* @details It is a derived class. Polymorphism is known at run-time through virtual polymorphism
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval > 
+class PPC_KO_wrapper_closed_form  : public PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>
+{
+private:
+  
+  /*!Regularization parameter input space*/
+  std::vector<double> m_alphas;
+  /*!Number of retained PPCs input space*/
+  std::vector<int> m_k_s;
+  /*!Regularization parameter*/
+  double m_alpha;
+  /*!Number of retained PPCs*/
+  int m_k;
+  /*!Requested explanatory power from the PPCs*/
+  double m_threshold_ppc;
+  /*!Which parameters are selected*/
+  CF_SELECTION m_selection;
+  
+  /*!
+  * @brief Performing the computations and updating the results
+  * @tparam k_imp_fit if k is imposed or has to be found through explanatory power criterion, for the class for computations
+  */
+  template< K_IMP k_imp_fit >
+  void fit();
+  
+  
+public:
+  
+  /*!
+  * @brief Constructor
+  * @param data matrix storing fts
+  * @param alphas regularization parameter input space
+  * @param k_s number of retained PPCs input space
+  * @param alpha regularization parameter (used if it is not selected)
+  * @param k number of retained PPCs (used if it is not selected and k_imp = K_IMP::YES)
+  * @param threshold_ppc requested explanatory power from the PPCs (used if k is not selected and k_imp = K_IMP::NO)
+  * @param selection which parameters are selected
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_wrapper_closed_form(STOR_OBJ&& data, const std::vector<double> & alphas, const std::vector<int> & k_s, double alpha, int k, double threshold_ppc, CF_SELECTION selection, int number_threads)
+    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_alphas(alphas), m_k_s(k_s), m_alpha(alpha), m_k(k), m_threshold_ppc(threshold_ppc), m_selection(selection) {}
+  
+  /*!
+  * @brief Override for calling the closed-form selection PPCKO version at runtime
+  */
+  void call_ko() override;
+};
+
+
+
+
+/*!
+* @class PPC_KO_wrapper_separable
+* @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations on surfaces, without cross-validation, with separable covariance and cross-covariance
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep (only 'SOLVER::ex_solver' is available)
+* @tparam k_imp if k is imposed or has to be found through explanatory power criterion
+* @tparam valid_err_ret if validation error are stored
+* @tparam cv_strat strategy for splitting training/validation sets
+* @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
+* @details It is a derived class. Polymorphism is known at run-time through virtual polymorphism
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval > 
+class PPC_KO_wrapper_separable  : public PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>
+{
+private:
+
+  /*!Number of evaluations along dimension 1*/
+  std::size_t m_d1;
+  /*!Number of evaluations along dimension 2*/
+  std::size_t m_d2;
+  /*!Regularization parameter*/
+  double m_alpha;
+  /*!Number of retained PPCs*/                     
+  int m_k;                              
+  /*!Requested explanatory power from the PPCs*/
+  double m_threshold_ppc;               
+
+
+public:
+
+  /*!
+  * @brief Constructor
+  * @param data matrix storing fts
+  * @param d1 number of evaluations along dimension 1
+  * @param d2 number of evaluations along dimension 2
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs (used if k_imp = K_IMP::YES)
+  * @param threshold_ppc requested explanatory power from the PPCs (used if k_imp = K_IMP::NO)
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_wrapper_separable(STOR_OBJ&& data, std::size_t d1, std::size_t d2, double alpha, int k, double threshold_ppc, int number_threads)
+    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_d1(d1), m_d2(d2), m_alpha(alpha), m_k(k), m_threshold_ppc(threshold_ppc) {}
+  
+  /*!
+  * @brief Override for calling the separable PPCKO version at runtime
+  */
+  void call_ko() override;
+};
+
+
+
+
+/*!
+* @class PPC_KO_wrapper_panel
+* @brief Derived-from-PPC_KO_wrapper class for wrapping class that performs PPCKO computations over a panel of fts sharing the dynamics, without cross-validation
+* @tparam solver if algorithm solved inverting the regularized covariance or avoiding it through gep
+* @tparam k_imp if k is imposed or has to be found through explanatory power criterion
+* @tparam valid_err_ret if validation error are stored
+* @tparam cv_strat strategy for splitting training/validation sets
+* @tparam err_eval how to evaluate the loss between prediction on validation set and validation set
+* @details It is a derived class. Polymorphism is known at run-time through virtual polymorphism. 
+*          The prediction in the results stores, one after the other, the predictions of each fts for all the horizons; the mean function is the one of the panel
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval > 
+class PPC_KO_wrapper_panel  : public PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>
+{
+private:
+
+  /*!Number of time instants of each fts of the panel*/
+  std::vector<std::size_t> m_panel_sizes;
+  /*!Regularization parameter*/
+  double m_alpha;
+  /*!Number of retained PPCs*/                     
+  int m_k;                              
+  /*!Requested explanatory power from the PPCs*/
+  double m_threshold_ppc;               
+  /*!Mean function of each fts of the panel*/
+  KO_Traits::StoringMatrix m_panel_means;
+
+
+public:
+
+  /*!
+  * @brief Constructor
+  * @param data matrix storing the fts of the panel, stacked one after the other along the columns
+  * @param panel_sizes number of time instants of each fts of the panel
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs (used if k_imp = K_IMP::YES)
+  * @param threshold_ppc requested explanatory power from the PPCs (used if k_imp = K_IMP::NO)
+  * @param number_threads number of threads for OMP
+  * @details Universal constructor: move semantic used to optimazing handling big size objects. It raises an error if a fts has less than 2 time 
+  *          instants: it would contribute no lag pair, and a panel made only of such fts would have a non-positive divisor for its cross-covariance
+  */
+  template<typename STOR_OBJ>
+  PPC_KO_wrapper_panel(STOR_OBJ&& data, const std::vector<std::size_t> &panel_sizes, double alpha, int k, double threshold_ppc, int number_threads)
+    : PPC_KO_wrapper<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>(std::move(data),number_threads), m_panel_sizes(panel_sizes), m_alpha(alpha), m_k(k), m_threshold_ppc(threshold_ppc) 
+    {
+      if(m_panel_sizes.empty() || std::any_of(m_panel_sizes.cbegin(),m_panel_sizes.cend(),[](std::size_t n_s){return n_s < 2;}))
+      {
+        std::string error_message = "The panel has to contain at least one fts, and each fts at least 2 time instants";
+        throw std::invalid_argument(error_message);
+      }
+    }
+  
+  /*!
+  * @brief Getter for the mean function of each fts of the panel
+  * @return the private m_panel_means
+  */
+  inline const KO_Traits::StoringMatrix & panel_means() const {return m_panel_means;};
+  
+  /*!
+  * @brief Override for calling the panel PPCKO version at runtime
+  */
+  void call_ko() override;
+};
+
+
 #include "PPC_KO_wrapper_imp.hpp"
 
 #endif  //PPC_KO_WRAPPER_HPP
\ No newline at end of file
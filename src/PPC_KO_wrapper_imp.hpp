@@ -19,9 +19,11 @@
 
 
 #include "PPC_KO_wrapper.hpp"
+#include "ko_log.hpp"
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 /*!
 * @file PPC_KO_wrapper_imp.hpp
@@ -30,6 +32,23 @@
 */
 
 
+/*!
+* @brief Printing the total explanatory power and its standard deviation, if it has been estimated stochastically
+* @tparam KO_T type of the class for computations
+* @param KO class for computations, already solved
+*/
+template<typename KO_T>
+void
+print_tot_exp_pow_estimate(const KO_T &KO)
+{
+  if(KO.tot_exp_pow_var() > 0)
+  {
+    KO_Log::message("Total explanatory power estimated through Hutch++: ",KO.tot_exp_pow()," (sd: ",std::sqrt(KO.tot_exp_pow_var()),")");
+  }
+}
+
+
+
 /*!
 * @brief No cross-validation overriding: wraps the class for computations (static polymorphism) accordingly
 * @details Wraps the class for computations, performs them and then update the results in the wrapper class
@@ -45,14 +64,15 @@ PPC_KO_wrapper_no_cv<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
     PPC_KO_NoCV<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alpha,m_k,this->number_threads());
     //solving
     KO.solve(); 
+    print_tot_exp_pow_estimate(KO);
     //computing scores
     auto scores = KO.scores();
     //computing sd of scores of directions and weights
     auto sd_scores = KO.sd_scores_dir_wei();
 
     //if validation errors have to be stored and returned
-    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),KO.ValidErr());}
-    else  {this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),KO.ValidErr());}
+    else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
   }
 
   if constexpr(k_imp == K_IMP::NO)    //k to be found with explanatory power criterion
@@ -61,14 +81,15 @@ PPC_KO_wrapper_no_cv<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
     PPC_KO_NoCV<solver,K_IMP::NO,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alpha,m_threshold_ppc,this->number_threads());
     //solving
     KO.solve();
+    print_tot_exp_pow_estimate(KO);
     //computing scores
     auto scores = KO.scores();
     //computing sd of scores of directions and weights
     auto sd_scores = KO.sd_scores_dir_wei();
     
     //if validation errors have to be stored and returned
-    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),KO.ValidErr());}
-    else  {this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),KO.ValidErr());}
+    else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
   }
 }
   
@@ -86,33 +107,37 @@ PPC_KO_wrapper_cv_alpha<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_k
   if constexpr(k_imp == K_IMP::YES)   //k imposed
   {
     //class for computations construction
-    PPC_KO_CV_alpha<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_k,m_min_size_ts,m_max_size_ts,this->number_threads());
+    PPC_KO_CV_alpha<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_k,m_min_size_ts,m_max_size_ts,this->number_threads(),m_search,this->budget(),this->number_processes());
     //solving
     KO.solve();
+    if(m_search == ALPHA_SEARCH::BRENT_SEARCH){  this->alphas_validated() = KO.alphas();}
+    print_tot_exp_pow_estimate(KO);
     //computing scores
     auto scores = KO.scores();
     //computing sd of scores of directions and weights
     auto sd_scores = KO.sd_scores_dir_wei();
     
     //if validation errors have to be stored and returned
-    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
-    else  {this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
+    else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
   }
 
   if constexpr(k_imp == K_IMP::NO)    //k to be found with explanatory power criterion
   {
     //class for computations construction
-    PPC_KO_CV_alpha<solver,K_IMP::NO,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_threshold_ppc,m_min_size_ts,m_max_size_ts,this->number_threads());
+    PPC_KO_CV_alpha<solver,K_IMP::NO,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_threshold_ppc,m_min_size_ts,m_max_size_ts,this->number_threads(),m_search,this->budget(),this->number_processes());
     //solving
     KO.solve();
+    if(m_search == ALPHA_SEARCH::BRENT_SEARCH){  this->alphas_validated() = KO.alphas();}
+    print_tot_exp_pow_estimate(KO);
     //computing scores
     auto scores = KO.scores();
     //computing sd of scores of directions and weights
     auto sd_scores = KO.sd_scores_dir_wei();
     
     //if validation errors have to be stored and returned
-    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
-    else  {this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}  
+    if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
+    else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}  
   }
 }
 
@@ -130,14 +155,15 @@ PPC_KO_wrapper_cv_k<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
   PPC_KO_CV_k<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_k_s,m_alpha,m_toll,m_min_size_ts,m_max_size_ts,this->number_threads());
   //solving
   KO.solve();
+  print_tot_exp_pow_estimate(KO);
   //computing scores
   auto scores = KO.scores();
   //computing sd of scores of directions and weights
   auto sd_scores = KO.sd_scores_dir_wei();
   
   //if validation errors have to be stored and returned
-  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
-  else  {this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
+  else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
 }
 
 
@@ -151,15 +177,110 @@ void
 PPC_KO_wrapper_cv_alpha_k<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
 {
   //class for computations construction (k_imp=K_IMP::YES by default)
-  PPC_KO_CV_alpha_k<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_k_s,m_toll,m_min_size_ts,m_max_size_ts,this->number_threads());
+  PPC_KO_CV_alpha_k<solver,K_IMP::YES,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_k_s,m_toll,m_min_size_ts,m_max_size_ts,this->number_threads(),this->budget(),this->cache_file(),this->number_processes());
   //solving
   KO.solve();
+  print_tot_exp_pow_estimate(KO);
   //computing scores
   auto scores = KO.scores();
   //computing sd of scores of directions and weights
   auto sd_scores = KO.sd_scores_dir_wei();
   
   //if validation errors have to be stored and returned
-  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_2_t>(KO.ValidErr()));}
-  else  {this->results() = std::make_tuple(KO.prediction(),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_2_t>(KO.ValidErr()));}
+  else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+}
+
+
+
+/*!
+* @brief Closed-form selection: wraps the class for computations (static polymorphism) accordingly
+* @tparam k_imp_fit if k is imposed or has to be found through explanatory power criterion, for the class for computations
+* @details Wraps the class for computations, performs them and then update the results in the wrapper class
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+template< K_IMP k_imp_fit >
+void
+PPC_KO_wrapper_closed_form<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::fit()
+{
+  //class for computations construction
+  PPC_KO_closed_form<solver,k_imp_fit,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_alphas,m_k_s,m_alpha,m_k,m_threshold_ppc,m_selection,this->number_threads());
+  //solving
+  KO.solve();
+  print_tot_exp_pow_estimate(KO);
+  //computing scores
+  auto scores = KO.scores();
+  //computing sd of scores of directions and weights
+  auto sd_scores = KO.sd_scores_dir_wei();
+  
+  //if validation errors (GCV scores or eigenvalue ratios) have to be stored and returned
+  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),std::get<valid_err_cv_1_t>(KO.ValidErr()));}
+  else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+}
+
+
+/*!
+* @brief Closed-form selection overriding
+* @details If the number of retained PPCs is selected, k is imposed (k_imp=K_IMP::YES) for the class for computations
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+void
+PPC_KO_wrapper_closed_form<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
+{
+  if(m_selection == CF_SELECTION::CF_ALPHA){  this->template fit<k_imp>();}
+  else{  this->template fit<K_IMP::YES>();}
+}
+
+
+
+/*!
+* @brief Separable overriding: wraps the class for computations accordingly
+* @details Wraps the class for computations, performs them and then update the results in the wrapper class. No validation error is available
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+void
+PPC_KO_wrapper_separable<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
+{
+  //class for computations construction
+  PPC_KO_separable<k_imp> KO(std::move(this->data()),m_d1,m_d2,this->number_threads());
+  KO.alpha() = m_alpha;
+  if constexpr(k_imp == K_IMP::YES){  KO.k() = m_k;}  else{  KO.threshold_ppc() = m_threshold_ppc;}
+  //solving
+  KO.solve();
+  //computing scores
+  auto scores = KO.scores();
+  //computing sd of scores of directions and weights
+  auto sd_scores = KO.sd_scores_dir_wei();
+  
+  //if validation errors have to be stored and returned (no cv: empty)
+  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),valid_err_variant{});}
+  else  {this->results() = std::make_tuple(KO.prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
+}
+
+
+
+/*!
+* @brief Panel overriding: wraps the class for computations accordingly
+* @details Wraps the class for computations, performs them and then update the results in the wrapper class. No validation error is available.
+*          Scores and their standard deviations are evaluated on the last fts of the panel and on the whole panel respectively
+*/
+template< SOLVER solver, K_IMP k_imp, VALID_ERR_RET valid_err_ret, CV_STRAT cv_strat, CV_ERR_EVAL cv_err_eval >
+void
+PPC_KO_wrapper_panel<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval>::call_ko()
+{
+  //class for computations construction
+  PPC_KO_Panel<solver,k_imp,valid_err_ret,cv_strat,cv_err_eval> KO(std::move(this->data()),m_panel_sizes,m_alpha,m_k,m_threshold_ppc,this->number_threads());
+  //solving
+  KO.solve();
+  print_tot_exp_pow_estimate(KO);
+  //computing scores
+  auto scores = KO.scores();
+  //computing sd of scores of directions and weights
+  auto sd_scores = KO.sd_scores_dir_wei();
+  //mean function of each fts
+  m_panel_means = KO.panel_means();
+  
+  //if validation errors have to be stored and returned (no cv: empty)
+  if constexpr( valid_err_ret == VALID_ERR_RET::YES_err){this->results() = std::make_tuple(KO.panel_prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means(),valid_err_variant{});}
+  else  {this->results() = std::make_tuple(KO.panel_prediction(this->h_max()),KO.alpha(),KO.k(),scores,KO.explanatory_power(),KO.a(),KO.b(),sd_scores,KO.means());}
 }
\ No newline at end of file
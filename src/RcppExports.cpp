@@ -12,8 +12,8 @@ Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
 // PPC_KO
-Rcpp::List PPC_KO(Rcpp::NumericMatrix X, std::string id_CV, double alpha, int k, double threshold_ppc, Rcpp::Nullable<NumericVector> alpha_vec, Rcpp::Nullable<IntegerVector> k_vec, double toll, Rcpp::Nullable<NumericVector> disc_ev, double left_extreme, double right_extreme, Rcpp::Nullable<int> min_size_ts, Rcpp::Nullable<int> max_size_ts, bool err_ret, bool ex_solver, Rcpp::Nullable<int> num_threads, Rcpp::Nullable<std::string> id_rem_nan);
-RcppExport SEXP _PPCKO_PPC_KO(SEXP XSEXP, SEXP id_CVSEXP, SEXP alphaSEXP, SEXP kSEXP, SEXP threshold_ppcSEXP, SEXP alpha_vecSEXP, SEXP k_vecSEXP, SEXP tollSEXP, SEXP disc_evSEXP, SEXP left_extremeSEXP, SEXP right_extremeSEXP, SEXP min_size_tsSEXP, SEXP max_size_tsSEXP, SEXP err_retSEXP, SEXP ex_solverSEXP, SEXP num_threadsSEXP, SEXP id_rem_nanSEXP) {
+Rcpp::List PPC_KO(Rcpp::NumericMatrix X, std::string id_CV, double alpha, int k, double threshold_ppc, Rcpp::Nullable<NumericVector> alpha_vec, Rcpp::Nullable<IntegerVector> k_vec, double toll, Rcpp::Nullable<NumericVector> disc_ev, double left_extreme, double right_extreme, Rcpp::Nullable<int> min_size_ts, Rcpp::Nullable<int> max_size_ts, bool err_ret, bool ex_solver, Rcpp::Nullable<int> num_threads, Rcpp::Nullable<std::string> id_rem_nan, Rcpp::Nullable<std::string> id_quadrature, Rcpp::Nullable<std::string> id_basis, int num_basis, Rcpp::Nullable<double> threshold_fpca, int coarse_step, int horizon, Rcpp::Nullable<double> time_budget, Rcpp::Nullable<std::string> cv_cache_file, int num_processes, Rcpp::Nullable<std::string> id_threading);
+RcppExport SEXP _PPCKO_PPC_KO(SEXP XSEXP, SEXP id_CVSEXP, SEXP alphaSEXP, SEXP kSEXP, SEXP threshold_ppcSEXP, SEXP alpha_vecSEXP, SEXP k_vecSEXP, SEXP tollSEXP, SEXP disc_evSEXP, SEXP left_extremeSEXP, SEXP right_extremeSEXP, SEXP min_size_tsSEXP, SEXP max_size_tsSEXP, SEXP err_retSEXP, SEXP ex_solverSEXP, SEXP num_threadsSEXP, SEXP id_rem_nanSEXP, SEXP id_quadratureSEXP, SEXP id_basisSEXP, SEXP num_basisSEXP, SEXP threshold_fpcaSEXP, SEXP coarse_stepSEXP, SEXP horizonSEXP, SEXP time_budgetSEXP, SEXP cv_cache_fileSEXP, SEXP num_processesSEXP, SEXP id_threadingSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -34,13 +34,23 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type ex_solver(ex_solverSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<int> >::type num_threads(num_threadsSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_rem_nan(id_rem_nanSEXP);
-    rcpp_result_gen = Rcpp::wrap(PPC_KO(X, id_CV, alpha, k, threshold_ppc, alpha_vec, k_vec, toll, disc_ev, left_extreme, right_extreme, min_size_ts, max_size_ts, err_ret, ex_solver, num_threads, id_rem_nan));
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_quadrature(id_quadratureSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_basis(id_basisSEXP);
+    Rcpp::traits::input_parameter< int >::type num_basis(num_basisSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<double> >::type threshold_fpca(threshold_fpcaSEXP);
+    Rcpp::traits::input_parameter< int >::type coarse_step(coarse_stepSEXP);
+    Rcpp::traits::input_parameter< int >::type horizon(horizonSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<double> >::type time_budget(time_budgetSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type cv_cache_file(cv_cache_fileSEXP);
+    Rcpp::traits::input_parameter< int >::type num_processes(num_processesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_threading(id_threadingSEXP);
+    rcpp_result_gen = Rcpp::wrap(PPC_KO(X, id_CV, alpha, k, threshold_ppc, alpha_vec, k_vec, toll, disc_ev, left_extreme, right_extreme, min_size_ts, max_size_ts, err_ret, ex_solver, num_threads, id_rem_nan, id_quadrature, id_basis, num_basis, threshold_fpca, coarse_step, horizon, time_budget, cv_cache_file, num_processes, id_threading));
     return rcpp_result_gen;
 END_RCPP
 }
 // PPC_KO_2d
-Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix X, std::string id_CV, double alpha, int k, double threshold_ppc, Rcpp::Nullable<NumericVector> alpha_vec, Rcpp::Nullable<IntegerVector> k_vec, double toll, Rcpp::Nullable<NumericVector> disc_ev_x1, int num_disc_ev_x1, Rcpp::Nullable<NumericVector> disc_ev_x2, int num_disc_ev_x2, double left_extreme_x1, double right_extreme_x1, double left_extreme_x2, double right_extreme_x2, Rcpp::Nullable<int> min_size_ts, Rcpp::Nullable<int> max_size_ts, bool err_ret, bool ex_solver, Rcpp::Nullable<int> num_threads, Rcpp::Nullable<std::string> id_rem_nan);
-RcppExport SEXP _PPCKO_PPC_KO_2d(SEXP XSEXP, SEXP id_CVSEXP, SEXP alphaSEXP, SEXP kSEXP, SEXP threshold_ppcSEXP, SEXP alpha_vecSEXP, SEXP k_vecSEXP, SEXP tollSEXP, SEXP disc_ev_x1SEXP, SEXP num_disc_ev_x1SEXP, SEXP disc_ev_x2SEXP, SEXP num_disc_ev_x2SEXP, SEXP left_extreme_x1SEXP, SEXP right_extreme_x1SEXP, SEXP left_extreme_x2SEXP, SEXP right_extreme_x2SEXP, SEXP min_size_tsSEXP, SEXP max_size_tsSEXP, SEXP err_retSEXP, SEXP ex_solverSEXP, SEXP num_threadsSEXP, SEXP id_rem_nanSEXP) {
+Rcpp::List PPC_KO_2d(Rcpp::NumericMatrix X, std::string id_CV, double alpha, int k, double threshold_ppc, Rcpp::Nullable<NumericVector> alpha_vec, Rcpp::Nullable<IntegerVector> k_vec, double toll, Rcpp::Nullable<NumericVector> disc_ev_x1, int num_disc_ev_x1, Rcpp::Nullable<NumericVector> disc_ev_x2, int num_disc_ev_x2, double left_extreme_x1, double right_extreme_x1, double left_extreme_x2, double right_extreme_x2, Rcpp::Nullable<int> min_size_ts, Rcpp::Nullable<int> max_size_ts, bool err_ret, bool ex_solver, Rcpp::Nullable<int> num_threads, Rcpp::Nullable<std::string> id_rem_nan, Rcpp::Nullable<std::string> id_quadrature, Rcpp::Nullable<std::string> id_basis, int num_basis_x1, int num_basis_x2, bool separable, Rcpp::Nullable<double> threshold_fpca, int coarse_step, int horizon, Rcpp::Nullable<double> time_budget, Rcpp::Nullable<std::string> cv_cache_file, int num_processes, Rcpp::Nullable<std::string> id_threading);
+RcppExport SEXP _PPCKO_PPC_KO_2d(SEXP XSEXP, SEXP id_CVSEXP, SEXP alphaSEXP, SEXP kSEXP, SEXP threshold_ppcSEXP, SEXP alpha_vecSEXP, SEXP k_vecSEXP, SEXP tollSEXP, SEXP disc_ev_x1SEXP, SEXP num_disc_ev_x1SEXP, SEXP disc_ev_x2SEXP, SEXP num_disc_ev_x2SEXP, SEXP left_extreme_x1SEXP, SEXP right_extreme_x1SEXP, SEXP left_extreme_x2SEXP, SEXP right_extreme_x2SEXP, SEXP min_size_tsSEXP, SEXP max_size_tsSEXP, SEXP err_retSEXP, SEXP ex_solverSEXP, SEXP num_threadsSEXP, SEXP id_rem_nanSEXP, SEXP id_quadratureSEXP, SEXP id_basisSEXP, SEXP num_basis_x1SEXP, SEXP num_basis_x2SEXP, SEXP separableSEXP, SEXP threshold_fpcaSEXP, SEXP coarse_stepSEXP, SEXP horizonSEXP, SEXP time_budgetSEXP, SEXP cv_cache_fileSEXP, SEXP num_processesSEXP, SEXP id_threadingSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -66,7 +76,67 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type ex_solver(ex_solverSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<int> >::type num_threads(num_threadsSEXP);
     Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_rem_nan(id_rem_nanSEXP);
-    rcpp_result_gen = Rcpp::wrap(PPC_KO_2d(X, id_CV, alpha, k, threshold_ppc, alpha_vec, k_vec, toll, disc_ev_x1, num_disc_ev_x1, disc_ev_x2, num_disc_ev_x2, left_extreme_x1, right_extreme_x1, left_extreme_x2, right_extreme_x2, min_size_ts, max_size_ts, err_ret, ex_solver, num_threads, id_rem_nan));
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_quadrature(id_quadratureSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_basis(id_basisSEXP);
+    Rcpp::traits::input_parameter< int >::type num_basis_x1(num_basis_x1SEXP);
+    Rcpp::traits::input_parameter< int >::type num_basis_x2(num_basis_x2SEXP);
+    Rcpp::traits::input_parameter< bool >::type separable(separableSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<double> >::type threshold_fpca(threshold_fpcaSEXP);
+    Rcpp::traits::input_parameter< int >::type coarse_step(coarse_stepSEXP);
+    Rcpp::traits::input_parameter< int >::type horizon(horizonSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<double> >::type time_budget(time_budgetSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type cv_cache_file(cv_cache_fileSEXP);
+    Rcpp::traits::input_parameter< int >::type num_processes(num_processesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_threading(id_threadingSEXP);
+    rcpp_result_gen = Rcpp::wrap(PPC_KO_2d(X, id_CV, alpha, k, threshold_ppc, alpha_vec, k_vec, toll, disc_ev_x1, num_disc_ev_x1, disc_ev_x2, num_disc_ev_x2, left_extreme_x1, right_extreme_x1, left_extreme_x2, right_extreme_x2, min_size_ts, max_size_ts, err_ret, ex_solver, num_threads, id_rem_nan, id_quadrature, id_basis, num_basis_x1, num_basis_x2, separable, threshold_fpca, coarse_step, horizon, time_budget, cv_cache_file, num_processes, id_threading));
+    return rcpp_result_gen;
+END_RCPP
+}
+// PPC_KO_batch
+Rcpp::List PPC_KO_batch(Rcpp::List X, std::string id_CV, double alpha, int k, double threshold_ppc, Rcpp::Nullable<NumericVector> alpha_vec, Rcpp::Nullable<IntegerVector> k_vec, double toll, Rcpp::Nullable<NumericVector> disc_ev, double left_extreme, double right_extreme, Rcpp::Nullable<int> min_size_ts, Rcpp::Nullable<int> max_size_ts, bool ex_solver, Rcpp::Nullable<int> num_threads, Rcpp::Nullable<std::string> id_rem_nan, int horizon);
+RcppExport SEXP _PPCKO_PPC_KO_batch(SEXP XSEXP, SEXP id_CVSEXP, SEXP alphaSEXP, SEXP kSEXP, SEXP threshold_ppcSEXP, SEXP alpha_vecSEXP, SEXP k_vecSEXP, SEXP tollSEXP, SEXP disc_evSEXP, SEXP left_extremeSEXP, SEXP right_extremeSEXP, SEXP min_size_tsSEXP, SEXP max_size_tsSEXP, SEXP ex_solverSEXP, SEXP num_threadsSEXP, SEXP id_rem_nanSEXP, SEXP horizonSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type X(XSEXP);
+    Rcpp::traits::input_parameter< std::string >::type id_CV(id_CVSEXP);
+    Rcpp::traits::input_parameter< double >::type alpha(alphaSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< double >::type threshold_ppc(threshold_ppcSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<NumericVector> >::type alpha_vec(alpha_vecSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<IntegerVector> >::type k_vec(k_vecSEXP);
+    Rcpp::traits::input_parameter< double >::type toll(tollSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<NumericVector> >::type disc_ev(disc_evSEXP);
+    Rcpp::traits::input_parameter< double >::type left_extreme(left_extremeSEXP);
+    Rcpp::traits::input_parameter< double >::type right_extreme(right_extremeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<int> >::type min_size_ts(min_size_tsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<int> >::type max_size_ts(max_size_tsSEXP);
+    Rcpp::traits::input_parameter< bool >::type ex_solver(ex_solverSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<int> >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_rem_nan(id_rem_nanSEXP);
+    Rcpp::traits::input_parameter< int >::type horizon(horizonSEXP);
+    rcpp_result_gen = Rcpp::wrap(PPC_KO_batch(X, id_CV, alpha, k, threshold_ppc, alpha_vec, k_vec, toll, disc_ev, left_extreme, right_extreme, min_size_ts, max_size_ts, ex_solver, num_threads, id_rem_nan, horizon));
+    return rcpp_result_gen;
+END_RCPP
+}
+// PPC_KO_panel
+Rcpp::List PPC_KO_panel(Rcpp::List X, double alpha, int k, double threshold_ppc, Rcpp::Nullable<NumericVector> disc_ev, double left_extreme, double right_extreme, bool ex_solver, Rcpp::Nullable<int> num_threads, Rcpp::Nullable<std::string> id_rem_nan, int horizon);
+RcppExport SEXP _PPCKO_PPC_KO_panel(SEXP XSEXP, SEXP alphaSEXP, SEXP kSEXP, SEXP threshold_ppcSEXP, SEXP disc_evSEXP, SEXP left_extremeSEXP, SEXP right_extremeSEXP, SEXP ex_solverSEXP, SEXP num_threadsSEXP, SEXP id_rem_nanSEXP, SEXP horizonSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type X(XSEXP);
+    Rcpp::traits::input_parameter< double >::type alpha(alphaSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< double >::type threshold_ppc(threshold_ppcSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<NumericVector> >::type disc_ev(disc_evSEXP);
+    Rcpp::traits::input_parameter< double >::type left_extreme(left_extremeSEXP);
+    Rcpp::traits::input_parameter< double >::type right_extreme(right_extremeSEXP);
+    Rcpp::traits::input_parameter< bool >::type ex_solver(ex_solverSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<int> >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::Nullable<std::string> >::type id_rem_nan(id_rem_nanSEXP);
+    Rcpp::traits::input_parameter< int >::type horizon(horizonSEXP);
+    rcpp_result_gen = Rcpp::wrap(PPC_KO_panel(X, alpha, k, threshold_ppc, disc_ev, left_extreme, right_extreme, ex_solver, num_threads, id_rem_nan, horizon));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -116,14 +186,28 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// data_batch_wrapper_from_array
+Rcpp::List data_batch_wrapper_from_array(Rcpp::NumericVector Xt);
+RcppExport SEXP _PPCKO_data_batch_wrapper_from_array(SEXP XtSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type Xt(XtSEXP);
+    rcpp_result_gen = Rcpp::wrap(data_batch_wrapper_from_array(Xt));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_PPCKO_PPC_KO", (DL_FUNC) &_PPCKO_PPC_KO, 17},
-    {"_PPCKO_PPC_KO_2d", (DL_FUNC) &_PPCKO_PPC_KO_2d, 22},
+    {"_PPCKO_PPC_KO", (DL_FUNC) &_PPCKO_PPC_KO, 27},
+    {"_PPCKO_PPC_KO_2d", (DL_FUNC) &_PPCKO_PPC_KO_2d, 34},
+    {"_PPCKO_PPC_KO_batch", (DL_FUNC) &_PPCKO_PPC_KO_batch, 17},
+    {"_PPCKO_PPC_KO_panel", (DL_FUNC) &_PPCKO_PPC_KO_panel, 11},
     {"_PPCKO_KO_check_hps", (DL_FUNC) &_PPCKO_KO_check_hps, 1},
     {"_PPCKO_KO_check_hps_2d", (DL_FUNC) &_PPCKO_KO_check_hps_2d, 3},
     {"_PPCKO_data_2d_wrapper_from_list", (DL_FUNC) &_PPCKO_data_2d_wrapper_from_list, 1},
     {"_PPCKO_data_2d_wrapper_from_array", (DL_FUNC) &_PPCKO_data_2d_wrapper_from_array, 1},
+    {"_PPCKO_data_batch_wrapper_from_array", (DL_FUNC) &_PPCKO_data_batch_wrapper_from_array, 1},
     {NULL, NULL, 0}
 };
 
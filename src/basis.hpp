@@ -0,0 +1,235 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_BASIS_HPP
+#define KO_BASIS_HPP
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <tuple>
+#include <cmath>
+#include <numbers>
+
+#include <Eigen/Eigenvalues>
+
+#include "traits_ko.hpp"
+#include "mesh.hpp"
+
+
+/*!
+* @file basis.hpp
+* @brief Contains the basis expansion of the fts: PPCKO is performed on the p coefficients of the curves/surfaces instead of on the m discrete evaluations
+* @author Andrea Enrico Franzoni
+* @details Given the basis evaluated on the grid (Phi, m x p), eventually already weighted by the square root of the quadrature weights, and its 
+*          Gram matrix G = Phi'Phi, the coefficients are mapped into G^(1/2)c, so that the L2 inner product between curves becomes the euclidean 
+*          one between transformed coefficients. Analysis (m -> p): G^(-1/2)Phi' (least squares projection). Synthesis (p -> m): Phi G^(-1/2)
+*/
+
+
+/*!
+* @brief Evaluation of the basis on a 1D grid
+* @tparam basis basis type
+* @param grid mesh containing the points in which the functional data are evaluated
+* @param num_basis number of basis functions (p)
+* @return the matrix of the evaluations (m x p): each column is a basis function
+* @details B-splines are cubic, with uniform knots on the domain of the grid (p-4 interior knots). Fourier basis is made by the constant 
+*          and, alternated, sines and cosines with increasing frequencies, periodic on the domain of the grid
+*/
+template<BASIS basis>
+KO_Traits::StoringMatrix
+basis_evaluation(const Geometry::Mesh1D &grid, int num_basis)
+{
+  const std::size_t n_nodes = grid.numNodes();
+  const double a = grid.domain().left();
+  const double b = grid.domain().right();
+  KO_Traits::StoringMatrix phi = KO_Traits::StoringMatrix::Zero(n_nodes,num_basis);
+  
+  if constexpr(basis == BASIS::BSPLINE)
+  {
+    constexpr int order = 4;    //cubic
+    
+    //open uniform knots vector
+    std::vector<double> knots;
+    knots.reserve(num_basis + order);
+    for(int j = 0; j < order; ++j){  knots.push_back(a);}
+    for(int j = 1; j < num_basis - order + 1; ++j){  knots.push_back(a + (b-a)*static_cast<double>(j)/static_cast<double>(num_basis - order + 1));}
+    for(int j = 0; j < order; ++j){  knots.push_back(b);}
+    
+    //Cox-de Boor recursion, for each node
+    for(std::size_t i = 0; i < n_nodes; ++i)
+    {
+      const double x = grid[i];
+      std::vector<double> B(knots.size() - 1, 0.0);
+      
+      //degree 0: the last non-empty interval is closed on the right
+      for(std::size_t j = 0; j < knots.size() - 1; ++j)
+      {
+        if((knots[j] <= x && x < knots[j+1]) || (x == b && knots[j] < b && knots[j+1] == b)){  B[j] = 1.0;}
+      }
+      
+      for(int d = 1; d < order; ++d)
+      {
+        for(std::size_t j = 0; j + d < knots.size() - 1; ++j)
+        {
+          const double left  = knots[j+d]   > knots[j]   ? (x - knots[j])/(knots[j+d] - knots[j])*B[j]           : 0.0;
+          const double right = knots[j+d+1] > knots[j+1] ? (knots[j+d+1] - x)/(knots[j+d+1] - knots[j+1])*B[j+1] : 0.0;
+          B[j] = left + right;
+        }
+      }
+      
+      for(int j = 0; j < num_basis; ++j){  phi(i,j) = B[j];}
+    }
+  }
+  
+  if constexpr(basis == BASIS::FOURIER)
+  {
+    const double T = b - a;
+    
+    for(std::size_t i = 0; i < n_nodes; ++i)
+    {
+      const double x = grid[i];
+      phi(i,0) = 1.0/std::sqrt(T);
+      
+      for(int j = 1; j < num_basis; ++j)
+      {
+        const double freq = 2.0*std::numbers::pi*static_cast<double>((j+1)/2)*(x - a)/T;
+        phi(i,j) = j%2==1 ? std::sqrt(2.0/T)*std::sin(freq) : std::sqrt(2.0/T)*std::cos(freq);
+      }
+    }
+  }
+  
+  return phi;
+}
+
+
+/*!
+* @brief Evaluation of the basis on a 1D grid, basis type selected at runtime
+* @param grid mesh containing the points in which the functional data are evaluated
+* @param id_basis basis type
+* @param num_basis number of basis functions (p)
+* @return the matrix of the evaluations (m x p)
+*/
+inline
+KO_Traits::StoringMatrix
+basis_evaluation(const Geometry::Mesh1D &grid, BASIS id_basis, int num_basis)
+{
+  if(id_basis == BASIS::FOURIER){  return basis_evaluation<BASIS::FOURIER>(grid,num_basis);}
+  
+  return basis_evaluation<BASIS::BSPLINE>(grid,num_basis);
+}
+
+
+/*!
+* @brief Tensor-product basis on a 2D grid
+* @param phi_x1 basis evaluations along dimension 1 (m1 x p1)
+* @param phi_x2 basis evaluations along dimension 2 (m2 x p2)
+* @return the matrix of the evaluations ((m1*m2) x (p1*p2)), coherently with the column-wise flattening of the surface (index: i1 + i2*m1)
+*/
+inline
+KO_Traits::StoringMatrix
+basis_evaluation(const KO_Traits::StoringMatrix &phi_x1, const KO_Traits::StoringMatrix &phi_x2)
+{
+  KO_Traits::StoringMatrix phi(phi_x1.rows()*phi_x2.rows(),phi_x1.cols()*phi_x2.cols());
+  
+  for(std::size_t j2 = 0; j2 < phi_x2.cols(); ++j2)
+  {
+    for(std::size_t i2 = 0; i2 < phi_x2.rows(); ++i2)
+    {
+      phi.block(i2*phi_x1.rows(),j2*phi_x1.cols(),phi_x1.rows(),phi_x1.cols()) = phi_x2(i2,j2)*phi_x1;
+    }
+  }
+  
+  return phi;
+}
+
+
+/*!
+* @brief Analysis and synthesis operators of the basis expansion
+* @param phi basis evaluations on the grid (m x p)
+* @param rows_retained points of the grid retained (the ones without dummy NaNs). If empty, all the points are retained
+* @param sqrt_w square root of the quadrature weights of the retained points (if empty: uniform grid)
+* @return a pair containing the analysis operator G^(-1/2)Phi' (p x m) and the synthesis operator Phi G^(-1/2) (m x p)
+* @note throws if the Gram matrix is singular (the grid does not resolve the basis)
+*/
+inline
+std::pair<KO_Traits::StoringMatrix,KO_Traits::StoringMatrix>
+basis_coordinates(const KO_Traits::StoringMatrix &phi, const std::vector<int> &rows_retained, const KO_Traits::StoringArray &sqrt_w)
+{
+  KO_Traits::StoringMatrix phi_ret = rows_retained.empty() ? phi : KO_Traits::StoringMatrix(phi(rows_retained,Eigen::all));
+  if(sqrt_w.size()>0){  phi_ret = sqrt_w.matrix().asDiagonal()*phi_ret;}
+  
+  //Gram matrix: self-adjoint: exploiting it
+  Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> eigensolver_gram(phi_ret.transpose()*phi_ret);
+  
+  if(eigensolver_gram.eigenvalues().minCoeff() <= 1e-12*eigensolver_gram.eigenvalues().maxCoeff())
+  {
+    std::string error_message = "The Gram matrix of the basis is singular: reduce the number of basis functions or refine the grid";
+    throw std::invalid_argument(error_message);
+  }
+  
+  KO_Traits::StoringMatrix gram_inv_sqrt = eigensolver_gram.operatorInverseSqrt();
+  
+  return std::make_pair(gram_inv_sqrt*phi_ret.transpose(),phi_ret*gram_inv_sqrt);
+}
+
+
+/*!
+* @brief Mapping the fts onto the coefficients space: X <- G^(-1/2)Phi'X
+* @param X fts (modified in place: from m x n to p x n)
+* @param analysis analysis operator (if empty: no basis expansion, nothing is done)
+* @note missing evaluations cannot be projected: throws if the fts contains NaNs
+*/
+inline
+void
+to_coefficients(KO_Traits::StoringMatrix &X, const KO_Traits::StoringMatrix &analysis)
+{
+  if(analysis.size()==0){  return;}
+  
+  if(X.hasNaN())
+  {
+    std::string error_message = "Projection onto a basis cannot be performed with missing evaluations: impute them";
+    throw std::invalid_argument(error_message);
+  }
+  
+  X = analysis*X;
+}
+
+
+/*!
+* @brief Mapping the results of PPCKO back from the coefficients space onto the grid: prediction, directions, weights and mean function are multiplied by Phi G^(-1/2)
+* @tparam RES type of the results tuple (depending on if validation errors are stored)
+* @param results results of PPCKO (modified in place)
+* @param synthesis synthesis operator (if empty: no basis expansion, nothing is done)
+* @details Scores, their standard deviations and the explanatory power are inner products: they are invariant
+*/
+template<typename RES>
+void
+from_coefficients(RES &results, const KO_Traits::StoringMatrix &synthesis)
+{
+  if(synthesis.size()==0){  return;}
+  
+  std::get<0>(results) = synthesis*std::get<0>(results);                          //predictions
+  std::get<5>(results) = synthesis*std::get<5>(results);                          //directions
+  std::get<6>(results) = synthesis*std::get<6>(results);                          //weights
+  std::get<8>(results) = (synthesis*std::get<8>(results).matrix()).array();       //mean function
+}
+
+#endif  /*KO_BASIS_HPP*/
@@ -0,0 +1,135 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_COMPRESSED_FTS_HPP
+#define KO_COMPRESSED_FTS_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "traits_ko.hpp"
+
+
+/*!
+* @file compressed_fts.hpp
+* @brief Contains the compressed column store of the fts, used to keep the (not centered) fts resident during the cv
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!
+* @class compressed_fts
+* @brief Fts quantized column-wise on 16 bits (offset and scale for each instant): a quarter of the memory of the doubles
+* @details Each evaluation is stored as round((x - offset)/scale), with offset the midpoint of the range of the instant and scale
+*          such that the range is covered by [-32766,32766]: the absolute error is at most range/131064. Missing evaluations are stored 
+*          as a sentinel code, and decoded as NaNs. Columns are decoded on the fly, only when requested
+*/
+class compressed_fts
+{
+private:
+
+  /*!Code for missing evaluations*/
+  static constexpr std::int16_t m_nan_code = std::numeric_limits<std::int16_t>::min();
+  /*!Largest code for available evaluations*/
+  static constexpr double m_max_code = 32766.0;
+  
+  /*!Quantized evaluations (matrix: m x n)*/
+  Eigen::Matrix<std::int16_t,Eigen::Dynamic,Eigen::Dynamic> m_codes;
+  /*!Offset of each instant*/
+  KO_Traits::StoringArray m_offset;
+  /*!Scale of each instant*/
+  KO_Traits::StoringArray m_scale;
+  
+public:
+  
+  /*!
+  * @brief Constructor: quantizes the fts
+  * @param X fts (matrix: m x n, eventually with NaNs)
+  */
+  compressed_fts(const KO_Traits::StoringMatrix &X)
+    : m_codes(X.rows(),X.cols()), m_offset(X.cols()), m_scale(X.cols())
+    {
+      for(Eigen::Index j = 0; j < X.cols(); ++j)
+      {
+        double min_j = std::numeric_limits<double>::infinity();
+        double max_j = -std::numeric_limits<double>::infinity();
+        for(Eigen::Index i = 0; i < X.rows(); ++i)
+        {
+          if(!std::isnan(X(i,j))){  min_j = std::min(min_j,X(i,j));  max_j = std::max(max_j,X(i,j));}
+        }
+        
+        //instant with all the evaluations missing or constant
+        m_offset(j) = min_j <= max_j ? 0.5*(min_j + max_j) : 0.0;
+        m_scale(j)  = min_j <  max_j ? (max_j - min_j)/(2.0*m_max_code) : 1.0;
+        
+        for(Eigen::Index i = 0; i < X.rows(); ++i)
+        {
+          m_codes(i,j) = std::isnan(X(i,j)) ? m_nan_code : static_cast<std::int16_t>(std::lround((X(i,j) - m_offset(j))/m_scale(j)));
+        }
+      }
+    }
+  
+  /*!
+  * @brief Getter for the number of evaluations of each instant
+  * @return the number of rows of the fts
+  */
+  inline Eigen::Index rows() const {return m_codes.rows();};
+  
+  /*!
+  * @brief Getter for the number of instants
+  * @return the number of columns of the fts
+  */
+  inline Eigen::Index cols() const {return m_codes.cols();};
+  
+  /*!
+  * @brief Decoding contiguous instants
+  * @param first_col first instant to be decoded
+  * @param num_cols number of instants to be decoded
+  * @return the decoded instants (matrix: m x num_cols)
+  */
+  KO_Traits::StoringMatrix 
+  decode(Eigen::Index first_col, Eigen::Index num_cols) 
+  const
+  {
+    KO_Traits::StoringMatrix X(this->rows(),num_cols);
+    
+    for(Eigen::Index j = 0; j < num_cols; ++j)
+    {
+      const Eigen::Index col = first_col + j;
+      X.col(j) = m_codes.col(col).unaryExpr([this,col](std::int16_t code){ return code == m_nan_code ? std::numeric_limits<double>::quiet_NaN() : m_offset(col) + m_scale(col)*static_cast<double>(code);});
+    }
+    
+    return X;
+  }
+};
+
+
+/*!
+* Type of the fts kept resident during the cv: compressed if compiled with KO_COMPRESSED_FTS, doubles otherwise
+*/
+#ifdef KO_COMPRESSED_FTS
+using cv_storing_t = compressed_fts;
+#else
+using cv_storing_t = KO_Traits::StoringMatrix;
+#endif
+
+#endif  /*KO_COMPRESSED_FTS_HPP*/
@@ -0,0 +1,200 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_CV_BUDGET_HPP
+#define KO_CV_BUDGET_HPP
+
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <utility>
+
+#include "parallel_backend.hpp"
+#include "ko_log.hpp"
+
+
+/*!
+* @file cv_budget.hpp
+* @brief Contains the time budget of the cv, and the evaluation of its candidates in priority order until the budget expires or the user interrupts
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!Minimum number of seconds between two progress reports of a time-budgeted cv (can be set at compile time)*/
+#ifndef KO_CV_BUDGET_PROGRESS_SECS
+#define KO_CV_BUDGET_PROGRESS_SECS 1.0
+#endif
+
+
+/*!
+* @class cv_budget
+* @brief Wall-clock budget of the cv, started at construction, together with an optional check for user interrupts
+* @details A non-positive number of seconds means no deadline. The interrupt check is called only from the main thread
+*/
+class cv_budget
+{
+private:
+  
+  /*!Seconds available (non-positive: no deadline)*/
+  double m_seconds;
+  /*!Returns true if the user asked to interrupt the computations (empty: never)*/
+  std::function<bool()> m_interrupted;
+  /*!Starting instant*/
+  std::chrono::steady_clock::time_point m_start;
+  
+public:
+  
+  /*!
+  * @brief Constructor
+  * @param seconds seconds available (non-positive: no deadline)
+  * @param interrupted function returning true if the user asked to interrupt the computations
+  */
+  cv_budget(double seconds = 0.0, std::function<bool()> interrupted = std::function<bool()>())
+    : m_seconds(seconds), m_interrupted(std::move(interrupted)), m_start(std::chrono::steady_clock::now())  {}
+  
+  /*!
+  * @brief Getter for the seconds available
+  * @return the private m_seconds
+  */
+  inline double seconds() const {return m_seconds;};
+  
+  /*!
+  * @brief Restarting the clock
+  */
+  inline void start() {m_start = std::chrono::steady_clock::now();};
+  
+  /*!
+  * @brief Seconds elapsed since the start
+  */
+  inline double elapsed() const {return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();};
+  
+  /*!
+  * @brief If the deadline has been reached
+  */
+  inline bool expired() const {return m_seconds > 0.0 && this->elapsed() >= m_seconds;};
+  
+  /*!
+  * @brief If the user asked to interrupt the computations (has to be called from the main thread)
+  */
+  inline bool interrupted() const {return m_interrupted && m_interrupted();};
+  
+  /*!
+  * @brief If the cv has to be carried out under the budget (deadline or interrupt check)
+  */
+  inline bool active() const {return m_seconds > 0.0 || static_cast<bool>(m_interrupted);};
+};
+
+
+/*!
+* @brief Priority order of the candidates of a grid, coarse grid first: the two extremes, then, recursively, the midpoints of the intervals left
+* @param n number of candidates
+* @return the indices of the candidates, in the order in which they have to be evaluated
+*/
+inline
+std::vector<std::size_t>
+coarse_first_order(std::size_t n)
+{
+  std::vector<std::size_t> order;
+  order.reserve(n);
+  if(n == 0){  return order;}
+  
+  order.emplace_back(0);
+  if(n == 1){  return order;}
+  order.emplace_back(n - 1);
+  
+  //intervals (extremes excluded) still to be split, breadth-first
+  std::deque<std::pair<std::size_t,std::size_t>> intervals{{0,n - 1}};
+  while(!intervals.empty())
+  {
+    auto [left,right] = intervals.front();
+    intervals.pop_front();
+    if(right - left < 2){  continue;}
+    
+    const std::size_t mid = left + (right - left)/2;
+    order.emplace_back(mid);
+    intervals.emplace_back(left,mid);
+    intervals.emplace_back(mid,right);
+  }
+  
+  return order;
+}
+
+
+/*!
+* @brief Evaluating the candidates of a cv in priority order, until all of them are evaluated, the budget expires or the user interrupts
+* @param budget time budget of the cv
+* @param order indices of the candidates, in priority order
+* @param number_threads number of threads for OMP
+* @param eval function evaluating the candidate of a given index
+* @return for each index: 1 if the candidate has been evaluated, 0 if not
+* @details A candidate is started only if the deadline has not been reached, apart from the first one, that is always evaluated: the overshoot 
+*          past the deadline is bounded by the evaluation of one candidate per thread. The interrupt check and the progress report are 
+*          made only by the main thread, between two candidates
+* @note parallel loops through 'KO_Parallel'
+*/
+template<typename EVAL>
+std::vector<char>
+budgeted_evaluation(const cv_budget &budget, const std::vector<std::size_t> &order, int number_threads, EVAL &&eval)
+{
+  const int tot_candidates = order.size();
+  std::vector<char> done(tot_candidates,0);
+  std::atomic<bool> stop{false};
+  std::atomic<int> evaluated{0};
+  double last_report = 0.0;
+  
+  //only the main thread checks interrupts and reports progress
+  auto main_thread_duties = [&]()
+  {
+    if(!KO_Parallel::main_thread()){  return;}
+    if(budget.interrupted()){  stop = true;}
+    const double elapsed = budget.elapsed();
+    if(budget.seconds() > 0.0 && elapsed - last_report >= KO_CV_BUDGET_PROGRESS_SECS)
+    {
+      last_report = elapsed;
+      KO_Log::message("Cv: ",evaluated.load()," of ",tot_candidates," candidates evaluated, ",elapsed," of ",budget.seconds()," seconds");
+    }
+  };
+  
+  KO_Parallel::parallel_for(tot_candidates,
+                            number_threads,
+                            [&](std::size_t j)
+                            {
+                              if(j > 0 && (stop || budget.expired())){  return;}
+                              
+                              eval(order[j]);
+                              done[order[j]] = 1;
+                              ++evaluated;
+                              main_thread_duties();
+                            },
+                            PAR_SCHEDULE::DYNAMIC);
+  
+  if(evaluated < tot_candidates)
+  {
+    KO_Log::message("Cv stopped (",(stop ? "interrupted by the user" : "time budget expired"),"): ",evaluated.load()," of ",tot_candidates," candidates evaluated, best one among them retained");
+  }
+  
+  return done;
+}
+
+
+#endif  //KO_CV_BUDGET_HPP
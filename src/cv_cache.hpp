@@ -0,0 +1,294 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_CV_CACHE_HPP
+#define KO_CV_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "traits_ko.hpp"
+
+
+/*!
+* @file cv_cache.hpp
+* @brief Contains the on-disk cache of the validation errors of the cv, for each regularization parameter, number of retained PPCs and split
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!
+* @class cv_fingerprint
+* @brief 64-bit FNV-1a hash of the bytes of the objects added to it
+*/
+class cv_fingerprint
+{
+private:
+  
+  /*!Current value of the hash*/
+  std::uint64_t m_hash = 14695981039346656037ULL;
+  
+  /*!
+  * @brief Adding a sequence of bytes
+  */
+  inline 
+  void 
+  add_bytes(const void *data, std::size_t size)
+  {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    for(std::size_t i = 0; i < size; ++i)
+    {
+      m_hash ^= bytes[i];
+      m_hash *= 1099511628211ULL;
+    }
+  }
+  
+public:
+  
+  /*!
+  * @brief Adding an arithmetic value or an enumerator
+  */
+  template<typename T>
+  requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+  inline cv_fingerprint & add(T value) {this->add_bytes(&value,sizeof(T)); return *this;};
+  
+  /*!
+  * @brief Adding a string (its characters)
+  */
+  inline 
+  cv_fingerprint & 
+  add(const std::string &s)
+  {
+    this->add_bytes(s.data(),s.size());
+    return *this;
+  }
+  
+  /*!
+  * @brief Adding a matrix (dimensions and values, column-major)
+  */
+  inline 
+  cv_fingerprint & 
+  add(const KO_Traits::StoringMatrix &X)
+  {
+    this->add(X.rows()).add(X.cols());
+    this->add_bytes(X.data(),sizeof(double)*X.size());
+    return *this;
+  }
+  
+  /*!
+  * @brief Adding a vector of indices (size and values)
+  */
+  inline 
+  cv_fingerprint & 
+  add(const std::vector<int> &v)
+  {
+    this->add(v.size());
+    this->add_bytes(v.data(),sizeof(int)*v.size());
+    return *this;
+  }
+  
+  /*!
+  * @brief Getter for the hash
+  * @return the private m_hash
+  */
+  inline std::uint64_t value() const {return m_hash;};
+};
+
+
+/*!
+* @brief Fingerprint of a training/validation split: indices of the training and of the validation set
+* @param split pair containing the column indices of training and validation set
+* @return the hash of the split
+*/
+inline
+std::uint64_t
+split_fingerprint(const std::pair<std::vector<int>,std::vector<int>> &split)
+{
+  return cv_fingerprint().add(split.first).add(split.second).value();
+}
+
+
+/*!
+* @brief Parsing a floating point number written by the cv cache (hexadecimal, or nan/inf)
+* @param token the characters of the number
+* @param value where the number is written
+* @return true if the whole token is a number
+*/
+inline
+bool
+parse_cache_double(const std::string &token, double &value)
+{
+  if(token.empty()){  return false;}
+  char *end = nullptr;
+  value = std::strtod(token.c_str(),&end);
+  return end == token.c_str() + token.size();
+}
+
+
+/*!
+* @class cv_cache
+* @brief Validation errors of the cv, for each regularization parameter, number of retained PPCs and split, persisted in a local text file
+* @details Each line of the file is an entry: fingerprint of data and solver settings, regularization parameter (hexadecimal, exact), number of retained PPCs, 
+*          fingerprint of the split, validation error (hexadecimal, exact), checksum of the previous fields, terminated by ';'. Lines without the 
+*          terminator, with a wrong checksum or with leftover characters (as the last one of a run killed while writing) are discarded. Only the entries with the same fingerprint of the current run are loaded, and each new entry is 
+*          appended (and flushed) as soon as it is evaluated: a run that dies can be resumed, and a run on a wider input space evaluates only the new 
+*          entries. The same file can be shared by different data sets. Thread-safe.
+*/
+class cv_cache
+{
+private:
+  
+  /*!Key of an entry: regularization parameter, number of retained PPCs, fingerprint of the split*/
+  using key_t = std::tuple<double,int,std::uint64_t>;
+  
+  /*!File storing the entries*/
+  std::string m_file;
+  /*!Fingerprint of data and solver settings*/
+  std::uint64_t m_fingerprint;
+  /*!Entries with the current fingerprint*/
+  std::map<key_t,double> m_entries;
+  /*!Stream appending the new entries*/
+  std::ofstream m_out;
+  /*!Mutex for concurrent lookups and stores*/
+  mutable std::mutex m_mutex;
+  /*!Number of lookups satisfied by the cache*/
+  mutable std::size_t m_hits = 0;
+  /*!Number of entries added by the current run*/
+  std::size_t m_added = 0;
+  
+public:
+  
+  /*!
+  * @brief Constructor: loads the entries of the file with the given fingerprint, and opens it to append the new ones
+  * @param file path of the cache file (created if it does not exist)
+  * @param fingerprint fingerprint of data and solver settings
+  */
+  cv_cache(const std::string &file, std::uint64_t fingerprint)
+    : m_file(file), m_fingerprint(fingerprint)
+  {
+    std::ifstream in(m_file);
+    std::string line;
+    while(std::getline(in,line))
+    {
+      //a record is valid only if terminated and matching its checksum
+      if(line.empty() || line.back() != ';'){  continue;}
+      const auto sep = line.find_last_of(' ');
+      if(sep == std::string::npos){  continue;}
+      const std::string record   = line.substr(0,sep);
+      const std::string checksum = line.substr(sep + 1,line.size() - sep - 2);
+      std::istringstream check(checksum);
+      std::uint64_t record_checksum;
+      if(!(check >> std::hex >> record_checksum) || !(check >> std::ws).eof() || record_checksum != cv_fingerprint().add(record).value()){  continue;}
+      
+      std::istringstream entry(record);
+      std::uint64_t fp, split;
+      std::string alpha_s, err_s;
+      int k;
+      double alpha, err;
+      if(!(entry >> std::hex >> fp >> alpha_s >> std::dec >> k >> std::hex >> split >> err_s) || !(entry >> std::ws).eof() || fp != m_fingerprint){  continue;}
+      if(!parse_cache_double(alpha_s,alpha) || !parse_cache_double(err_s,err)){  continue;}
+      m_entries[std::make_tuple(alpha,k,split)] = err;
+    }
+    in.close();
+    
+    //a run killed while writing a record leaves the last line unterminated: the new records have to start on a line of their own
+    bool terminated = true;
+    std::ifstream last(m_file,std::ios::binary | std::ios::ate);
+    if(last && last.tellg() > 0)
+    {
+      last.seekg(-1,std::ios::end);
+      terminated = last.get() == '\n';
+    }
+    last.close();
+    
+    m_out.open(m_file,std::ios::app);
+    if(!m_out)
+    {
+      std::string error_message = "cv cache file " + m_file + " cannot be opened";
+      throw std::invalid_argument(error_message);
+    }
+    if(!terminated){  m_out << '\n';}
+  }
+  
+  /*!
+  * @brief Getter for the number of lookups satisfied by the cache
+  * @return the private m_hits
+  */
+  inline std::size_t hits() const {return m_hits;};
+  
+  /*!
+  * @brief Getter for the number of entries added by the current run
+  * @return the private m_added
+  */
+  inline std::size_t added() const {return m_added;};
+  
+  /*!
+  * @brief Looking for an entry
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs
+  * @param split fingerprint of the split
+  * @param err where the validation error is written, if found
+  * @return true if the entry is in the cache
+  */
+  inline 
+  bool 
+  lookup(double alpha, int k, std::uint64_t split, double &err) 
+  const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(std::make_tuple(alpha,k,split));
+    if(it == m_entries.end()){  return false;}
+    err = it->second;
+    ++m_hits;
+    return true;
+  }
+  
+  /*!
+  * @brief Storing an entry, appending it to the file
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs
+  * @param split fingerprint of the split
+  * @param err validation error
+  */
+  inline 
+  void 
+  store(double alpha, int k, std::uint64_t split, double err)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_entries.emplace(std::make_tuple(alpha,k,split),err).second){  return;}
+    std::ostringstream record;
+    record << std::hex << m_fingerprint << " " << std::hexfloat << alpha << " " << std::dec << k << " " << std::hex << split << " " << std::hexfloat << err;
+    m_out << record.str() << " " << std::hex << cv_fingerprint().add(record.str()).value() << ";" << std::endl;
+    ++m_added;
+  }
+};
+
+
+#endif  //KO_CV_CACHE_HPP
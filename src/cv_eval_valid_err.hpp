@@ -22,6 +22,10 @@
 
 #include <algorithm>
 #include <numeric>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <utility>
 
 #include "traits_ko.hpp"
 
@@ -38,36 +42,158 @@
 
 
 /*!
-* @brief Template function for the estimate of the L2 norm
-* @tparam T type of the data
-* @param diff vector containing the differences
-* @param number_threads number of threads for OMP
-* @return the L2 norm of 'diff'
-* @note eventual usage of 'pragma' directive for OMP
+* @brief Fused evaluation of a validation loss: difference between prediction and validation set, availability and reductions in a single vectorized pass
+* @tparam weighted if each evaluation is weighted
+* @tparam NUM pointwise loss of the difference
+* @tparam DEN pointwise normalization, function of the validation set
+* @param pred prediction on validation set
+* @param valid validation set
+* @param weights weight of each evaluation (used only if 'weighted')
+* @param num pointwise loss of the difference
+* @param den pointwise normalization
+* @return the ratio between the (weighted) sums of the pointwise losses and of the pointwise normalizations
+* @details NaNs differences (missing evaluations in the validation set) are not taken into account. No temporary is built, and no parallel region is
+*          opened: the loss is evaluated inside the (eventually parallel) loop over the cv iterations. If no evaluation is available, or the
+*          normalization vanishes (null weights, or null validation set for the relative loss), NaN is returned: the split has no error
 */
-template<typename T>
-double mse(const KO_Traits::StoringVector &diff, int number_threads)
+template<bool weighted, typename NUM, typename DEN>
+double
+fused_valid_err(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, const Eigen::Ref<const KO_Traits::StoringVector> &weights, NUM num, DEN den)
 {
-  double mse = 0.0;
-  int num_comp = diff.size();
+  const double *p = pred.data();
+  const double *v = valid.data();
+  const double *w = weights.data();
+  const Eigen::Index size = valid.size();
+  double sum_num = 0.0;
+  double sum_den = 0.0;
   
-  //if OMP: going parallel
 #ifdef _OPENMP
-#pragma omp parallel for shared(diff,num_comp) num_threads(number_threads) reduction(+:mse)
-  for(std::size_t i = 0; i < num_comp; ++i)
+#pragma omp simd reduction(+:sum_num,sum_den)
+#endif
+  for(Eigen::Index i = 0; i < size; ++i)
   {
-    mse += std::pow(diff(i),2);
+    const double diff = p[i] - v[i];
+    //NaN is the only value not equal to itself
+    const bool available = diff == diff;
+    const double weight = weighted ? w[i] : 1.0;
+    sum_num += available ? weight*num(diff) : 0.0;
+    sum_den += available ? weight*den(v[i]) : 0.0;
   }
-#else
-  // if not OMP: STL algorithms
-  mse = std::transform_reduce(diff.begin(),
-                              diff.end(),
-                              0.0,
-                              std::plus{},
-                              [] (T const &x) {return std::pow(x,2);});
-#endif
   
-  return mse/static_cast<double>(num_comp);
+  if(sum_den == 0.0){ return std::numeric_limits<double>::quiet_NaN();}
+  
+  return sum_num/sum_den;
+};
+
+
+/*!
+* @brief Estimate of the L2 norm of the difference between prediction and validation set
+* @param pred prediction on validation set
+* @param valid validation set
+* @return the mean of the squared differences over the available evaluations
+*/
+inline
+double
+mse(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid)
+{
+  return fused_valid_err<false>(pred,valid,valid,[](double d){return d*d;},[](double){return 1.0;});
+};
+
+
+/*!
+* @brief Estimate of the L1 norm of the difference between prediction and validation set
+* @param pred prediction on validation set
+* @param valid validation set
+* @return the mean of the absolute differences over the available evaluations
+*/
+inline
+double
+mae(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid)
+{
+  return fused_valid_err<false>(pred,valid,valid,[](double d){return std::abs(d);},[](double){return 1.0;});
+};
+
+
+/*!
+* @brief Estimate of the weighted L2 norm of the difference between prediction and validation set
+* @param pred prediction on validation set
+* @param valid validation set
+* @param weights weight of each evaluation
+* @return the weighted mean of the squared differences over the available evaluations
+*/
+inline
+double
+weighted_mse(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid, const Eigen::Ref<const KO_Traits::StoringVector> &weights)
+{
+  return fused_valid_err<true>(pred,valid,weights,[](double d){return d*d;},[](double){return 1.0;});
+};
+
+
+/*!
+* @brief Estimate of the L2 norm of the difference between prediction and validation set, relative to the one of the validation set
+* @param pred prediction on validation set
+* @param valid validation set
+* @return the ratio between the sums of the squared differences and of the squared validation set over the available evaluations
+*/
+inline
+double
+relative_mse(const Eigen::Ref<const KO_Traits::StoringVector> &pred, const Eigen::Ref<const KO_Traits::StoringVector> &valid)
+{
+  return fused_valid_err<false>(pred,valid,valid,[](double d){return d*d;},[](double v){return v*v;});
+};
+
+
+/*!
+* @brief Sum of the errors of the splits, skipping the splits without an error (NaN: no evaluation available in their validation set)
+* @param errors error of each split
+* @return the sum of the errors and the number of splits with an error
+*/
+inline
+std::pair<double,std::size_t>
+valid_splits_sum(const std::vector<double> &errors)
+{
+  double sum = 0.0;
+  std::size_t count = 0;
+  for(double err : errors)
+  {
+    if(!std::isnan(err)){  sum += err;  ++count;}
+  }
+  
+  return std::make_pair(sum,count);
+};
+
+
+/*!
+* @brief Mean of the errors of the splits, over the splits with an error
+* @param errors error of each split
+* @return the mean of the errors (NaN if no split has an error)
+*/
+inline
+double
+valid_splits_mean(const std::vector<double> &errors)
+{
+  const auto [sum,count] = valid_splits_sum(errors);
+  
+  return count > 0 ? sum/static_cast<double>(count) : std::numeric_limits<double>::quiet_NaN();
+};
+
+
+/*!
+* @brief Weights of the evaluations for the weighted L2 loss: inverse of the variance of each evaluation along the fts
+* @param X fts (matrix: m x n)
+* @return the weights (0 for evaluations with null variance)
+* @details Missing evaluations are not taken into account
+*/
+inline
+KO_Traits::StoringVector
+inverse_pointwise_variance(const KO_Traits::StoringMatrix &X)
+{
+  const auto available = (X.array() == X.array());
+  const KO_Traits::StoringArray counts = available.rowwise().count().template cast<double>().max(1.0);
+  const KO_Traits::StoringArray means = available.select(X.array(),0.0).rowwise().sum() / counts;
+  const KO_Traits::StoringArray var = available.select((X.array().colwise() - means).square(),0.0).rowwise().sum() / counts;
+  
+  return (var > 0.0).select(var.inverse(),0.0).matrix();
 };
 
 #endif /*CV_EVAL_VALID_ERR_HPP*/
\ No newline at end of file
@@ -0,0 +1,287 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_CV_SHARD_HPP
+#define KO_CV_SHARD_HPP
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+#include <chrono>
+
+#include "threading_policy.hpp"
+#include "ko_log.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define KO_CV_SHARD_FORK
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+/*!
+* @file cv_shard.hpp
+* @brief Contains the evaluation of the cells of a cv grid sharded across local worker processes
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!Seconds a worker process can go without sending a result before being considered hung: it is killed, and the cells it did not send are 
+   evaluated by the calling process (can be set at compile time)*/
+#ifndef KO_CV_SHARD_TIMEOUT_SECS
+#define KO_CV_SHARD_TIMEOUT_SECS 600.0
+#endif
+
+
+/*!
+* @struct shard_result
+* @brief Result of a cell, as sent by a worker through its pipe
+*/
+struct shard_result
+{
+  /*!Index of the cell*/
+  std::uint64_t cell;
+  /*!Validation error of the cell*/
+  double err;
+};
+
+
+#ifdef KO_CV_SHARD_FORK
+
+/*!
+* @brief Pinning the calling worker to its block of the cores available to the process (Linux only): contiguous cores, that usually share the NUMA node
+* @param worker index of the worker
+* @param number_processes number of workers
+*/
+inline
+void
+pin_worker(int worker, int number_processes)
+{
+#ifdef __linux__
+  cpu_set_t available;
+  CPU_ZERO(&available);
+  if(sched_getaffinity(0,sizeof(cpu_set_t),&available) != 0){  return;}
+  
+  std::vector<int> cores;
+  for(int c = 0; c < CPU_SETSIZE; ++c){  if(CPU_ISSET(c,&available)){  cores.emplace_back(c);}}
+  const std::size_t first = cores.size()*worker/number_processes;
+  const std::size_t last  = cores.size()*(worker + 1)/number_processes;
+  if(first == last){  return;}
+  
+  cpu_set_t block;
+  CPU_ZERO(&block);
+  for(std::size_t c = first; c < last; ++c){  CPU_SET(cores[c],&block);}
+  sched_setaffinity(0,sizeof(cpu_set_t),&block);
+#endif
+}
+
+
+/*!
+* @brief Writing a buffer on a file descriptor, resuming after partial writes and signals
+* @return true if everything has been written
+*/
+inline
+bool
+write_all(int fd, const void *buffer, std::size_t size)
+{
+  const char *data = static_cast<const char*>(buffer);
+  while(size > 0)
+  {
+    const ssize_t written = write(fd,data,size);
+    if(written < 0)
+    {
+      if(errno == EINTR){  continue;}
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+#endif
+
+
+/*!
+* @brief Evaluating the cells of a cv grid sharded across local worker processes
+* @param tot_cells number of cells
+* @param number_processes number of worker processes
+* @param eval function evaluating the cell of a given index (it must not call the R API)
+* @return the validation error of each cell
+* @details The workers are forked: the data are shared read-only (copy-on-write) with the calling process, without being copied. Worker w evaluates
+*          the cells w, w + number_processes, ..., and sends the results back through a pipe, as soon as they are evaluated. Each worker is 
+*          single-threaded (serial loops, single-threaded kernels: the threads of the calling process are not forked with it, and neither the OMP 
+*          runtime nor the pool is used), and is pinned to its own block of cores (Linux only). The lock the workers take (registry of the fold
+*          workspaces) is held by the forking thread across the fork (see 'fold_workspaces()'). The results are gathered through 'poll': a worker
+*          sending nothing for KO_CV_SHARD_TIMEOUT_SECS seconds is killed. The cells whose result did not arrive (worker that could not be forked, 
+*          died or hung) are evaluated by the calling process. Without fork (Windows), or if called from within a parallel loop (other threads of
+*          the process may be running fits), all the cells are evaluated by the calling process
+*/
+template<typename EVAL>
+std::vector<double>
+sharded_evaluation(std::size_t tot_cells, int number_processes, EVAL &&eval)
+{
+  std::vector<double> errors(tot_cells,std::numeric_limits<double>::quiet_NaN());
+  std::vector<char> received(tot_cells,0);
+  
+#ifdef KO_CV_SHARD_FORK
+  if(KO_Parallel::in_parallel())
+  {
+    KO_Log::message("Sharded cv: called within a parallel loop, the cells are evaluated in process");
+    number_processes = 0;
+  }
+  
+  //no output duplicated by the workers
+  std::cout << std::flush;
+  std::cerr << std::flush;
+  
+  std::vector<pid_t> workers(number_processes,-1);
+  std::vector<int> pipes(number_processes,-1);
+  
+  for(int w = 0; w < number_processes; ++w)
+  {
+    int fd[2];
+    if(pipe(fd) != 0){  continue;}
+    
+    const pid_t pid = fork();
+    if(pid == 0)
+    {
+      //worker: evaluates its shard, sending each result, and exits without returning to the caller
+      serial_forked_process();
+      close(fd[0]);
+      for(int other = 0; other < w; ++other){  if(pipes[other] >= 0){  close(pipes[other]);}}
+      pin_worker(w,number_processes);
+      int status = 0;
+      try
+      {
+        for(std::size_t cell = w; cell < tot_cells; cell += number_processes)
+        {
+          shard_result result{cell,eval(cell)};
+          if(!write_all(fd[1],&result,sizeof(shard_result))){  status = 1; break;}
+        }
+      }
+      catch(...)
+      {
+        status = 1;
+      }
+      close(fd[1]);
+      _exit(status);
+    }
+    
+    close(fd[1]);
+    if(pid < 0){  close(fd[0]); continue;}
+    workers[w] = pid;
+    pipes[w] = fd[0];
+  }
+  
+  //closing the pipe of a worker and reaping it (killed if hung)
+  auto stop_worker = [&workers,&pipes](int w, bool hung)
+                     {
+                       if(hung){  kill(workers[w],SIGKILL);}
+                       close(pipes[w]);
+                       pipes[w] = -1;
+                       int status;
+                       while(waitpid(workers[w],&status,0) < 0 && errno == EINTR){}
+                     };
+  
+  //gathering the results, as they arrive from any worker
+  using clock = std::chrono::steady_clock;
+  const auto timeout = std::chrono::duration<double>(KO_CV_SHARD_TIMEOUT_SECS);
+  std::vector<shard_result> results(number_processes);
+  std::vector<std::size_t> filled(number_processes,0);
+  std::vector<clock::time_point> last_result(number_processes,clock::now());
+  std::vector<pollfd> fds;
+  std::vector<int> owners;
+  
+  while(true)
+  {
+    fds.clear();
+    owners.clear();
+    for(int w = 0; w < number_processes; ++w)
+    {
+      if(pipes[w] >= 0){  fds.push_back(pollfd{pipes[w],POLLIN,0}); owners.emplace_back(w);}
+    }
+    if(fds.empty()){  break;}
+    
+    //waking up at least once per second, to check the workers for hangs
+    if(poll(fds.data(),fds.size(),1000) < 0)
+    {
+      if(errno == EINTR){  continue;}
+      for(int w : owners){  stop_worker(w,true);}
+      break;
+    }
+    
+    const auto now = clock::now();
+    for(std::size_t i = 0; i < fds.size(); ++i)
+    {
+      const int w = owners[i];
+      if(fds[i].revents == 0)
+      {
+        if(now - last_result[w] > timeout)
+        {
+          KO_Log::message("Sharded cv: worker process ",w," sent no result for ",KO_CV_SHARD_TIMEOUT_SECS," seconds, killed: its cells are evaluated in process");
+          stop_worker(w,true);
+        }
+        continue;
+      }
+      
+      const ssize_t got = read(pipes[w],reinterpret_cast<char*>(&results[w]) + filled[w],sizeof(shard_result) - filled[w]);
+      if(got < 0 && errno == EINTR){  continue;}
+      if(got <= 0)
+      {
+        stop_worker(w,false);
+        continue;
+      }
+      filled[w] += got;
+      if(filled[w] == sizeof(shard_result))
+      {
+        if(results[w].cell < tot_cells)
+        {
+          errors[results[w].cell] = results[w].err;
+          received[results[w].cell] = 1;
+        }
+        filled[w] = 0;
+        last_result[w] = now;
+      }
+    }
+  }
+#endif
+  
+  //cells not evaluated by the workers
+  for(std::size_t cell = 0; cell < tot_cells; ++cell)
+  {
+    if(!received[cell]){  errors[cell] = eval(cell);}
+  }
+  
+  return errors;
+}
+
+
+#endif  //KO_CV_SHARD_HPP
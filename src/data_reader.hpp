@@ -32,6 +32,7 @@
 
 #include "traits_ko.hpp"
 #include "removing_nan.hpp"
+#include "removing_nan_cleaner_imp.hpp"
 #include "parameters_wrapper.hpp"
 
 
@@ -112,6 +113,7 @@ reader_data(Rcpp::NumericMatrix X,
       data_clean.remove_nan();
       return std::make_pair(data_clean.data(),rows_retained);
     }
+    //if 'REM_NAN::PC': nans are kept, and handled through pairwise-complete moments
   }
   
   return std::make_pair(x,rows_retained);
@@ -0,0 +1,51 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_EXPLANATORY_POWER_HPP
+#define KO_EXPLANATORY_POWER_HPP
+
+#include "traits_ko.hpp"
+
+
+/*!
+* @file explanatory_power.hpp
+* @brief Contains the retention of the PPCs through the explanatory power criterion
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!
+* @brief Number of leading eigenvalues whose cumulative explanatory power reaches the requested one
+* @param eigvals eigenvalues, in decreasing order
+* @param tot_exp_pow total explanatory power (sum of all the eigenvalues)
+* @param threshold_ppc requested explanatory power
+* @return the number of eigenvalues (all of them if the requested explanatory power is not reached)
+*/
+inline
+int
+ppcs_reaching_threshold(const KO_Traits::StoringVector &eigvals, double tot_exp_pow, double threshold_ppc)
+{
+  double cum_exp_pow = 0.0;
+  int n_ppcs = 0;
+  while(n_ppcs < eigvals.size() && cum_exp_pow/tot_exp_pow < threshold_ppc){  cum_exp_pow += eigvals(n_ppcs++);}
+  
+  return n_ppcs;
+}
+
+#endif  //KO_EXPLANATORY_POWER_HPP
@@ -0,0 +1,329 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_FOLD_WORKSPACE_HPP
+#define KO_FOLD_WORKSPACE_HPP
+
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <vector>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define KO_FOLD_WORKSPACE_ATFORK
+#include <pthread.h>
+#endif
+
+#include "traits_ko.hpp"
+
+
+/*!
+* @file fold_workspace.hpp
+* @brief Contains the per-thread workspace in which the fits on the cv folds ('SOLVER::ex_solver') are performed without heap allocations
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!Largest number of discrete evaluations for which the fits on the cv folds are performed inside the per-thread workspace (can be set at compile time)*/
+#ifndef KO_FOLD_WORKSPACE_MAX_SIZE
+#define KO_FOLD_WORKSPACE_MAX_SIZE 500
+#endif
+
+/*!
+* @class fold_workspace
+* @brief Preallocated buffers for the PPCKO fit ('SOLVER::ex_solver') on a training set and the prediction of the next instant
+* @details The buffers are sized at the first fit on a given grid, and grown only for longer training sets: once the longest fold has been seen,
+*          a fit does not touch the heap. Same estimates of 'PPC_KO_NoCV', with the PPCs found by Eigen dense eigensolver running in preallocated objects
+*          instead of 'Spectra' (both converged to machine precision):
+*          - phi = L^(-1)*CrossCov'*CrossCov*L^(-T) is reduced to a tridiagonal matrix by 'Eigen::Tridiagonalization'
+*          - eigenvalues and eigenvectors of the tridiagonal matrix are computed by 'Eigen::SelfAdjointEigenSolver' (the number of PPCs, if not imposed,
+*            is selected with the same explanatory power criterion)
+*          - the retained eigenvectors are mapped back through the Householder reflections of the tridiagonalization
+*          The prediction is rho*x_n = CrossCov*b*(b'*x_n): rho is never assembled.
+*          The buffers take about 9*m*m doubles (plus m times the longest training set), up to KO_FOLD_WORKSPACE_MAX_SIZE evaluations: they are 
+*          kept between the cv folds, and released by 'release()' (see 'release_fold_workspaces()')
+* @note Eigen packing buffers of the matrix products are taken from the stack up to EIGEN_STACK_ALLOCATION_LIMIT bytes: on large grids the products may still allocate
+*/
+class fold_workspace
+{
+private:
+
+  /*!Number of discrete evaluations the buffers are sized for*/
+  Eigen::Index m_m = 0;
+  /*!Centered training set (matrix: m x longest training set)*/
+  KO_Traits::StoringMatrix m_X;
+  /*!Mean function and prediction (vectors: m)*/
+  KO_Traits::StoringVector m_means, m_pred;
+  /*!Regularized covariance (lower part), cross-covariance and L^(-1)*CrossCov' (matrices: m x m)*/
+  KO_Traits::StoringMatrix m_CovReg, m_CrossCov, m_W;
+  /*!Phi (lower part)*/
+  KO_Traits::StoringMatrix m_phi;
+  /*!Cholesky factorization of the regularized covariance*/
+  Eigen::LLT<KO_Traits::StoringMatrix> m_CovRegChol;
+  /*!
+  * @struct tridiagonalization
+  * @brief 'Eigen::Tridiagonalization' giving access to its Householder coefficients by reference ('householderCoefficients()' returns a copy)
+  */
+  struct tridiagonalization : public Eigen::Tridiagonalization<KO_Traits::StoringMatrix>
+  {
+    using Eigen::Tridiagonalization<KO_Traits::StoringMatrix>::Tridiagonalization;
+    inline const CoeffVectorType & hcoeffs() const {return m_hCoeffs;};
+  };
+  
+  /*!Tridiagonal form of phi, with its Householder reflections*/
+  tridiagonalization m_tridiag;
+  /*!Eigenvalues and eigenvectors of the tridiagonal form*/
+  Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> m_eig;
+  /*!Diagonal and subdiagonal of the tridiagonal form*/
+  KO_Traits::StoringVector m_diag, m_subdiag;
+  /*!Eigenvectors of phi and weights (b_i) (matrices: m x m, only the first k columns are used)*/
+  KO_Traits::StoringMatrix m_V, m_b;
+  /*!Scores of the last instant and scratch for the reflections (vectors: m)*/
+  KO_Traits::StoringVector m_z, m_tmp;
+  /*!Number of retained PPCs of the last fit*/
+  int m_k = 0;
+
+
+  /*!
+  * @brief Sizing the buffers for m discrete evaluations and training sets of n instants
+  */
+  void
+  reserve(Eigen::Index m, Eigen::Index n)
+  {
+    if(m != m_m)
+    {
+      m_m = m;
+      m_X.resize(m,n);
+      m_means.resize(m);
+      m_pred.resize(m);
+      m_CovReg.resize(m,m);
+      m_CrossCov.resize(m,m);
+      m_W.resize(m,m);
+      m_phi.resize(m,m);
+      m_tridiag = tridiagonalization(m);
+      m_eig = Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix>(m);
+      m_diag.resize(m);
+      m_subdiag.resize(m-1);
+      m_V.resize(m,m);
+      m_b.resize(m,m);
+      m_z.resize(m);
+      m_tmp.resize(m);
+    }
+    //longer training set: the buffer grows (the folds are at most as long as the whole fts)
+    if(n > m_X.cols())
+    {
+      m_X.resize(m,n);
+    }
+  }
+
+
+public:
+
+  /*!
+  * @brief Default constructor: buffers are sized at the first fit
+  */
+  fold_workspace() = default;
+
+  /*!
+  * @brief PPCKO fit on a training set, and prediction of its next instant
+  * @param X training set (not centered, without missing evaluations) (matrix: m x n, n >= 2)
+  * @param alpha regularization parameter
+  * @param k number of retained PPCs (if positive), or 0 to retain them through the explanatory power criterion
+  * @param threshold_ppc requested explanatory power of the retained PPCs (used only if k is 0)
+  * @return the prediction of the instant following the training set (valid until the next fit)
+  */
+  const KO_Traits::StoringVector &
+  fit_predict(const Eigen::Ref<const KO_Traits::StoringMatrix> &X, double alpha, int k, double threshold_ppc = 1.0)
+  {
+    const Eigen::Index m = X.rows();
+    const Eigen::Index n = X.cols();
+    this->reserve(m,n);
+    auto Xc = m_X.leftCols(n);
+
+    //mean function and centering
+    m_means.noalias() = X.rowwise().sum()/static_cast<double>(n);
+    Xc = X.colwise() - m_means;
+
+    //covariance (lower part), regularized, and cross-covariance
+    m_CovReg.setZero();
+    m_CovReg.selfadjointView<Eigen::Lower>().rankUpdate(Xc,1.0/static_cast<double>(n));
+    m_CovReg.diagonal().array() += alpha*m_CovReg.trace();
+    m_CrossCov.noalias() = (1.0/static_cast<double>(n-1))*Xc.rightCols(n-1)*Xc.leftCols(n-1).transpose();
+
+    //whitening: phi = W*W', W = L^(-1)*CrossCov', with Cov_reg = LL'. Its trace is the total explanatory power
+    m_CovRegChol.compute(m_CovReg);
+    m_W = m_CrossCov.transpose();
+    m_CovRegChol.matrixL().solveInPlace(m_W);
+    const double tot_exp_pow = m_W.squaredNorm();
+    m_phi.setZero();
+    m_phi.selfadjointView<Eigen::Lower>().rankUpdate(m_W);
+
+    //eigenpairs of phi (in increasing order), from its tridiagonal form
+    m_tridiag.compute(m_phi);
+    m_diag = m_tridiag.diagonal();
+    m_subdiag = m_tridiag.subDiagonal();
+    m_eig.computeFromTridiagonal(m_diag,m_subdiag,Eigen::ComputeEigenvectors);
+    const auto &eigenvalues = m_eig.eigenvalues();
+
+    //number of PPCs: imposed, or the smallest one reaching the requested explanatory power
+    if(k > 0)
+    {
+      m_k = k;
+    }
+    else
+    {
+      double exp_pow = 0.0;
+      for(m_k = 1; ; ++m_k)
+      {
+        exp_pow += eigenvalues(m-m_k);
+        if(exp_pow/tot_exp_pow >= threshold_ppc || m_k >= m-1){  break;}
+      }
+    }
+
+    //retained eigenvectors of phi, in decreasing order of the eigenvalues: reflections applied back, V = Q*V_T
+    auto V = m_V.leftCols(m_k);
+    for(Eigen::Index j = 0; j < m_k; ++j){  V.col(j) = m_eig.eigenvectors().col(m-1-j);}
+    for(Eigen::Index i = m-2; i >= 0; --i)
+    {
+      V.bottomRows(m-1-i).applyHouseholderOnTheLeft(m_tridiag.packedMatrix().col(i).tail(m-2-i),m_tridiag.hcoeffs()(i),m_tmp.data());
+    }
+
+    //weights: whitening undone, b = L^(-T)*V
+    auto b = m_b.leftCols(m_k);
+    b = V;
+    m_CovRegChol.matrixU().solveInPlace(b);
+
+    //prediction: rho*x_n = CrossCov*b*(b'*x_n), plus the mean function
+    auto z = m_z.head(m_k);
+    z.noalias() = b.transpose()*Xc.col(n-1);
+    m_tmp.noalias() = b*z;
+    m_pred = m_means;
+    m_pred.noalias() += m_CrossCov*m_tmp;
+
+    return m_pred;
+  }
+
+  /*!
+  * @brief Getter for the number of retained PPCs in the last fit
+  * @return the private m_k
+  */
+  inline int k() const {return m_k;};
+
+  /*!
+  * @brief Releasing the buffers: they are sized again at the next fit
+  */
+  void release() { *this = fold_workspace();};
+};
+
+
+/*!
+* @class fold_workspaces_registry
+* @brief Workspaces of the threads that performed a fit, so that their buffers can be released from the calling thread
+*/
+class fold_workspaces_registry
+{
+private:
+
+  /*!Workspaces of the living threads*/
+  std::vector<fold_workspace*> m_workspaces;
+  /*!Mutex for registrations from different threads*/
+  std::mutex m_mutex;
+
+public:
+
+  /*!
+  * @brief Adding the workspace of a thread
+  */
+  void add(fold_workspace *workspace) { std::lock_guard<std::mutex> lock(m_mutex); m_workspaces.emplace_back(workspace);};
+
+  /*!
+  * @brief Removing the workspace of a thread, when it exits
+  */
+  void remove(fold_workspace *workspace) { std::lock_guard<std::mutex> lock(m_mutex); std::erase(m_workspaces,workspace);};
+
+  /*!
+  * @brief Releasing the buffers of all the workspaces
+  * @details No fit has to be running, in any thread: called outside the outermost parallel region
+  */
+  void release() { std::lock_guard<std::mutex> lock(m_mutex); for(auto workspace : m_workspaces){  workspace->release();}};
+  
+  /*!
+  * @brief Locking and unlocking the registry around a fork
+  */
+  void lock()   { m_mutex.lock();};
+  void unlock() { m_mutex.unlock();};
+};
+
+
+/*!
+* @brief Registry of the workspaces of the process
+* @details The registry is locked by the forking thread across a fork: no other thread holds it at the fork, and a forked process (e.g. a worker of
+*          a sharded cv) can register its own workspace
+*/
+inline
+fold_workspaces_registry &
+fold_workspaces()
+{
+  static fold_workspaces_registry registry;
+#ifdef KO_FOLD_WORKSPACE_ATFORK
+  static const int fork_handlers = pthread_atfork([](){ fold_workspaces().lock();},[](){ fold_workspaces().unlock();},[](){ fold_workspaces().unlock();});
+  (void)fork_handlers;
+#endif
+  return registry;
+}
+
+
+/*!
+* @struct registered_fold_workspace
+* @brief Workspace of a thread, registered for its lifetime
+*/
+struct registered_fold_workspace
+{
+  fold_workspace workspace;
+  registered_fold_workspace()  { fold_workspaces().add(&workspace);}
+  ~registered_fold_workspace() { fold_workspaces().remove(&workspace);}
+};
+
+
+/*!
+* @brief Workspace of the calling thread, alive until the thread exits (its buffers are released by 'release_fold_workspaces()')
+* @return a reference to the workspace
+*/
+inline
+fold_workspace &
+thread_fold_workspace()
+{
+  thread_local registered_fold_workspace registered;
+  return registered.workspace;
+}
+
+
+/*!
+* @brief Releasing the buffers of the workspaces of all the threads
+* @details Called once the outermost fit is over (end of 'solve_ko', of 'KO_Factory::KO_solver_batch'), never from within a cv: 
+*          the fits of a batch run concurrently, each one in its own thread workspace
+*/
+inline
+void
+release_fold_workspaces()
+{
+  fold_workspaces().release();
+}
+
+#endif  //KO_FOLD_WORKSPACE_HPP
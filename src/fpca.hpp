@@ -0,0 +1,101 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_FPCA_HPP
+#define KO_FPCA_HPP
+
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+#include <Eigen/Core>
+#include "spectra/include/Spectra/MatOp/DenseSymMatProd.h"
+#include "spectra/include/Spectra/SymEigsSolver.h"
+
+#include "traits_ko.hpp"
+
+
+/*!
+* @file fpca.hpp
+* @brief Contains the functional principal components pre-projection: PPCKO (and its cv) is performed on the scores along the leading p FPCs instead of on the m discrete evaluations
+* @author Andrea Enrico Franzoni
+* @details The FPCs are orthonormal: analysis (m -> p) is V_p', synthesis (p -> m) is V_p, and the euclidean geometry is preserved on their span
+*/
+
+
+/*!
+* @brief Leading functional principal components of the fts, retained through explained variance
+* @param X fts (matrix: m x n, not centered)
+* @param threshold_fpca requested proportion of explained variance
+* @return a pair containing the analysis operator V_p' (p x m) and the synthesis operator V_p (m x p)
+* @details The sample covariance is computed once; its leading eigenpairs are computed with 'Spectra', doubling their number until the requested 
+*          explained variance is reached. p is the smallest number of FPCs reaching it
+* @note the FPCs are estimated on the whole fts, before the cv: the validation instants of the cv folds enter the projection the folds are scored on
+* @note missing evaluations cannot be projected: throws if the fts contains NaNs
+*/
+inline
+std::pair<KO_Traits::StoringMatrix,KO_Traits::StoringMatrix>
+fpca_coordinates(const KO_Traits::StoringMatrix &X, double threshold_fpca)
+{
+  const int m = X.rows();
+  
+  if(X.hasNaN())
+  {
+    std::string error_message = "Functional principal components cannot be estimated with missing evaluations: impute them";
+    throw std::invalid_argument(error_message);
+  }
+  
+  //sample covariance
+  KO_Traits::StoringMatrix X_cent = X.colwise() - X.rowwise().mean();
+  KO_Traits::StoringMatrix Cov = (X_cent*X_cent.transpose())/static_cast<double>(X.cols());
+  X_cent.resize(0,0);
+  const double tot_var = Cov.trace();
+  
+  //less than 3 discrete evaluations: too few for 'Spectra', the fts is kept as it is (identity analysis and synthesis)
+  if(m < 3){  KO_Traits::StoringMatrix Id = KO_Traits::StoringMatrix::Identity(m,m); return std::make_pair(Id,Id);}
+  
+  Spectra::DenseSymMatProd<double> op(Cov);
+  
+  KO_Traits::StoringVector eigvals;
+  KO_Traits::StoringMatrix eigvecs;
+  
+  for(int nev = std::min(8,m-1); ; nev = std::min(2*nev,m-1))
+  {
+    Spectra::SymEigsSolver<Spectra::DenseSymMatProd<double>> eigsolver_cov(op, nev, std::min(2*nev+1,m));
+    eigsolver_cov.init();
+    eigsolver_cov.compute(Spectra::SortRule::LargestAlge);
+    eigvals = eigsolver_cov.eigenvalues();
+    eigvecs = eigsolver_cov.eigenvectors();
+    
+    if(eigvals.sum() >= threshold_fpca*tot_var || nev == m-1){  break;}
+  }
+  
+  //smallest number of FPCs reaching the requested explained variance
+  int p = 1;
+  double cum_var = eigvals(0);
+  while(p < eigvals.size() && cum_var < threshold_fpca*tot_var){  cum_var += eigvals(p); ++p;}
+  
+  KO_Traits::StoringMatrix V_p = eigvecs.leftCols(p);
+  
+  return std::make_pair(KO_Traits::StoringMatrix(V_p.transpose()),V_p);
+}
+
+#endif  /*KO_FPCA_HPP*/
@@ -0,0 +1,108 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_LOG_HPP
+#define KO_LOG_HPP
+
+#include <string>
+#include <sstream>
+#include <functional>
+#include <utility>
+
+#include "parallel_backend.hpp"
+
+
+/*!
+* @file ko_log.hpp
+* @brief Contains the hook through which the library reports its progress: silent by default
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!
+* @namespace KO_Log
+* @brief Messages of the library (cv progress, searches summaries): they are passed to a sink, set by the caller (e.g. the R interface, that prints 
+*        them on the R console). Without a sink, they are discarded
+*/
+namespace KO_Log
+{
+
+/*!Type of the sink: takes a message (a line, without end of line)*/
+using sink_t = std::function<void(const std::string &)>;
+
+
+/*!
+* @brief Sink of the process (empty: messages discarded)
+*/
+inline
+sink_t &
+sink()
+{
+  static sink_t s;
+  return s;
+}
+
+
+/*!
+* @brief Reporting a message, built streaming the arguments
+* @details Only the main thread reports: the sink (e.g. the R console) has not to be thread-safe
+*/
+template<typename... ARGS>
+void
+message(ARGS&&... args)
+{
+  if(!sink() || !KO_Parallel::main_thread()){  return;}
+  
+  std::ostringstream msg;
+  (msg << ... << std::forward<ARGS>(args));
+  sink()(msg.str());
+}
+
+
+/*!
+* @class scoped_sink
+* @brief RAII setter of the sink: the previous one is restored on destruction
+*/
+class scoped_sink
+{
+private:
+  
+  /*!Sink before the construction*/
+  sink_t m_previous;
+  
+public:
+  
+  /*!
+  * @brief Constructor: setting the sink
+  * @param s the sink
+  */
+  explicit scoped_sink(sink_t s) : m_previous(std::move(sink())) {  sink() = std::move(s);}
+  
+  scoped_sink(const scoped_sink&) = delete;
+  scoped_sink & operator=(const scoped_sink&) = delete;
+  
+  /*!
+  * @brief Destructor: restoring the previous sink
+  */
+  ~scoped_sink() {  sink() = std::move(m_previous);}
+};
+
+}   //end namespace KO_Log
+
+#endif  //KO_LOG_HPP
@@ -48,4 +48,18 @@ Uniform::operator()() const
   
 }
 
+MeshNodes
+GivenNodes::operator()() const
+{
+  auto const &a = this->M_domain.left();
+  auto const &b = this->M_domain.right();
+  if(this->M_nodes.size() < 2)
+    throw std::runtime_error("At least two nodes");
+  if(!std::is_sorted(this->M_nodes.cbegin(),this->M_nodes.cend()))
+    throw std::runtime_error("Nodes have to be sorted");
+  if(this->M_nodes.front() < a || this->M_nodes.back() > b)
+    throw std::runtime_error("Nodes have to be inside the domain");
+  return this->M_nodes;
+}
+
 } // namespace Geometry
@@ -73,6 +73,26 @@ public:
 private:
   std::size_t M_num_elements;
 };
+//! Mesh on given nodes (e.g. the points in which the functional data are evaluated)
+class GivenNodes : public OneDMeshGenerator
+{
+public:
+  /*! constructor
+@param domain A 1D domain
+@param nodes the nodes of the mesh, sorted and inside the domain
+  */
+  GivenNodes(Geometry::Domain1D const &domain, MeshNodes const &nodes)
+    : OneDMeshGenerator(domain), M_nodes(nodes)
+  {}
+  //! Call operator
+  /*!
+    @param meshNodes a mesh of nodes
+  */
+  MeshNodes operator()() const override;
+
+private:
+  MeshNodes M_nodes;
+};
 /*! @}*/
 } // namespace Geometry
 #endif
@@ -0,0 +1,90 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_MULTIRES_CV_HPP
+#define KO_MULTIRES_CV_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include "traits_ko.hpp"
+
+
+/*!
+* @file multires_cv.hpp
+* @brief Contains the tools for the coarse-to-fine cv: hyperparameters are firstly selected on a downsampled grid, and then refined
+*        on the full grid within a narrow neighbourhood of the coarse optimum
+* @author Andrea Enrico Franzoni
+* @details Alpha is relative to the trace of the covariance: its scale does not depend on the grid resolution
+*/
+
+
+/*!
+* @brief Rows of the fts, among the retained ones, that lie on the coarse grid: every 'step'-th point along each dimension
+* @param rows_retained rows of the original grid retained for the computations (if empty: all of them)
+* @param m_tot total number of points of the original grid
+* @param d1 number of points along dimension 1 (for curves: 'm_tot')
+* @param step downsampling step
+* @return the positions, with respect to the fts, of the rows on the coarse grid (empty if no downsampling)
+* @details The surface is flattened column-wise (index: i1 + i2*d1)
+*/
+inline
+std::vector<int>
+coarse_rows(const std::vector<int> &rows_retained, int m_tot, int d1, int step)
+{
+  std::vector<int> rows_coarse;
+  if(step <= 1){  return rows_coarse;}
+  
+  const int m = rows_retained.empty() ? m_tot : rows_retained.size();
+  rows_coarse.reserve(m/step + 1);
+  
+  for(int i = 0; i < m; ++i)
+  {
+    const int i_grid = rows_retained.empty() ? i : rows_retained[i];
+    if((i_grid % d1) % step == 0 && (i_grid / d1) % step == 0){  rows_coarse.emplace_back(i);}
+  }
+  
+  return rows_coarse;
+}
+
+
+/*!
+* @brief Neighbourhood of the coarse optimum within the (ascending) input space of a parameter
+* @tparam T type of the parameter
+* @param params input space, in ascending order
+* @param param_best coarse optimum
+* @param width number of candidates retained on each side of the coarse optimum
+* @return the candidates within 'width' positions from the coarse optimum
+*/
+template<typename T>
+std::vector<T>
+refined_space(const std::vector<T> &params, T param_best, int width)
+{
+  auto it_best = std::lower_bound(params.cbegin(),params.cend(),param_best);
+  const int pos = std::distance(params.cbegin(),it_best);
+  
+  const int first = std::max(0,pos - width);
+  const int last  = std::min(static_cast<int>(params.size()),pos + width + 1);
+  
+  return std::vector<T>(params.cbegin() + first,params.cbegin() + last);
+}
+
+#endif  /*KO_MULTIRES_CV_HPP*/
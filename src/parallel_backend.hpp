@@ -0,0 +1,374 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_PARALLEL_BACKEND_HPP
+#define KO_PARALLEL_BACKEND_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "traits_ko.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/*!
+* @file parallel_backend.hpp
+* @brief Contains the backend running the parallel loops of PPCKO: OMP, std::execution::par, a built-in thread pool, or serial
+* @author Andrea Enrico Franzoni
+*/
+
+
+//available backends
+#define KO_PAR_SERIAL 0
+#define KO_PAR_OMP    1
+#define KO_PAR_STD    2
+#define KO_PAR_POOL   3
+
+/*!Backend of the parallel loops (can be set at compile time, e.g. -DKO_PAR_BACKEND=KO_PAR_STD): OMP if compiling with it, the built-in thread pool if not*/
+#ifndef KO_PAR_BACKEND
+#ifdef _OPENMP
+#define KO_PAR_BACKEND KO_PAR_OMP
+#else
+#define KO_PAR_BACKEND KO_PAR_POOL
+#endif
+#endif
+
+#if KO_PAR_BACKEND == KO_PAR_OMP && !defined(_OPENMP)
+#error "KO_PAR_OMP backend requires compiling with OpenMP"
+#endif
+
+#if KO_PAR_BACKEND == KO_PAR_STD
+#include <execution>
+#endif
+
+
+/*!
+* @namespace KO_Parallel
+* @brief Parallel loops over the iterations [0,n): all the parallel loops of PPCKO go through here, so that every build configuration is multi-threaded
+* @details A loop started inside the body of another one is run serially by the calling thread (no nested parallelism). As within an OMP region,
+*          the body must not throw: exceptions have to be handled inside it
+*/
+namespace KO_Parallel
+{
+
+//thread-level state for the non-OMP backends: depth of loop bodies being run, and if the thread started the outermost parallel loop
+inline thread_local int  tl_depth  = 0;
+inline thread_local bool tl_issuer = false;
+
+//process-level state: if the process has to run every loop serially (forked worker)
+inline bool serial_process = false;
+
+
+/*!
+* @brief RAII marker of a loop body being run by the thread
+*/
+struct body_scope
+{
+  body_scope()  { ++tl_depth;}
+  ~body_scope() { --tl_depth;}
+};
+
+
+/*!
+* @class thread_pool
+* @brief Workers kept alive between loops, joining the calling thread in running one loop at a time
+* @details The workers are spawned lazily, up to the number of helpers requested so far. They do not survive a fork: forked processes have to run
+*          single-threaded loops (see 'run_serial_process()')
+*/
+class thread_pool
+{
+private:
+
+  /*!Workers*/
+  std::vector<std::thread> m_workers;
+  /*!Synchronization of the workers with the calling thread*/
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  /*!One loop at a time*/
+  std::mutex m_run;
+  /*!Work of the current loop*/
+  const std::function<void()>* m_work = nullptr;
+  /*!Index of the current loop*/
+  std::size_t m_generation = 0;
+  /*!Helpers that can still join the current loop, and helpers running it*/
+  int m_slots   = 0;
+  int m_running = 0;
+  /*!If the workers have to terminate*/
+  bool m_stop = false;
+
+  /*!
+  * @brief Loop of a worker: waiting for a loop to join, running its work
+  */
+  void
+  worker_loop()
+  {
+    std::size_t seen = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for(;;)
+    {
+      m_wake.wait(lock,[this,&seen](){return m_stop || (m_generation != seen && m_slots > 0);});
+      if(m_stop){  return;}
+
+      seen = m_generation;
+      --m_slots;
+      ++m_running;
+      const std::function<void()>* work = m_work;
+      lock.unlock();
+      (*work)();
+      lock.lock();
+      if(--m_running == 0){  m_done.notify_all();}
+    }
+  }
+
+public:
+
+  thread_pool() = default;
+  thread_pool(const thread_pool&) = delete;
+  thread_pool & operator=(const thread_pool&) = delete;
+
+  /*!
+  * @brief Destructor: terminating the workers
+  */
+  ~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for(auto &worker : m_workers){  worker.join();}
+  }
+
+  /*!
+  * @brief Running a work with the calling thread and up to 'helpers' workers
+  * @param helpers number of workers joining the calling thread
+  * @param work work to be run by each thread: it has to share the iterations through an atomic counter, returning when there are no more
+  * @details When the calling thread returns from its work, all the iterations have been taken: the slots not yet joined are dropped, and
+  *          the workers still running are waited for
+  */
+  void
+  run(int helpers, const std::function<void()> &work)
+  {
+    std::lock_guard<std::mutex> run_lock(m_run);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(m_workers.size() < static_cast<std::size_t>(helpers)){  m_workers.emplace_back([this](){ this->worker_loop();});}
+    m_work  = &work;
+    m_slots = helpers;
+    ++m_generation;
+    lock.unlock();
+    m_wake.notify_all();
+
+    work();
+
+    lock.lock();
+    m_slots = 0;
+    m_done.wait(lock,[this](){return m_running == 0;});
+    m_work = nullptr;
+  }
+};
+
+
+/*!
+* @brief Pool shared by all the loops of the process
+*/
+inline
+thread_pool &
+global_thread_pool()
+{
+  static thread_pool pool;
+  return pool;
+}
+
+
+/*!
+* @brief Making the calling process run every loop serially, without starting OMP teams nor using the pool: to be called by a forked process
+* @details Neither the threads of the OMP runtime nor the ones of the pool exist in a forked process, while their locks could have been
+*          held by them at the fork: a parallel loop there could deadlock
+*/
+inline
+void
+run_serial_process()
+{
+  serial_process = true;
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+}
+
+
+/*!
+* @brief Name of the backend
+*/
+inline
+std::string
+backend_name()
+{
+#if KO_PAR_BACKEND == KO_PAR_OMP
+  return "OpenMP";
+#elif KO_PAR_BACKEND == KO_PAR_STD
+  return "std::execution";
+#elif KO_PAR_BACKEND == KO_PAR_POOL
+  return "thread pool";
+#else
+  return "serial";
+#endif
+}
+
+
+/*!
+* @brief Maximum number of threads: the cores of the machine (1 for the serial backend)
+*/
+inline
+int
+max_threads()
+{
+#if KO_PAR_BACKEND == KO_PAR_OMP
+  return omp_get_num_procs();
+#elif KO_PAR_BACKEND == KO_PAR_SERIAL
+  return 1;
+#else
+  return std::max(1,static_cast<int>(std::thread::hardware_concurrency()));
+#endif
+}
+
+
+/*!
+* @brief If the calling thread is running the body of a parallel loop
+*/
+inline
+bool
+in_parallel()
+{
+#if KO_PAR_BACKEND == KO_PAR_OMP
+  return omp_in_parallel();
+#else
+  return tl_depth > 0;
+#endif
+}
+
+
+/*!
+* @brief If the calling thread is the main one: not running a loop body, or running it as the thread that started the outermost loop
+* @details Only the main thread can check for user interrupts and print
+*/
+inline
+bool
+main_thread()
+{
+#if KO_PAR_BACKEND == KO_PAR_OMP
+  return omp_get_level() <= 1 && omp_get_thread_num() == 0;
+#else
+  return tl_depth == 0 || (tl_issuer && tl_depth == 1);
+#endif
+}
+
+
+/*!
+* @brief Parallel loop over the iterations [0,n)
+* @param n number of iterations
+* @param number_threads number of threads (for the std::execution backend: 1 means serial, otherwise the threads are the ones of the implementation)
+* @param body function called on each iteration index
+* @param schedule how the iterations are assigned to the threads
+* @details Serial if only one thread is requested, if there is only one iteration, if called inside the body of another loop or by a forked process
+*/
+template<typename BODY>
+void
+parallel_for(std::size_t n, int number_threads, BODY &&body, PAR_SCHEDULE schedule = PAR_SCHEDULE::STATIC)
+{
+  const int threads = static_cast<int>(std::min(static_cast<std::size_t>(std::max(number_threads,1)),n));
+
+  if(KO_PAR_BACKEND == KO_PAR_SERIAL || threads <= 1 || serial_process || in_parallel())
+  {
+    for(std::size_t i = 0; i < n; ++i){  body(i);}
+    return;
+  }
+
+#if KO_PAR_BACKEND == KO_PAR_OMP
+  const std::ptrdiff_t n_iter = n;
+  if(schedule == PAR_SCHEDULE::DYNAMIC)
+  {
+#pragma omp parallel for num_threads(threads) schedule(dynamic,1)
+    for(std::ptrdiff_t i = 0; i < n_iter; ++i){  body(i);}
+  }
+  else
+  {
+#pragma omp parallel for num_threads(threads) schedule(static)
+    for(std::ptrdiff_t i = 0; i < n_iter; ++i){  body(i);}
+  }
+#elif KO_PAR_BACKEND == KO_PAR_STD
+  std::vector<std::size_t> indices(n);
+  std::iota(indices.begin(),indices.end(),static_cast<std::size_t>(0));
+  tl_issuer = true;
+  std::for_each(std::execution::par,indices.cbegin(),indices.cend(),[&body](std::size_t i){ body_scope scope; body(i);});
+  tl_issuer = false;
+#elif KO_PAR_BACKEND == KO_PAR_POOL
+  //iterations taken in chunks: one block per thread (static) or one at a time (dynamic)
+  const std::size_t chunk = schedule == PAR_SCHEDULE::DYNAMIC ? 1 : (n + threads - 1)/threads;
+  std::atomic<std::size_t> next{0};
+  const std::function<void()> work = [&body,&next,chunk,n]() noexcept
+  {
+    body_scope scope;
+    for(std::size_t start = next.fetch_add(chunk); start < n; start = next.fetch_add(chunk))
+    {
+      const std::size_t end = std::min(start + chunk,n);
+      for(std::size_t i = start; i < end; ++i){  body(i);}
+    }
+  };
+  tl_issuer = true;
+  global_thread_pool().run(threads - 1,work);
+  tl_issuer = false;
+#endif
+}
+
+
+/*!
+* @brief Parallel sum over the iterations [0,n)
+* @param n number of iterations
+* @param number_threads number of threads
+* @param term function returning the term of each iteration index
+* @return the sum of the terms
+* @details The terms are summed up in the order of the iterations: the result does not depend on the backend nor on the number of threads
+*/
+template<typename TERM>
+double
+parallel_sum(std::size_t n, int number_threads, TERM &&term)
+{
+  std::vector<double> terms(n);
+  parallel_for(n,number_threads,[&terms,&term](std::size_t i){ terms[i] = term(i);});
+
+  return std::accumulate(terms.cbegin(),terms.cend(),0.0);
+}
+
+}   //end namespace KO_Parallel
+
+#endif  //KO_PARALLEL_BACKEND_HPP
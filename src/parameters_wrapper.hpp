@@ -31,9 +31,7 @@
 
 #include "mesh.hpp"
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include "parallel_backend.hpp"
 
 
 /*!
@@ -57,6 +55,11 @@ wrap_string_CV_to_be_printed(const std::string &id_cv)
   if(id_cv==CV_algo::CV2){  return "cross validation on regularization parameter";}
   if(id_cv==CV_algo::CV3){  return "cross validation on number of PPCs";}
   if(id_cv==CV_algo::CV4){  return "cross validation on both regularization parameter and number of PPCs";}
+  if(id_cv==CV_algo::CV5){  return "continuous cross validation on regularization parameter";}
+  if(id_cv==CV_algo::CV6){  return "successive halving cross validation on regularization parameter";}
+  if(id_cv==CV_algo::CV7){  return "generalized cross validation on regularization parameter";}
+  if(id_cv==CV_algo::CV8){  return "eigenvalue-ratio criterion on number of PPCs";}
+  if(id_cv==CV_algo::CV9){  return "generalized cross validation on regularization parameter and eigenvalue-ratio criterion on number of PPCs";}
   else
   {
     std::string error_message = "Wrong input string";
@@ -124,22 +127,19 @@ check_k(const int &k, const int &max_k)
 
 
 /*!
-* @brief Check if, if using 'gep_solver', the number of PPCs is not retrieved through explanatory power criterion. Eventually, raises and error.
+* @brief Check if the separable estimator can be used: only with 'ex_solver' and without cross-validation. Eventually, raises and error.
+* @param separable 'true' if covariance and cross-covariance are estimated as Kronecker products
 * @param solver_ex 'true' if using ex_solver
 * @param id_cv which PPCKO version is used
-* @param k the input parameter k
 */
 inline
 void
-check_solver(bool solver_ex, const std::string &id_cv, int k)
+check_separable(bool separable, bool solver_ex, const std::string &id_cv)
 {
-  if(solver_ex == false)
+  if(separable && (!solver_ex || id_cv!=CV_algo::CV1))
   {
-    if ( (k==0 && (id_cv==CV_algo::CV1 || id_cv==CV_algo::CV2))  )
-    {
-      std::string error_message = "GEP solver can be used only if the number of PPCs is imposed or retrieved through CV";
-      throw std::invalid_argument(error_message);
-    }
+    std::string error_message = "Separable estimator can be used only with the exact solver and without cross-validation";
+    throw std::invalid_argument(error_message);
   }
 }
 
@@ -324,22 +324,21 @@ wrap_sizes_set_CV(Rcpp::Nullable<int> min_size_ts, Rcpp::Nullable<int> max_size_
 
 
 /*!
-* @brief Wrapping the number of threads for OMP
+* @brief Wrapping the number of threads for the parallel loops
 * @param num_threads indicates how many threads to be used by multi-threading directives.
 * @return the number of threads
-* @details if omp is not included: will return 1. If not, a number going from 1 up to the maximum cores available by the machine used (default, or if the input is smaller than 1 or bigger than the maximum number of available cores)
-* @note omp requested
+* @details if the parallel backend is serial: will return 1. If not, a number going from 1 up to the maximum cores available by the machine used (default, or if the input is smaller than 1 or bigger than the maximum number of available cores)
 */
 inline
 int
 wrap_num_thread(Rcpp::Nullable<int> num_threads)
 {
-#ifndef _OPENMP
+#if KO_PAR_BACKEND == KO_PAR_SERIAL
   return 1;
 #else
   
   //getting maximum number of cores in the machine
-  int max_n_t = omp_get_num_procs();
+  int max_n_t = KO_Parallel::max_threads();
   
   if(num_threads.isNull())
   {
@@ -357,20 +356,6 @@ wrap_num_thread(Rcpp::Nullable<int> num_threads)
 
 
 
-//removing NaNs
-/*!
-* @enum REM_NAN
-* @brief The available strategy for removing non-dummy NaNs
-*/
-enum REM_NAN
-{ 
-  NR = 0,      ///<  Not replacing NaN: not to be used by the user, necessary for handling dummy NaNs
-  MR = 1,      ///< Replacing nans with mean (could change the mean of the distribution)
-  ZR = 2,      ///< Replacing nans with 0s (could change the sd of the distribution)
-};
-
-
-
 /*!
 * @brief Wrapping the strategy for handling non-dummy NaNs
 * @param id_rem_nan string indicating the straegy for removing non-dummy NaNs
@@ -396,6 +381,10 @@ wrap_id_rem_nans(Rcpp::Nullable<std::string> id_rem_nan)
   {
     return REM_NAN::ZR;
   }
+  if(Rcpp::as< std::string >(id_rem_nan) == "PC")
+  {
+    return REM_NAN::PC;
+  }
   else
   {
     std::string error_message = "Wrong input string for handling NANs";
@@ -405,4 +394,290 @@ wrap_id_rem_nans(Rcpp::Nullable<std::string> id_rem_nan)
 };
 
 
+
+/*!
+* @brief Wrapping the quadrature rule defining the L2 geometry on the grid of discrete evaluations
+* @param id_quadrature string indicating the quadrature rule
+* @return the correpsonding value of 'QUADRATURE' (default: 'UNIF')
+*/
+inline
+QUADRATURE
+wrap_id_quadrature(Rcpp::Nullable<std::string> id_quadrature)
+{
+  if(id_quadrature.isNull())
+  { 
+    return QUADRATURE::UNIF;
+  }
+  if(Rcpp::as< std::string >(id_quadrature) == "UNIF")
+  {
+    return QUADRATURE::UNIF;
+  }
+  if(Rcpp::as< std::string >(id_quadrature) == "TRAPZ")
+  {
+    return QUADRATURE::TRAPZ;
+  }
+  if(Rcpp::as< std::string >(id_quadrature) == "SIMPS")
+  {
+    return QUADRATURE::SIMPS;
+  }
+  else
+  {
+    std::string error_message = "Wrong input string for the quadrature rule";
+    throw std::invalid_argument(error_message);
+  }
+
+};
+
+
+/*!
+* @brief Wrapping the threading policy, splitting the threads between outer loops and inner kernels
+* @param id_threading string indicating the threading policy
+* @return the correpsonding value of 'THREADING' (default: 'AUTO_THREADS')
+*/
+inline
+THREADING
+wrap_id_threading(Rcpp::Nullable<std::string> id_threading)
+{
+  if(id_threading.isNull())
+  {
+    return THREADING::AUTO_THREADS;
+  }
+  if(Rcpp::as< std::string >(id_threading) == "AUTO")
+  {
+    return THREADING::AUTO_THREADS;
+  }
+  if(Rcpp::as< std::string >(id_threading) == "OUTER")
+  {
+    return THREADING::OUTER_LOOPS;
+  }
+  if(Rcpp::as< std::string >(id_threading) == "INNER")
+  {
+    return THREADING::INNER_KERNELS;
+  }
+  else
+  {
+    std::string error_message = "Wrong input string for the threading policy";
+    throw std::invalid_argument(error_message);
+  }
+
+};
+
+
+/*!
+* @brief Wrapping the basis onto which the fts is projected
+* @param id_basis string indicating the basis
+* @return the correpsonding value of 'BASIS' (default: 'NONE')
+*/
+inline
+BASIS
+wrap_id_basis(Rcpp::Nullable<std::string> id_basis)
+{
+  if(id_basis.isNull())
+  { 
+    return BASIS::NONE;
+  }
+  if(Rcpp::as< std::string >(id_basis) == "NONE")
+  {
+    return BASIS::NONE;
+  }
+  if(Rcpp::as< std::string >(id_basis) == "BSPLINE")
+  {
+    return BASIS::BSPLINE;
+  }
+  if(Rcpp::as< std::string >(id_basis) == "FOURIER")
+  {
+    return BASIS::FOURIER;
+  }
+  else
+  {
+    std::string error_message = "Wrong input string for the basis";
+    throw std::invalid_argument(error_message);
+  }
+  
+};
+
+
+
+/*!
+* @brief Check if the number of basis functions is coherent with the basis and the number of discrete evaluations. Eventually, raises and error.
+* @param num_basis number of basis functions
+* @param id_basis basis onto which the fts is projected
+* @param dim number of discrete evaluations
+* @return the dimension of the space in which PPCKO is performed: 'num_basis' if the fts is projected, 'dim' otherwise
+*/
+inline
+int
+wrap_num_basis(int num_basis, BASIS id_basis, int dim)
+{
+  if(id_basis == BASIS::NONE)
+  {
+    return dim;
+  }
+  if(id_basis == BASIS::BSPLINE && num_basis < 4)
+  {
+    std::string error_message1 = "At least 4 cubic B-splines are needed";
+    throw std::invalid_argument(error_message1);
+  }
+  if(num_basis < 1 || num_basis > dim)
+  {
+    std::string error_message2 = "The number of basis functions has to be between 1 and the number of discrete evaluations (" + std::to_string(dim) + ")";
+    throw std::invalid_argument(error_message2);
+  }
+  
+  return num_basis;
+}
+
+
+/*!
+* @brief Wrapping the requested explained variance of the functional principal components onto which the fts is projected. Eventually, raises and error.
+* @param threshold_fpca requested proportion of explained variance ('NULL' if no projection)
+* @param separable 'true' if covariance and cross-covariance are estimated as Kronecker products (not compatible with the projection)
+* @return the requested explained variance, between 0 and 1 (1 if no projection)
+*/
+inline
+double
+wrap_threshold_fpca(Rcpp::Nullable<double> threshold_fpca, bool separable = false)
+{
+  if(threshold_fpca.isNull())
+  {
+    return static_cast<double>(1);
+  }
+  
+  double thr = Rcpp::as<double>(threshold_fpca);
+  
+  if(thr<=0 || thr>1)
+  {
+    std::string error_message1 = "threshold_fpca has to be in (0,1]";
+    throw std::invalid_argument(error_message1);
+  }
+  if(separable)
+  {
+    std::string error_message2 = "Separable estimator cannot be used on the functional principal components";
+    throw std::invalid_argument(error_message2);
+  }
+  
+  return thr;
+}
+
+
+/*!
+* @brief Checking the downsampling step of the coarse grid for the coarse-to-fine cv. Eventually, raises and error.
+* @param coarse_step downsampling step along each dimension (1: hyperparameters are selected only on the full grid)
+* @param id_basis basis expansion
+* @param fpca true if the fts is projected onto its functional principal components
+* @details The coarse grid is defined only for discrete evaluations: it cannot be used on coefficients or scores
+*/
+inline
+void
+check_coarse_step(int coarse_step, BASIS id_basis, bool fpca)
+{
+  if(coarse_step < 1)
+  {
+    std::string error_message1 = "coarse_step has to be at least 1";
+    throw std::invalid_argument(error_message1);
+  }
+  if(coarse_step > 1 && (id_basis != BASIS::NONE || fpca))
+  {
+    std::string error_message2 = "Coarse-to-fine cv can be performed only on the discrete evaluations, not with basis expansion or functional principal components";
+    throw std::invalid_argument(error_message2);
+  }
+}
+
+
+
+/*!
+* @brief Checking the maximum forecasting horizon. Eventually, raises and error.
+* @param horizon maximum forecasting horizon
+*/
+inline
+void
+check_horizon(int horizon)
+{
+  if(horizon < 1)
+  {
+    std::string error_message = "horizon has to be at least 1";
+    throw std::invalid_argument(error_message);
+  }
+}
+
+
+/*!
+* @brief Wrapping the time budget of the cv. Eventually, raises and error.
+* @param time_budget seconds available for the cv ('NULL' if no deadline)
+* @return the seconds available (0 if no deadline)
+*/
+inline
+double
+wrap_time_budget(Rcpp::Nullable<double> time_budget)
+{
+  if(time_budget.isNull())
+  {
+    return static_cast<double>(0);
+  }
+  
+  double seconds = Rcpp::as<double>(time_budget);
+  
+  if(!(seconds > 0))
+  {
+    std::string error_message = "time_budget has to be positive";
+    throw std::invalid_argument(error_message);
+  }
+  
+  return seconds;
+}
+
+
+/*!
+* @brief Wrapping the file of the cache of the validation errors. Eventually, raises and error.
+* @param cv_cache_file path of the file ('NULL' if no cache)
+* @param id_cv cv version
+* @return the path of the file (empty if no cache)
+*/
+inline
+std::string
+wrap_cv_cache_file(Rcpp::Nullable<std::string> cv_cache_file, const std::string &id_cv)
+{
+  if(cv_cache_file.isNull())
+  {
+    return std::string();
+  }
+  
+  std::string file = Rcpp::as<std::string>(cv_cache_file);
+  
+  if(file.empty())
+  {
+    std::string error_message1 = "cv_cache_file has to be a non-empty path";
+    throw std::invalid_argument(error_message1);
+  }
+  if(id_cv != CV_algo::CV4)
+  {
+    std::string error_message2 = "cv_cache_file can be used only with the 'CV' version";
+    throw std::invalid_argument(error_message2);
+  }
+  
+  return file;
+}
+
+
+/*!
+* @brief Checking the number of local worker processes across which the cv is sharded. Eventually, raises and error.
+* @param num_processes number of worker processes (1: no sharding)
+* @param id_cv cv version
+*/
+inline
+void
+check_num_processes(int num_processes, const std::string &id_cv)
+{
+  if(num_processes < 1)
+  {
+    std::string error_message1 = "num_processes has to be at least 1";
+    throw std::invalid_argument(error_message1);
+  }
+  if(num_processes > 1 && id_cv != CV_algo::CV2 && id_cv != CV_algo::CV4)
+  {
+    std::string error_message2 = "The cv can be sharded across worker processes only with the 'CV_alpha' and 'CV' versions";
+    throw std::invalid_argument(error_message2);
+  }
+}
+
 #endif  /*KO_WRAP_PARAMS_HPP*/
\ No newline at end of file
@@ -0,0 +1,194 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_QUADRATURE_HPP
+#define KO_QUADRATURE_HPP
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <tuple>
+
+#include "traits_ko.hpp"
+#include "mesh.hpp"
+
+
+/*!
+* @file quadrature.hpp
+* @brief Contains the quadrature weights defining the L2 geometry on the grid of discrete evaluations, and the diagonal similarity transform folding them into the fts
+* @author Andrea Enrico Franzoni
+* @details The weighted inner product <f,g>_W = f'Wg becomes the euclidean one for the transformed data W^(1/2)f: PPCKO is performed on W^(1/2)X,
+*          so covariance, cross-covariance, scores and validation loss are all evaluated according to the quadrature rule, while prediction,
+*          mean function, directions and weights are mapped back onto the grid through W^(-1/2)
+*/
+
+
+/*!
+* @brief Quadrature weights on a 1D grid
+* @tparam quad quadrature rule
+* @param grid mesh containing the points in which the functional data are evaluated
+* @return the array of the weights, one for each node
+* @details For 'QUADRATURE::SIMPS', the non-uniform composite Simpson rule is used on consecutive pairs of intervals: if the 
+*          number of intervals is odd, the last one is integrated through the trapezoidal rule
+*/
+template<QUADRATURE quad>
+KO_Traits::StoringArray
+quadrature_weights(const Geometry::Mesh1D &grid)
+{
+  const std::size_t n_nodes = grid.numNodes();
+  KO_Traits::StoringArray w = KO_Traits::StoringArray::Zero(n_nodes);
+  
+  if constexpr(quad == QUADRATURE::UNIF)
+  {
+    w.setOnes();
+  }
+  
+  if constexpr(quad == QUADRATURE::TRAPZ)
+  {
+    for(std::size_t i = 0; i < n_nodes - 1; ++i)
+    {
+      const double h = grid[i+1] - grid[i];
+      w(i)   += 0.5*h;
+      w(i+1) += 0.5*h;
+    }
+  }
+  
+  if constexpr(quad == QUADRATURE::SIMPS)
+  {
+    std::size_t i = 0;
+    for(; i + 2 < n_nodes; i += 2)
+    {
+      const double h0 = grid[i+1] - grid[i];
+      const double h1 = grid[i+2] - grid[i+1];
+      w(i)   += (h0 + h1)/6.0*(2.0 - h1/h0);
+      w(i+1) += (h0 + h1)/6.0*(h0 + h1)*(h0 + h1)/(h0*h1);
+      w(i+2) += (h0 + h1)/6.0*(2.0 - h0/h1);
+    }
+    //odd number of intervals: trapezoidal rule on the last one
+    if(i + 1 < n_nodes)
+    {
+      const double h = grid[i+1] - grid[i];
+      w(i)   += 0.5*h;
+      w(i+1) += 0.5*h;
+    }
+  }
+  
+  return w;
+}
+
+
+/*!
+* @brief Quadrature weights on a 1D grid, quadrature rule selected at runtime
+* @param grid mesh containing the points in which the functional data are evaluated
+* @param id_quad quadrature rule
+* @return the array of the weights, one for each node
+*/
+inline
+KO_Traits::StoringArray
+quadrature_weights(const Geometry::Mesh1D &grid, QUADRATURE id_quad)
+{
+  if(id_quad == QUADRATURE::TRAPZ){  return quadrature_weights<QUADRATURE::TRAPZ>(grid);}
+  if(id_quad == QUADRATURE::SIMPS){  return quadrature_weights<QUADRATURE::SIMPS>(grid);}
+  
+  return quadrature_weights<QUADRATURE::UNIF>(grid);
+}
+
+
+/*!
+* @brief Tensor-product quadrature weights on a 2D grid
+* @param w_x1 quadrature weights along dimension 1
+* @param w_x2 quadrature weights along dimension 2
+* @return the array of the weights, coherently with the column-wise flattening of the surface (index: i1 + i2*dim1)
+*/
+inline
+KO_Traits::StoringArray
+quadrature_weights(const KO_Traits::StoringArray &w_x1, const KO_Traits::StoringArray &w_x2)
+{
+  KO_Traits::StoringArray w(w_x1.size()*w_x2.size());
+  
+  for(std::size_t i2 = 0; i2 < w_x2.size(); ++i2)
+  {
+    w.segment(i2*w_x1.size(),w_x1.size()) = w_x1*w_x2(i2);
+  }
+  
+  return w;
+}
+
+
+/*!
+* @brief Square root of the quadrature weights of the points retained for the computations
+* @param w quadrature weights on the whole grid
+* @param rows_retained points of the grid retained (the ones without dummy NaNs). If empty, all the points are retained
+* @return the square root of the weights, normalized to have mean 1, so that the loss is comparable with the unweighted one
+* @note throws if a weight is not positive (Simpson rule on strongly non-uniform grids)
+*/
+inline
+KO_Traits::StoringArray
+quadrature_sqrt_weights(const KO_Traits::StoringArray &w, const std::vector<int> &rows_retained)
+{
+  KO_Traits::StoringArray w_ret = rows_retained.empty() ? w : KO_Traits::StoringArray(w(rows_retained));
+  
+  if((w_ret <= 0.0).any())
+  {
+    std::string error_message = "Quadrature weights have to be positive: the grid is too irregular for the requested quadrature rule";
+    throw std::invalid_argument(error_message);
+  }
+  
+  return (w_ret*(static_cast<double>(w_ret.size())/w_ret.sum())).sqrt();
+}
+
+
+/*!
+* @brief Folding the quadrature weights into the fts: X <- W^(1/2)X
+* @param X fts (modified in place)
+* @param sqrt_w square root of the quadrature weights (if empty: uniform grid, nothing is done)
+*/
+inline
+void
+to_weighted_geometry(KO_Traits::StoringMatrix &X, const KO_Traits::StoringArray &sqrt_w)
+{
+  if(sqrt_w.size()==0){  return;}
+  
+  X = sqrt_w.matrix().asDiagonal()*X;
+}
+
+
+/*!
+* @brief Mapping the results of PPCKO back onto the grid: prediction, directions, weights and mean function are multiplied by W^(-1/2)
+* @tparam RES type of the results tuple (depending on if validation errors are stored)
+* @param results results of PPCKO (modified in place)
+* @param sqrt_w square root of the quadrature weights (if empty: uniform grid, nothing is done)
+* @details Scores, their standard deviations and the explanatory power are inner products: they are invariant
+*/
+template<typename RES>
+void
+to_original_geometry(RES &results, const KO_Traits::StoringArray &sqrt_w)
+{
+  if(sqrt_w.size()==0){  return;}
+  
+  const KO_Traits::StoringArray inv_sqrt_w = sqrt_w.inverse();
+  
+  std::get<0>(results) = inv_sqrt_w.matrix().asDiagonal()*std::get<0>(results); //predictions
+  std::get<5>(results) = inv_sqrt_w.matrix().asDiagonal()*std::get<5>(results); //directions
+  std::get<6>(results) = inv_sqrt_w.matrix().asDiagonal()*std::get<6>(results); //weights
+  std::get<8>(results) = std::get<8>(results)*inv_sqrt_w;                       //mean function
+}
+
+#endif  /*KO_QUADRATURE_HPP*/
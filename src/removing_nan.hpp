@@ -32,7 +32,6 @@
 #include <string>
 #include <stdexcept>
 
-#include "parameters_wrapper.hpp"
 #include "traits_ko.hpp"
 
 
@@ -117,6 +116,5 @@ public:
 
 
 #include "removing_nan_imp.hpp"
-#include "removing_nan_cleaner_imp.hpp"
 
 #endif /*KO_REMOVE_NAN_HPP*/
\ No newline at end of file
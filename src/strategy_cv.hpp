@@ -35,6 +35,7 @@
 
 
 #include "traits_ko.hpp"
+#include "compressed_fts.hpp"
 
 
 /*!
@@ -61,9 +62,13 @@ using cv_strategy_t     = std::vector<std::pair<std::vector<int>,std::vector<int
 */
 using iter_cv_t         = std::pair<std::vector<int>,std::vector<int>>;
 /*!
-* Type for training and validation sets
+* Type for training and validation sets (decoded from the compressed fts)
 */
-using train_valid_set_t = std::pair<KO_Traits::StoringMatrix,KO_Traits::StoringMatrix>;
+using train_valid_set_t = std::pair<KO_Traits::StoringMatrix,KO_Traits::StoringVector>;
+/*!
+* Type for training and validation sets as views on the fts (no copy)
+*/
+using train_valid_view_t = std::pair<Eigen::Ref<const KO_Traits::StoringMatrix>,Eigen::Ref<const KO_Traits::StoringVector>>;
 
 
 /*!
@@ -85,11 +90,18 @@ private:
   cv_strategy_t m_strategy;
   
   /*!
-  * @brief For a fixed given split training/validation according to augmenting window strategy, returns the two sets
+  * @brief For a fixed given split training/validation according to augmenting window strategy, returns the two sets as views on the fts
   * @param data matrix containing the fts
   * @param strat a given split training/validation
   */
-  train_valid_set_t train_validation_set(const KO_Traits::StoringMatrix &data, const iter_cv_t &strat, CV_STRAT_T<CV_STRAT::AUGMENTING_WINDOW>) const;
+  train_valid_view_t train_validation_set(const KO_Traits::StoringMatrix &data, const iter_cv_t &strat, CV_STRAT_T<CV_STRAT::AUGMENTING_WINDOW>) const;
+  
+  /*!
+  * @brief For a fixed given split training/validation according to augmenting window strategy, returns the two sets, decoding only their instants
+  * @param data compressed fts
+  * @param strat a given split training/validation
+  */
+  train_valid_set_t train_validation_set(const compressed_fts &data, const iter_cv_t &strat, CV_STRAT_T<CV_STRAT::AUGMENTING_WINDOW>) const;
   
 public:
   
@@ -104,7 +116,7 @@ public:
   * @brief Getter for the splitting training/validation
   * @return the private m_strategy
   */
-  inline cv_strategy_t strategy() const {return m_strategy;}
+  inline const cv_strategy_t & strategy() const {return m_strategy;}
   
   /*!
   * @brief Creating the training/validation split. Tag-dispacther.
@@ -115,11 +127,18 @@ public:
   void train_validation_set_strategy(int min_dim_ts, int max_dim_ts) { return train_validation_set_strategy(min_dim_ts, max_dim_ts, CV_STRAT_T<cv_strat>{});};
 
   /*!
-  * @brief For a fixed given split training/validation according to augmenting window strategy, returns the two sets. Tag-dispacther.
+  * @brief For a fixed given split training/validation according to augmenting window strategy, returns the two sets as views on the fts. Tag-dispacther.
   * @param data matrix containing the fts
   * @param strat a given split training/validation
   */
-  train_valid_set_t train_validation_set(const KO_Traits::StoringMatrix &data, const iter_cv_t &strat) const { return train_validation_set(data, strat, CV_STRAT_T<cv_strat>{});};
+  train_valid_view_t train_validation_set(const KO_Traits::StoringMatrix &data, const iter_cv_t &strat) const { return train_validation_set(data, strat, CV_STRAT_T<cv_strat>{});};
+  
+  /*!
+  * @brief For a fixed given split training/validation, returns the two sets, decoding only their instants. Tag-dispacther.
+  * @param data compressed fts
+  * @param strat a given split training/validation
+  */
+  train_valid_set_t train_validation_set(const compressed_fts &data, const iter_cv_t &strat) const { return train_validation_set(data, strat, CV_STRAT_T<cv_strat>{});};
   
 };
 
@@ -66,13 +66,30 @@ cv_strategy<cv_strat>::train_validation_set_strategy(int min_dim_ts, int max_dim
 * @brief Retaining a specific pair training and validation set given them as input.
 * @param data matrix containing the fts
 * @param strat a given pair training/validation set
-* @return a pair: first element is the training set. Second element is the validation set.
+* @return a pair: first element is the training set. Second element is the validation set. Both are views on 'data' (no copy)
 * @details 'AUGMENTING_WINDOW' dispatch. Modifying 'm_strategy' class private member
 */
 template<CV_STRAT cv_strat>
-train_valid_set_t
+train_valid_view_t
 cv_strategy<cv_strat>::train_validation_set(const KO_Traits::StoringMatrix &data, const iter_cv_t &strat, CV_STRAT_T<CV_STRAT::AUGMENTING_WINDOW>)
 const
 {
-  return std::make_pair( data.leftCols(strat.first.front()), data.col(strat.second.front()) );
+  return train_valid_view_t( data.leftCols(strat.first.front()), data.col(strat.second.front()) );
+}
+
+
+
+/*!
+* @brief Retaining a specific pair training and validation set given them as input, from the compressed fts.
+* @param data compressed fts
+* @param strat a given pair training/validation set
+* @return a pair: first element is the training set. Second element is the validation set.
+* @details 'AUGMENTING_WINDOW' dispatch. Only the instants of the two sets are decoded
+*/
+template<CV_STRAT cv_strat>
+train_valid_set_t
+cv_strategy<cv_strat>::train_validation_set(const compressed_fts &data, const iter_cv_t &strat, CV_STRAT_T<CV_STRAT::AUGMENTING_WINDOW>)
+const
+{
+  return std::make_pair( data.decode(0,strat.first.front()), data.decode(strat.second.front(),1) );
 }
\ No newline at end of file
@@ -0,0 +1,277 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+#ifndef KO_THREADING_POLICY_HPP
+#define KO_THREADING_POLICY_HPP
+
+#include <string>
+#include <Eigen/Core>
+
+#include "traits_ko.hpp"
+#include "parallel_backend.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/*!
+* @file threading_policy.hpp
+* @brief Contains the threading policy: for each phase of PPCKO, how many threads go to the outer loops (OMP) and how many to the inner kernels (Eigen, BLAS)
+* @author Andrea Enrico Franzoni
+*/
+
+
+//BLAS threads: set only if the linked BLAS exposes them (weak symbols, resolved at load time)
+#if defined(__GNUC__) && defined(__linux__)
+#define KO_BLAS_THREADS
+extern "C" void openblas_set_num_threads(int) __attribute__((weak));
+extern "C" int  openblas_get_num_threads(void) __attribute__((weak));
+extern "C" void flexiblas_set_num_threads(int) __attribute__((weak));
+extern "C" int  flexiblas_get_num_threads(void) __attribute__((weak));
+extern "C" void MKL_Set_Num_Threads(int) __attribute__((weak));
+extern "C" int  MKL_Get_Max_Threads(void) __attribute__((weak));
+#endif
+
+
+/*!
+* @class threading_policy
+* @brief Process-wide threading policy, active for the lifetime of the object: the previous one is restored at destruction
+* @details While active, nested OMP parallelism is disabled: a loop running inside a parallel one is executed by a single thread, 
+*          and the kernels inside parallel loops are single-threaded
+*/
+class threading_policy
+{
+private:
+  
+  /*!Active policy*/
+  inline static THREADING s_policy = THREADING::AUTO_THREADS;
+  
+  /*!Policy active before the object construction*/
+  THREADING m_prev_policy;
+  /*!Maximum number of nested active parallel regions before the object construction*/
+  int m_prev_max_levels;
+  
+public:
+  
+  /*!
+  * @brief Constructor: activating the policy and disabling nested OMP parallelism
+  * @param policy threading policy
+  */
+  threading_policy(THREADING policy)
+    : m_prev_policy(s_policy), m_prev_max_levels(1)
+    {
+      s_policy = policy;
+#ifdef _OPENMP
+      m_prev_max_levels = omp_get_max_active_levels();
+      omp_set_max_active_levels(1);
+#endif
+    }
+  
+  /*!
+  * @brief Destructor: restoring the previous policy and nesting
+  */
+  ~threading_policy()
+  {
+    s_policy = m_prev_policy;
+#ifdef _OPENMP
+    omp_set_max_active_levels(m_prev_max_levels);
+#endif
+  }
+  
+  threading_policy(const threading_policy&) = delete;
+  threading_policy & operator=(const threading_policy&) = delete;
+  
+  /*!
+  * @brief Getter for the active policy
+  * @return the private s_policy
+  */
+  static inline THREADING current() {return s_policy;};
+  
+  /*!
+  * @brief If the inner kernels can be multi-threaded: Eigen products parallelized through OMP
+  */
+  static 
+  constexpr 
+  bool 
+  threaded_kernels()
+  {
+#ifdef EIGEN_HAS_OPENMP
+    return true;
+#else
+    return false;
+#endif
+  }
+  
+  /*!
+  * @brief Number of threads for the outer loops (OMP) of a phase
+  * @param phase phase of PPCKO
+  * @param number_threads threads available
+  * @return the number of threads
+  * @details 'AUTO_THREADS': all the threads to the loops of the cv grid, one thread to the loops of moments and eigensolve (their threads go to the 
+  *          kernels, unless these cannot be multi-threaded). The product with 'inner_threads()' never exceeds the threads available
+  */
+  static 
+  int 
+  outer_threads(KO_PHASE phase, int number_threads)
+  {
+    if(s_policy == THREADING::OUTER_LOOPS){    return number_threads;}
+    if(s_policy == THREADING::INNER_KERNELS){  return 1;}
+    
+    return phase == KO_PHASE::CV_GRID || !threaded_kernels() ? number_threads : 1;
+  }
+  
+  /*!
+  * @brief Number of threads for the inner kernels (Eigen products, BLAS) of a phase
+  * @param phase phase of PPCKO
+  * @param number_threads threads available
+  * @return the number of threads
+  * @details 'AUTO_THREADS': all the threads to the kernels of moments and eigensolve (if they can be multi-threaded), single-threaded kernels inside the cv grid.
+  *          The product with 'outer_threads()' never exceeds the threads available
+  */
+  static 
+  int 
+  inner_threads(KO_PHASE phase, int number_threads)
+  {
+    if(s_policy == THREADING::OUTER_LOOPS){    return 1;}
+    if(s_policy == THREADING::INNER_KERNELS){  return number_threads;}
+    
+    return phase == KO_PHASE::CV_GRID || !threaded_kernels() ? 1 : number_threads;
+  }
+  
+  /*!
+  * @brief Number of threads of the linked BLAS
+  * @return the number of threads (0 if the BLAS does not expose them)
+  */
+  static 
+  int 
+  blas_threads()
+  {
+#ifdef KO_BLAS_THREADS
+    if(openblas_get_num_threads){  return openblas_get_num_threads();}
+    if(flexiblas_get_num_threads){ return flexiblas_get_num_threads();}
+    if(MKL_Get_Max_Threads){       return MKL_Get_Max_Threads();}
+#endif
+    return 0;
+  }
+  
+  /*!
+  * @brief Setting the number of threads of the linked BLAS, if it exposes them
+  * @param number_threads number of threads
+  */
+  static 
+  void 
+  set_blas_threads(int number_threads)
+  {
+#ifdef KO_BLAS_THREADS
+    if(openblas_set_num_threads){  openblas_set_num_threads(number_threads);}
+    if(flexiblas_set_num_threads){ flexiblas_set_num_threads(number_threads);}
+    if(MKL_Set_Num_Threads){       MKL_Set_Num_Threads(number_threads);}
+#endif
+  }
+  
+  /*!
+  * @brief Name of a threading policy
+  * @param policy threading policy
+  * @return its name
+  */
+  static 
+  std::string 
+  name(THREADING policy)
+  {
+    if(policy == THREADING::OUTER_LOOPS){   return "OUTER";}
+    if(policy == THREADING::INNER_KERNELS){ return "INNER";}
+    return "AUTO";
+  }
+};
+
+
+/*!
+* @class threading_phase
+* @brief Threads of the kernels set according to the active policy for a phase, for the lifetime of the object: restored at destruction
+* @details Inside a parallel region nothing is changed: the kernels there are single-threaded anyway, and the settings are process-wide.
+*          Nothing is changed in a forked process either: its kernels stay single-threaded (see 'serial_forked_process()')
+*/
+class threading_phase
+{
+private:
+  
+  /*!Threads for the outer loops of the phase*/
+  int m_outer_threads;
+  /*!If the threads of the kernels have been changed*/
+  bool m_changed;
+  /*!Threads of Eigen and of the linked BLAS before the object construction*/
+  int m_prev_eigen_threads;
+  int m_prev_blas_threads;
+  
+public:
+  
+  /*!
+  * @brief Constructor: setting the threads of the kernels for the phase
+  * @param phase phase of PPCKO
+  * @param number_threads threads available
+  */
+  threading_phase(KO_PHASE phase, int number_threads)
+    : m_outer_threads(threading_policy::outer_threads(phase,number_threads)), m_changed(false), m_prev_eigen_threads(1), m_prev_blas_threads(0)
+    {
+      if(KO_Parallel::serial_process || KO_Parallel::in_parallel()){  return;}
+      m_changed = true;
+      m_prev_eigen_threads = Eigen::nbThreads();
+      m_prev_blas_threads  = threading_policy::blas_threads();
+      const int inner_threads = threading_policy::inner_threads(phase,number_threads);
+      Eigen::setNbThreads(inner_threads);
+      if(m_prev_blas_threads > 0){  threading_policy::set_blas_threads(inner_threads);}
+    }
+  
+  /*!
+  * @brief Destructor: restoring the previous threads of the kernels
+  */
+  ~threading_phase()
+  {
+    if(!m_changed){  return;}
+    Eigen::setNbThreads(m_prev_eigen_threads);
+    if(m_prev_blas_threads > 0){  threading_policy::set_blas_threads(m_prev_blas_threads);}
+  }
+  
+  threading_phase(const threading_phase&) = delete;
+  threading_phase & operator=(const threading_phase&) = delete;
+  
+  /*!
+  * @brief Getter for the threads of the outer loops of the phase
+  * @return the private m_outer_threads
+  */
+  inline int outer_threads() const {return m_outer_threads;};
+};
+
+
+/*!
+* @brief Making a forked process single-threaded: serial loops (OMP and the pool are not touched), single-threaded Eigen and BLAS kernels
+* @details To be called by a forked process as soon as it starts: the threads of the OMP runtime, of the pool and of the BLAS of the parent 
+*          do not exist there, and a parallel region could deadlock on the locks they held at the fork
+*/
+inline
+void
+serial_forked_process()
+{
+  KO_Parallel::run_serial_process();
+  Eigen::setNbThreads(1);
+  threading_policy::set_blas_threads(1);
+}
+
+#endif  //KO_THREADING_POLICY_HPP
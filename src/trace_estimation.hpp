@@ -0,0 +1,99 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+
+#ifndef KO_TRACE_ESTIMATION_HPP
+#define KO_TRACE_ESTIMATION_HPP
+
+#include <utility>
+#include <random>
+#include <algorithm>
+
+#include "traits_ko.hpp"
+
+#include "parallel_backend.hpp"
+
+
+/*!
+* @file trace_estimation.hpp
+* @brief Contains the stochastic estimation of the trace of an operator known only through its action on vectors
+* @author Andrea Enrico Franzoni
+*/
+
+
+/*!Number of discrete evaluations from which the total explanatory power is estimated stochastically, without assembling phi (can be set at compile time)*/
+#ifndef KO_TRACE_EST_MIN_SIZE
+#define KO_TRACE_EST_MIN_SIZE 10000
+#endif
+
+/*!Number of products with phi used by the stochastic estimate of its trace (can be set at compile time)*/
+#ifndef KO_TRACE_EST_MATVECS
+#define KO_TRACE_EST_MATVECS 150
+#endif
+
+
+/*!
+* @brief Hutch++ estimate of the trace of a symmetric positive semi-definite operator, through products with it only
+* @tparam OP 'Spectra'-like operator (exposing rows() and perform_op(x_in,y_out))
+* @param op the operator
+* @param num_matvecs number of products with the operator: one third for the range sketch, one third for its image, one third for the Hutchinson residual
+* @param number_threads number of threads for OMP
+* @param seed seed of the Rademacher vectors
+* @return a pair containing the estimate of the trace and the estimated variance of the estimate
+* @details trace(A) = trace(Q'AQ) + trace((I-QQ')A(I-QQ')), with Q an orthonormal basis of the range of A*S, S random: the first term is exact, 
+*          the second one is estimated by Hutchinson, whose variance is the sample variance of its terms over their number
+* @note parallel loops through 'KO_Parallel'
+*/
+template<typename OP>
+std::pair<double,double>
+hutchpp_trace(const OP &op, int num_matvecs, int number_threads, unsigned int seed = 1)
+{
+  const Eigen::Index m = op.rows();
+  const Eigen::Index s = std::min(static_cast<Eigen::Index>(std::max(1,num_matvecs/3)),m);
+  
+  //Rademacher vectors: sketch (S) and Hutchinson (G)
+  std::mt19937 gen(seed);
+  std::bernoulli_distribution coin(0.5);
+  KO_Traits::StoringMatrix S = KO_Traits::StoringMatrix::NullaryExpr(m,s,[&gen,&coin](){return coin(gen) ? 1.0 : -1.0;});
+  KO_Traits::StoringMatrix G = KO_Traits::StoringMatrix::NullaryExpr(m,s,[&gen,&coin](){return coin(gen) ? 1.0 : -1.0;});
+  
+  //products with the operator, one column at a time
+  auto apply = [&op,number_threads](const KO_Traits::StoringMatrix &V)
+  {
+    KO_Traits::StoringMatrix AV(V.rows(),V.cols());
+    KO_Parallel::parallel_for(V.cols(),number_threads,[&op,&V,&AV](std::size_t j){ op.perform_op(V.col(j).data(),AV.col(j).data());});
+    return AV;
+  };
+  
+  //range sketch: its contribution is exact
+  Eigen::HouseholderQR<KO_Traits::StoringMatrix> qr(apply(S));
+  KO_Traits::StoringMatrix Q = qr.householderQ()*KO_Traits::StoringMatrix::Identity(m,s);
+  S.resize(0,0);
+  const double tr_sketch = Q.cwiseProduct(apply(Q)).sum();
+  
+  //Hutchinson on the deflated operator
+  G -= Q*(Q.transpose()*G);
+  KO_Traits::StoringArray terms = G.cwiseProduct(apply(G)).colwise().sum().transpose().array();
+  const double tr_residual = terms.mean();
+  const double var_residual = s > 1 ? (terms - tr_residual).square().sum()/static_cast<double>((s-1)*s) : 0.0;
+  
+  return std::make_pair(tr_sketch + tr_residual,var_residual);
+}
+
+#endif  /*KO_TRACE_ESTIMATION_HPP*/
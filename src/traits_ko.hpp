@@ -38,23 +38,46 @@
 
 
 /*!
-* @struct KO_Traits
+* @struct KO_Traits_T
 * @brief Contains the customized types for fts, covariances, PPCs, etc...
-* @details Data are stored in dynamic matrices (easily very big dimensions) of doubles
+* @tparam T scalar type of the stored values
+* @details Data are stored in dynamic matrices (easily very big dimensions)
 */
-struct KO_Traits
+template<typename T>
+struct KO_Traits_T
 {
 public:
   
-  using StoringMatrix = Eigen::MatrixXd;  ///< Matrix data structure.
+  using Scalar = T;                                                        ///< Scalar type.
   
-  using StoringVector = Eigen::VectorXd;  ///< Vector data structure.
+  using StoringMatrix = Eigen::Matrix<T,Eigen::Dynamic,Eigen::Dynamic>;    ///< Matrix data structure.
   
-  using StoringArray  = Eigen::ArrayXd;   ///< Array data structure: more efficient for coefficient-wise operations.
+  using StoringVector = Eigen::Matrix<T,Eigen::Dynamic,1>;                 ///< Vector data structure.
+  
+  using StoringArray  = Eigen::Array<T,Eigen::Dynamic,1>;                  ///< Array data structure: more efficient for coefficient-wise operations.
+  
+  using StoringMask   = Eigen::Array<bool,Eigen::Dynamic,Eigen::Dynamic>;  ///< Mask data structure: availability of each evaluation (one byte per evaluation).
 
 };
 
 
+/*!
+* Types used by the algorithm: doubles
+*/
+using KO_Traits = KO_Traits_T<double>;
+
+
+/*!
+* Types used by the heavy products estimating covariance and cross-covariance: floats if compiled with KO_MIXED_PRECISION
+* (products in single precision, estimates stored and all the following computations in double precision), doubles otherwise
+*/
+#ifdef KO_MIXED_PRECISION
+using KO_Moments_Traits = KO_Traits_T<float>;
+#else
+using KO_Moments_Traits = KO_Traits_T<double>;
+#endif
+
+
 /*!
 * @struct CV_algo
 * @brief Contains PPCKO versions implemented
@@ -65,6 +88,11 @@ struct CV_algo
   static constexpr std::string CV2 = "CV_alpha";    ///< Cv for regularization parameter.
   static constexpr std::string CV3 = "CV_k";        ///< Cv for number of retained PPCs.
   static constexpr std::string CV4 = "CV";          ///< Cv for both regularization parameter and number of retained PPCs.
+  static constexpr std::string CV5 = "CV_alpha_cont"; ///< Cv for regularization parameter, searched continuously within the interval spanned by its input space.
+  static constexpr std::string CV6 = "CV_alpha_sh";   ///< Cv for regularization parameter, pruning the worst candidates through successive halving on the splits.
+  static constexpr std::string CV7 = "GCV_alpha";     ///< Regularization parameter selected through generalized cross-validation, in closed form.
+  static constexpr std::string CV8 = "ER_k";          ///< Number of retained PPCs selected through the eigenvalue-ratio criterion, in closed form.
+  static constexpr std::string CV9 = "GCV";           ///< Regularization parameter through generalized cross-validation, and then number of retained PPCs through eigenvalue-ratio criterion.
 };
 
 
@@ -74,7 +102,7 @@ struct CV_algo
 */
 enum SOLVER
 {
-  ex_solver  = 0,      ///< Inverted square root regularzied covariance and retrieving PPCs from phi
+  ex_solver  = 0,      ///< Whitening through the Cholesky factor of the regularized covariance and retrieving PPCs from phi
   gep_solver = 1,      ///< Using GEP to avoid to avoid inverted square root
 };
 
@@ -111,13 +139,112 @@ enum CV_STRAT
 };
 
 
+/*!
+* @enum ALPHA_SEARCH
+* @brief How the cv on the regularization parameter explores its input space
+*/
+enum ALPHA_SEARCH
+{
+  GRID_SEARCH    = 0,  ///< Every element of the input space is validated on every training/validation split
+  BRENT_SEARCH   = 1,  ///< Brent's method on log10 of the regularization parameter, within the interval spanned by the input space
+  HALVING_SEARCH = 2,  ///< Successive halving: the elements of the input space are validated on growing nested subsets of splits, retaining the best half each time
+};
+
+
+/*!
+* @enum CF_SELECTION
+* @brief Which parameters are selected in closed form, from the spectra of a single fit
+*/
+enum CF_SELECTION
+{
+  CF_ALPHA   = 0,  ///< Regularization parameter, through generalized cross-validation along the regularization path
+  CF_K       = 1,  ///< Number of retained PPCs, through eigenvalue-ratio criterion
+  CF_ALPHA_K = 2,  ///< Both: the number of retained PPCs is selected given the regularization parameter
+};
+
+
 /*!
 * @enum CV_ERR_EVAL
 * @brief How to compute validation errors during cv
 */
 enum CV_ERR_EVAL
 {
-  MSE = 0,  ///< Estimate of the L2 norm loss
+  MSE          = 0,  ///< Estimate of the L2 norm loss
+  MAE          = 1,  ///< Estimate of the L1 norm loss
+  WEIGHTED_MSE = 2,  ///< Estimate of the L2 norm loss, each evaluation weighted by the inverse of its variance along the fts
+  RELATIVE_MSE = 3,  ///< Estimate of the L2 norm loss, relative to the squared L2 norm of the validation set
+};
+
+
+/*!
+* @enum REM_NAN
+* @brief The available strategy for removing non-dummy NaNs
+*/
+enum REM_NAN
+{ 
+  NR = 0,      ///<  Not replacing NaN: not to be used by the user, necessary for handling dummy NaNs
+  MR = 1,      ///< Replacing nans with mean (could change the mean of the distribution)
+  ZR = 2,      ///< Replacing nans with 0s (could change the sd of the distribution)
+  PC = 3,      ///< Not replacing nans: moments are estimated with pairwise-complete observations
+};
+
+
+/*!
+* @enum QUADRATURE
+* @brief Quadrature rule defining the L2 geometry on the grid of discrete evaluations
+*/
+enum QUADRATURE
+{
+  UNIF  = 0,  ///< Uniform unweighted grid: plain euclidean geometry
+  TRAPZ = 1,  ///< Composite trapezoidal rule on the (eventually non-uniform) grid
+  SIMPS = 2,  ///< Composite Simpson rule on the (eventually non-uniform) grid
+};
+
+
+/*!
+* @enum BASIS
+* @brief Basis onto which the fts is projected, performing PPCKO on the basis coefficients
+*/
+enum BASIS
+{
+  NONE    = 0,  ///< No basis expansion: PPCKO performed on the discrete evaluations
+  BSPLINE = 1,  ///< Cubic B-splines on uniform knots
+  FOURIER = 2,  ///< Fourier basis (constant, sines and cosines)
+};
+
+
+/*!
+* @enum THREADING
+* @brief Where the threads go: to the outer loops (OMP) or to the inner kernels (Eigen products, BLAS)
+*/
+enum THREADING
+{
+  AUTO_THREADS  = 0,  ///< Outer loops for the cv grid, inner kernels for moments and eigensolve of the single fits
+  OUTER_LOOPS   = 1,  ///< All the threads to the outer loops, kernels single-threaded
+  INNER_KERNELS = 2,  ///< All the threads to the kernels, outer loops sequential
+};
+
+
+/*!
+* @enum KO_PHASE
+* @brief Phases of PPCKO with their own threading
+*/
+enum KO_PHASE
+{
+  MOMENTS    = 0,  ///< Mean function, covariance and cross-covariance estimates
+  EIGENSOLVE = 1,  ///< Regularization, whitening and leading eigenpairs
+  CV_GRID    = 2,  ///< Validation of the parameters over the training/validation splits
+};
+
+
+/*!
+* @enum PAR_SCHEDULE
+* @brief How the iterations of a parallel loop are assigned to the threads
+*/
+enum PAR_SCHEDULE
+{
+  STATIC  = 0,  ///< One contiguous block of iterations for each thread: iterations of similar cost
+  DYNAMIC = 1,  ///< One iteration at a time to the first thread available: iterations of uneven cost
 };
 
 
@@ -131,9 +258,10 @@ using valid_err_variant = std::variant<valid_err_cv_1_t,valid_err_cv_2_t>;
 
 /*!
 * Types for the results: tuple is exploited, dimension and types depends on if valdiation errors are returned and which ones eventually
+* The first element stores the predictions for all the requested horizons (one column each)
 */
-using results_err_t = std::tuple<KO_Traits::StoringVector, double, int, std::vector<double>, std::vector<double>, KO_Traits::StoringMatrix, KO_Traits::StoringMatrix, std::vector<std::array<double,2>>, KO_Traits::StoringArray, valid_err_variant>; 
-using results_no_err_t = std::tuple<KO_Traits::StoringVector, double, int, std::vector<double>, std::vector<double>, KO_Traits::StoringMatrix, KO_Traits::StoringMatrix, std::vector<std::array<double,2>>, KO_Traits::StoringArray>; 
+using results_err_t = std::tuple<KO_Traits::StoringMatrix, double, int, std::vector<double>, std::vector<double>, KO_Traits::StoringMatrix, KO_Traits::StoringMatrix, std::vector<std::array<double,2>>, KO_Traits::StoringArray, valid_err_variant>; 
+using results_no_err_t = std::tuple<KO_Traits::StoringMatrix, double, int, std::vector<double>, std::vector<double>, KO_Traits::StoringMatrix, KO_Traits::StoringMatrix, std::vector<std::array<double,2>>, KO_Traits::StoringArray>; 
 
 /*!
 * Type for the returning error: depending on
@@ -21,6 +21,8 @@
 #define KO_UTILS_HPP
 
 #include "traits_ko.hpp"
+#include "threading_policy.hpp"
+#include "ko_log.hpp"
 #include <limits>
 
 /*!
@@ -121,4 +123,60 @@ add_nans_vec(const KO_Traits::StoringVector &pred, const std::vector<int> &row_r
   return pred_comp;
 }
 
+
+/*!
+* @brief Function to add dummy NaNs to each column of a matrix of curves/surfaces
+* @param pred matrix whose columns are the curves/surfaces where NaNs have to be added
+* @param row_ret vector containing the actual rows that are not dummy NaNs 
+* @param complete_size number of rows of the returning matrix considering also the dummy NaNs
+* @return a matrix with dummy NaNs in the requested rows
+*/
+KO_Traits::StoringMatrix
+add_nans_mat(const KO_Traits::StoringMatrix &pred, const std::vector<int> &row_ret, int complete_size)
+{
+  if(row_ret.size()==0){return pred;}
+  KO_Traits::StoringMatrix pred_comp(complete_size,pred.cols());
+  
+  pred_comp.setConstant(std::numeric_limits<double>::quiet_NaN());
+  
+  // putting values where they actually are
+  for(std::size_t i = 0; i < row_ret.size(); ++i){  pred_comp.row(row_ret[i]) = pred.row(i);}
+  
+  return pred_comp;
+}
+
+
+/*!
+* @brief Function to record the threading policy used, and how the threads have been split for each phase
+* @param number_threads number of threads available
+* @return a list containing the name of the policy, the threads available and, for each phase, the threads of the outer loops and of the inner kernels
+*/
+Rcpp::List
+threading_record(int number_threads)
+{
+  auto split = [number_threads](KO_PHASE phase) -> Rcpp::IntegerVector
+  {
+    return Rcpp::IntegerVector::create(Rcpp::Named("outer") = threading_policy::outer_threads(phase,number_threads),
+                                       Rcpp::Named("inner") = threading_policy::inner_threads(phase,number_threads));
+  };
+  
+  return Rcpp::List::create(Rcpp::Named("Policy")     = threading_policy::name(threading_policy::current()),
+                            Rcpp::Named("Threads")    = number_threads,
+                            Rcpp::Named("Moments")    = split(KO_PHASE::MOMENTS),
+                            Rcpp::Named("Eigensolve") = split(KO_PHASE::EIGENSOLVE),
+                            Rcpp::Named("Cv grid")    = split(KO_PHASE::CV_GRID));
+}
+
+
+/*!
+* @brief Sink of the messages of the library ('KO_Log'): the R console
+* @param msg message
+*/
+inline
+void
+r_console_log(const std::string &msg)
+{
+  Rcpp::Rcout << msg << std::endl;
+}
+
 #endif  //KO_UTILS_HPP
\ No newline at end of file
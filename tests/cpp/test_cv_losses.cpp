@@ -0,0 +1,126 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+/*!
+* @file test_cv_losses.cpp
+* @brief Standalone test of the validation losses of the cv ('CV_ERR_EVAL'): reference values, missing evaluations, splits without an error
+* @author Andrea Enrico Franzoni
+* @details Built and run through ctest:
+*          cmake -S tests/cpp -B build-tests && cmake --build build-tests && ctest --test-dir build-tests
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+
+#include "PPC_KO_CV_k.hpp"
+
+
+static int failures = 0;
+static const double nan_v = std::numeric_limits<double>::quiet_NaN();
+
+
+//checking a loss against its reference value (NaN: the split has no error)
+void
+check(const char *name, double value, double expected)
+{
+  const bool ok = std::isnan(expected) ? std::isnan(value) : std::abs(value - expected) <= 1e-14*std::max(1.0,std::abs(expected));
+  if(!ok)
+  {
+    std::printf("%s: %.17g instead of %.17g\n",name,value,expected);
+    ++failures;
+  }
+}
+
+
+//loss of the cv on the number of PPCs, through its dispatch on 'err_eval'
+template<CV_ERR_EVAL err_eval>
+double
+cv_loss(const KO_Traits::StoringVector &pred, const KO_Traits::StoringVector &valid, const KO_Traits::StoringVector &weights = KO_Traits::StoringVector())
+{
+  //fts with constant instants: each evaluation has null variance, and the weights of the weighted loss are set afterwards
+  KO_Traits::StoringMatrix X = KO_Traits::StoringMatrix::Ones(valid.size(),4);
+  auto predictor = [](const Eigen::Ref<const KO_Traits::StoringMatrix> &data, double alpha, int k, int number_threads) -> const KO_Traits::StoringVector & 
+                     { return cv_pred_func<SOLVER::ex_solver,K_IMP::YES,VALID_ERR_RET::NO_err,CV_STRAT::AUGMENTING_WINDOW,err_eval>(data,alpha,k,number_threads);};
+  auto strategy = Factory_cv_strat<CV_STRAT::AUGMENTING_WINDOW>::cv_strat_obj(2,4);
+  CV_k<CV_STRAT::AUGMENTING_WINDOW,err_eval,K_IMP::YES,VALID_ERR_RET::NO_err> cv(std::move(X),std::move(*strategy),{1},0.0,0.01,predictor,1);
+  if constexpr(err_eval == CV_ERR_EVAL::WEIGHTED_MSE){  cv.err_weights() = weights;}
+  
+  return cv.err_valid_set_eval(pred,valid);
+}
+
+
+int main()
+{
+  //differences: 1, 0, -2, and a missing evaluation in the validation set
+  KO_Traits::StoringVector pred(4), valid(4), weights(4);
+  pred    << 1.0, 2.0, 3.0, 4.0;
+  valid   << 0.0, 2.0, 5.0, nan_v;
+  weights << 1.0, 2.0, 0.5, 10.0;
+  
+  check("mse",           mse(pred,valid),                                    5.0/3.0);
+  check("mae",           mae(pred,valid),                                    1.0);
+  check("weighted mse",  weighted_mse(pred,valid,weights),                   3.0/3.5);
+  check("relative mse",  relative_mse(pred,valid),                           5.0/29.0);
+  check("cv mse",        cv_loss<CV_ERR_EVAL::MSE>(pred,valid),              5.0/3.0);
+  check("cv mae",        cv_loss<CV_ERR_EVAL::MAE>(pred,valid),              1.0);
+  check("cv weighted",   cv_loss<CV_ERR_EVAL::WEIGHTED_MSE>(pred,valid,weights), 3.0/3.5);
+  check("cv relative",   cv_loss<CV_ERR_EVAL::RELATIVE_MSE>(pred,valid),     5.0/29.0);
+  
+  //missing evaluation in the prediction: skipped as well
+  KO_Traits::StoringVector pred_nan = pred;
+  pred_nan(1) = nan_v;
+  check("mse, missing prediction",    mse(pred_nan,valid),    2.5);
+  check("mae, missing prediction",    mae(pred_nan,valid),    1.5);
+  
+  //no evaluation available: no error
+  KO_Traits::StoringVector valid_nan = KO_Traits::StoringVector::Constant(4,nan_v);
+  check("mse, no evaluation",          mse(pred,valid_nan),                  nan_v);
+  check("mae, no evaluation",          mae(pred,valid_nan),                  nan_v);
+  check("weighted mse, no evaluation", weighted_mse(pred,valid_nan,weights), nan_v);
+  check("relative mse, no evaluation", relative_mse(pred,valid_nan),         nan_v);
+  
+  //null weights, and null validation set for the relative loss: no error
+  check("weighted mse, null weights",  weighted_mse(pred,valid,KO_Traits::StoringVector::Zero(4)),                nan_v);
+  check("cv weighted, null weights",   cv_loss<CV_ERR_EVAL::WEIGHTED_MSE>(pred,valid,KO_Traits::StoringVector::Zero(4)), nan_v);
+  check("relative mse, null valid",    relative_mse(pred,KO_Traits::StoringVector::Zero(4)),                       nan_v);
+  
+  //weights of the weighted loss: inverse of the pointwise variance, missing evaluations skipped, null for constant evaluations
+  KO_Traits::StoringMatrix X(3,4);
+  X << 1.0, 3.0, 1.0, 3.0,
+       0.0, 4.0, nan_v, 2.0,
+       5.0, 5.0, 5.0, 5.0;
+  KO_Traits::StoringVector w = inverse_pointwise_variance(X);
+  check("weight, complete evaluation", w(0), 1.0);
+  check("weight, missing evaluation",  w(1), 3.0/8.0);
+  check("weight, constant evaluation", w(2), 0.0);
+  
+  //mean over the splits: the ones without an error are skipped
+  check("mean of the splits",          valid_splits_mean({1.0,nan_v,3.0}), 2.0);
+  check("mean of the splits, no error", valid_splits_mean({nan_v,nan_v}),  nan_v);
+  
+  if(failures > 0)
+  {
+    std::printf("cv losses: %d failures\n",failures);
+    return EXIT_FAILURE;
+  }
+  std::printf("cv losses: all tests passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+/*!
+* @file test_fold_workspace_alloc.cpp
+* @brief Standalone test of 'fold_workspace': predictions equal to the dense PPCKO estimate and to 'PPC_KO_NoCV', and no heap allocations once the longest fold has been seen,
+*        neither by the workspace nor by the cv evaluating the splits through it
+* @author Andrea Enrico Franzoni
+* @details Allocations are counted interposing malloc (glibc). Built and run through ctest:
+*          cmake -S tests/cpp -B build-tests && cmake --build build-tests && ctest --test-dir build-tests
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <random>
+
+#include "fold_workspace.hpp"
+#include "PPC_KO_CV_k.hpp"
+
+
+//counting the calls to malloc (Eigen allocates through it)
+static long number_mallocs = 0;
+static bool counting = false;
+extern "C" void* __libc_malloc(std::size_t);
+extern "C" void* malloc(std::size_t size)
+{
+  if(counting){  ++number_mallocs;}
+  return __libc_malloc(size);
+}
+
+
+//dense PPCKO prediction (full eigendecomposition of phi), as reference
+KO_Traits::StoringVector
+reference_prediction(const KO_Traits::StoringMatrix &X, double alpha, int k)
+{
+  const Eigen::Index m = X.rows();
+  const Eigen::Index n = X.cols();
+  KO_Traits::StoringVector means = X.rowwise().mean();
+  KO_Traits::StoringMatrix Xc = X.colwise() - means;
+  KO_Traits::StoringMatrix Cov = Xc*Xc.transpose()/static_cast<double>(n);
+  KO_Traits::StoringMatrix CrossCov = Xc.rightCols(n-1)*Xc.leftCols(n-1).transpose()/static_cast<double>(n-1);
+  KO_Traits::StoringMatrix CovReg = Cov + alpha*Cov.trace()*KO_Traits::StoringMatrix::Identity(m,m);
+  Eigen::LLT<KO_Traits::StoringMatrix> L(CovReg);
+  KO_Traits::StoringMatrix W = L.matrixL().solve(CrossCov.transpose());
+  Eigen::SelfAdjointEigenSolver<KO_Traits::StoringMatrix> eig(W*W.transpose());
+  KO_Traits::StoringMatrix b = L.matrixU().solve(eig.eigenvectors().rightCols(k));
+  return CrossCov*b*(b.transpose()*Xc.col(n-1)) + means;
+}
+
+
+int main()
+{
+  std::mt19937 gen(23032000);
+  std::normal_distribution<double> noise;
+  int failures = 0;
+  
+  for(int m : {5, 20, 60})
+  {
+    //fts: autoregressive of order one
+    const int n = 120;
+    KO_Traits::StoringMatrix X(m,n);
+    X.col(0) = KO_Traits::StoringVector::NullaryExpr(m,[&](){return noise(gen);});
+    for(int t = 1; t < n; ++t){  X.col(t) = 0.6*X.col(t-1) + KO_Traits::StoringVector::NullaryExpr(m,[&](){return noise(gen);});}
+    
+    fold_workspace &workspace = thread_fold_workspace();
+    
+    //same prediction of the dense estimate
+    for(int k : {1, 2, 3})
+    {
+      KO_Traits::StoringVector expected = reference_prediction(X,0.01,k);
+      double err = (workspace.fit_predict(X,0.01,k) - expected).norm()/expected.norm();
+      if(err > 1e-8)
+      {
+        std::printf("m = %d, k = %d: relative error %g\n",m,k,err);
+        ++failures;
+      }
+    }
+    
+    //same prediction, and number of PPCs, of 'PPC_KO_NoCV' (the estimator of the final fit, through 'Spectra')
+    for(double threshold_ppc : {0.5, 0.9})
+    {
+      PPC_KO_NoCV<SOLVER::ex_solver,K_IMP::NO,VALID_ERR_RET::NO_err,CV_STRAT::AUGMENTING_WINDOW,CV_ERR_EVAL::MSE> ko(KO_Traits::StoringMatrix(X),0.01,threshold_ppc,1);
+      ko.solving();
+      KO_Traits::StoringVector expected = ko.prediction();
+      double err = (workspace.fit_predict(X,0.01,0,threshold_ppc) - expected).norm()/expected.norm();
+      if(err > 1e-8 || workspace.k() != ko.k())
+      {
+        std::printf("m = %d, threshold = %g: relative error %g from PPC_KO_NoCV, %d PPCs instead of %d\n",m,threshold_ppc,err,workspace.k(),ko.k());
+        ++failures;
+      }
+    }
+    
+    //augmenting window: after a first pass, the folds are fitted without heap allocations
+    auto cv = [&](){ for(int n_train = 40; n_train <= n; n_train += 5){ workspace.fit_predict(X.leftCols(n_train),0.01,2); workspace.fit_predict(X.leftCols(n_train),0.1,0,0.9);}};
+    cv();
+    number_mallocs = 0;
+    counting = true;
+    cv();
+    counting = false;
+    if(number_mallocs != 0)
+    {
+      std::printf("m = %d: %ld heap allocations in steady state\n",m,number_mallocs);
+      ++failures;
+    }
+  }
+  
+  //cv on the number of PPCs: once the longest fold has been seen, the splits are evaluated on views of the fts, inside the workspace
+  {
+    const int m = 20;
+    const int n = 80;
+    KO_Traits::StoringMatrix X(m,n);
+    X.col(0) = KO_Traits::StoringVector::NullaryExpr(m,[&](){return noise(gen);});
+    for(int t = 1; t < n; ++t){  X.col(t) = 0.6*X.col(t-1) + KO_Traits::StoringVector::NullaryExpr(m,[&](){return noise(gen);});}
+    
+    auto predictor = [](const Eigen::Ref<const KO_Traits::StoringMatrix> &data, double alpha, int k, int number_threads) -> const KO_Traits::StoringVector & 
+                       { return cv_pred_func<SOLVER::ex_solver,K_IMP::YES,VALID_ERR_RET::NO_err,CV_STRAT::AUGMENTING_WINDOW,CV_ERR_EVAL::MSE>(data,alpha,k,number_threads);};
+    auto strategy = Factory_cv_strat<CV_STRAT::AUGMENTING_WINDOW>::cv_strat_obj(40,n);
+    CV_k<CV_STRAT::AUGMENTING_WINDOW,CV_ERR_EVAL::MSE,K_IMP::YES,VALID_ERR_RET::NO_err> cv(KO_Traits::StoringMatrix(X),std::move(*strategy),{1,2,3},0.0,0.01,predictor,1);
+    const cv_strategy_t &splits = cv.strategy().strategy();
+    
+    for(int k : {1, 2, 3}){  cv.error_single_param(k,splits,splits.size());}
+    
+    //each split: no heap allocations
+    number_mallocs = 0;
+    counting = true;
+    for(int k : {1, 2, 3}){  for(const auto &split : splits){  cv.error_single_split(k,split);}}
+    counting = false;
+    if(number_mallocs != 0)
+    {
+      std::printf("cv: %ld heap allocations evaluating the splits in steady state\n",number_mallocs);
+      ++failures;
+    }
+    
+    //each parameter: only the vector of the errors of the splits
+    number_mallocs = 0;
+    counting = true;
+    cv.error_single_param(2,splits,splits.size());
+    counting = false;
+    if(number_mallocs > 1)
+    {
+      std::printf("cv: %ld heap allocations evaluating a parameter in steady state\n",number_mallocs);
+      ++failures;
+    }
+    
+    //released workspace: sized again at the next fit
+    release_fold_workspaces();
+    number_mallocs = 0;
+    counting = true;
+    cv.error_single_split(2,splits.back());
+    counting = false;
+    if(number_mallocs == 0)
+    {
+      std::printf("cv: buffers of the workspace not released\n");
+      ++failures;
+    }
+  }
+  
+  if(failures > 0)
+  {
+    std::printf("fold_workspace: %d failures\n",failures);
+    return EXIT_FAILURE;
+  }
+  std::printf("fold_workspace: all tests passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2024 Andrea Enrico Franzoni (andreaenrico.franzoni@gmail.com)
+//
+// This file is part of PPCKO
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of PPCKO and associated documentation files (the PPCKO software), to deal
+// PPCKO without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of PPCKO, and to permit persons to whom PPCKO is
+// furnished to do so, subject to the following conditions:
+//
+// PPCKO IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH PPCKO OR THE USE OR OTHER DEALINGS IN
+// PPCKO.
+
+/*!
+* @file test_threading_policy.cpp
+* @brief Standalone test of the threading policy: for every policy and phase, the threads of the outer loops times the ones of the inner kernels
+*        never exceed the threads available (no oversubscription)
+* @author Andrea Enrico Franzoni
+* @details Built and run through ctest:
+*          cmake -S tests/cpp -B build-tests && cmake --build build-tests && ctest --test-dir build-tests
+*/
+
+#include <cstdlib>
+#include <cstdio>
+
+#include "threading_policy.hpp"
+
+
+int main()
+{
+  int failures = 0;
+  
+  for(THREADING policy : {THREADING::AUTO_THREADS, THREADING::OUTER_LOOPS, THREADING::INNER_KERNELS})
+  {
+    threading_policy active(policy);
+    
+    for(KO_PHASE phase : {KO_PHASE::MOMENTS, KO_PHASE::EIGENSOLVE, KO_PHASE::CV_GRID})
+    {
+      for(int number_threads = 1; number_threads <= 64; ++number_threads)
+      {
+        const int outer = threading_policy::outer_threads(phase,number_threads);
+        const int inner = threading_policy::inner_threads(phase,number_threads);
+        
+        if(outer < 1 || inner < 1 || outer*inner > number_threads)
+        {
+          std::printf("policy %s, phase %d, %d threads: %d outer x %d inner\n",threading_policy::name(policy).c_str(),static_cast<int>(phase),number_threads,outer,inner);
+          ++failures;
+        }
+        
+        //automatic policy: the cv grid to the loops, moments and eigensolve to the kernels (if they can be multi-threaded)
+        const bool to_loops = phase == KO_PHASE::CV_GRID || !threading_policy::threaded_kernels();
+        if(policy == THREADING::AUTO_THREADS && (to_loops ? outer != number_threads : inner != number_threads))
+        {
+          std::printf("policy AUTO, phase %d, %d threads: %d outer x %d inner\n",static_cast<int>(phase),number_threads,outer,inner);
+          ++failures;
+        }
+      }
+    }
+  }
+  
+  if(failures > 0)
+  {
+    std::printf("threading policy: %d failures\n",failures);
+    return EXIT_FAILURE;
+  }
+  std::printf("threading policy: all tests passed\n");
+  return EXIT_SUCCESS;
+}